@@ -0,0 +1,185 @@
+﻿#include "BarnesHut.hpp"
+#include "Morton.hpp"
+#include "JobSystem.hpp"
+#include "ParallelSort.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+BarnesHutTree::BarnesHutTree(float openingAngle, float softening)
+    : openingAngle(openingAngle), softening(softening) {
+}
+
+void BarnesHutTree::build(const MatterStore& matters) {
+    nodes.clear();
+    const long long count = static_cast<long long>(matters.size());
+    if (count == 0) return;
+
+    const float* posX = matters.posX.data();
+    const float* posY = matters.posY.data();
+    const float size = computeMortonKeys(posX, posY, matters.size(), keys, order);
+
+    // Сховище, щойно впорядковане Simulation::reorderBodies, вже лежить у порядку Мортона
+    if (countMortonDescents(keys) > 0) radixSortPairs(keys, order);
+
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedMass.resize(count);
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(static_cast<std::size_t>(count), jobs.grainFor(static_cast<std::size_t>(count)), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            std::uint32_t i = order[k];
+            sortedX[k] = posX[i];
+            sortedY[k] = posY[i];
+            sortedMass[k] = matters.mass[i];
+        }
+    });
+
+    nodes.reserve(static_cast<std::size_t>(count) / leafSize * 2 + 1);
+    buildNode(0, static_cast<std::uint32_t>(count), 0, size);
+}
+
+int BarnesHutTree::buildNode(std::uint32_t begin, std::uint32_t end, int depth, float size) {
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(Node());
+    Node node;
+    node.size = size;
+    node.begin = begin;
+    node.end = end;
+    node.isLeaf = (end - begin) <= leafSize || depth == maxDepth;
+    std::fill(node.child, node.child + 4, -1);
+
+    float mass = 0.0f;
+    float massX = 0.0f;
+    float massY = 0.0f;
+
+    if (node.isLeaf) {
+        for (std::uint32_t k = begin; k < end; ++k) {
+            mass += sortedMass[k];
+            massX += sortedX[k] * sortedMass[k];
+            massY += sortedY[k] * sortedMass[k];
+        }
+    }
+    else {
+        const int shift = 2 * (maxDepth - 1 - depth);
+        std::uint32_t childBegin = begin;
+        for (std::uint32_t digit = 0; digit < 4; ++digit) {
+            std::uint32_t childEnd = static_cast<std::uint32_t>(std::partition_point(
+                keys.begin() + childBegin, keys.begin() + end,
+                [&](std::uint32_t key) { return ((key >> shift) & 3u) <= digit; }) - keys.begin());
+            if (childEnd > childBegin) {
+                int child = buildNode(childBegin, childEnd, depth + 1, size * 0.5f);
+                node.child[digit] = child;
+                const Node& built = nodes[child];
+                mass += built.mass;
+                massX += built.massX * built.mass;
+                massY += built.massY * built.mass;
+            }
+            childBegin = childEnd;
+        }
+    }
+
+    if (mass > 0.0f) {
+        node.massX = massX / mass;
+        node.massY = massY / mass;
+    }
+    else {
+        node.massX = sortedX[begin];
+        node.massY = sortedY[begin];
+    }
+    node.mass = mass;
+    nodes[index] = node;
+    return index;
+}
+
+Vec2 BarnesHutTree::accelerationAt(float x, float y) const {
+    return accumulate(x, y, std::numeric_limits<std::uint32_t>::max());
+}
+
+Vec2 BarnesHutTree::accumulate(float x, float y, std::uint32_t skip) const {
+    float ax = 0.0f;
+    float ay = 0.0f;
+    if (nodes.empty()) return Vec2(ax, ay);
+
+    const float theta2 = openingAngle * openingAngle;
+    const float eps2 = softening * softening;
+
+    int stack[4 * maxDepth + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        float dx = node.massX - x;
+        float dy = node.massY - y;
+        float distance2 = dx * dx + dy * dy;
+
+        if (node.isLeaf) {
+            for (std::uint32_t k = node.begin; k < node.end; ++k) {
+                if (k == skip) continue;
+                float bx = sortedX[k] - x;
+                float by = sortedY[k] - y;
+                float r2 = bx * bx + by * by + eps2;
+                float inv = 1.0f / (r2 * std::sqrt(r2));
+                ax += sortedMass[k] * bx * inv;
+                ay += sortedMass[k] * by * inv;
+            }
+        }
+        else if (node.size * node.size < theta2 * distance2 && (skip < node.begin || skip >= node.end)) {
+            float r2 = distance2 + eps2;
+            float inv = 1.0f / (r2 * std::sqrt(r2));
+            ax += node.mass * dx * inv;
+            ay += node.mass * dy * inv;
+        }
+        else {
+            for (int c = 3; c >= 0; --c) {
+                if (node.child[c] >= 0) stack[top++] = node.child[c];
+            }
+        }
+    }
+
+    return Vec2(ax * gravitationalConstant, ay * gravitationalConstant);
+}
+
+template <class Visitor>
+void BarnesHutTree::forEachAcceleration(const Vec2& blackHolePosition, float blackHoleMass, Visitor&& visit) const {
+    // Обхід у порядку Мортона: сусідні шматки йдуть по сусідніх гілках дерева, дрібні шматки
+    // вирівнюють різну глибину обходу крадіжкою
+    JobSystem::instance().parallelFor(order.size(), 256, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            const float x = sortedX[k];
+            const float y = sortedY[k];
+            Vec2 acceleration = accumulate(x, y, static_cast<std::uint32_t>(k));
+
+            // Чорна діра як важке тіло: її внесок рахується точно і ніколи не зливається з коміркою
+            if (blackHoleMass > 0.0f) {
+                float dx = blackHolePosition.x - x;
+                float dy = blackHolePosition.y - y;
+                float distance = std::sqrt(dx * dx + dy * dy);
+                float pull = blackHoleMass / (distance * distance * distance);
+                acceleration.x += dx * pull;
+                acceleration.y += dy * pull;
+            }
+
+            visit(order[k], acceleration);
+        }
+    });
+}
+
+void BarnesHutTree::applyToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float deltaTime) const {
+    float* velX = matters.velX.data();
+    float* velY = matters.velY.data();
+    forEachAcceleration(blackHolePosition, blackHoleMass, [&](std::uint32_t i, const Vec2& acceleration) {
+        velX[i] += acceleration.x * deltaTime;
+        velY[i] += acceleration.y * deltaTime;
+    });
+}
+
+void BarnesHutTree::storeAccelerations(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass) const {
+    float* accX = matters.accX.data();
+    float* accY = matters.accY.data();
+    forEachAcceleration(blackHolePosition, blackHoleMass, [&](std::uint32_t i, const Vec2& acceleration) {
+        accX[i] = acceleration.x;
+        accY[i] = acceleration.y;
+    });
+}
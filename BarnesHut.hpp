@@ -0,0 +1,61 @@
+﻿#ifndef BARNES_HUT_HPP
+#define BARNES_HUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MatterStore.hpp"
+
+// Квадродерево Барнса–Хата для взаємної гравітації тіл.
+// Перебудовується кожен крок: коди Мортона -> радіксне сортування -> дерево над відсортованим масивом.
+class BarnesHutTree {
+public:
+    float openingAngle; // theta: менше значення = точніше і повільніше
+    float softening;    // згладжування на малих відстанях
+    float gravitationalConstant = 1.0f;
+
+    explicit BarnesHutTree(float openingAngle = 0.5f, float softening = 10.0f);
+
+    void build(const MatterStore& matters);
+
+    // Прискорення від усіх тіл дерева в довільній точці
+    Vec2 accelerationAt(float x, float y) const;
+
+    // Додає v += a * deltaTime для всіх тіл (з чорною дірою як важким тілом)
+    void applyToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float deltaTime) const;
+    // Записує прискорення в accX/accY (для leapfrog), швидкості не змінює
+    void storeAccelerations(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass) const;
+
+    std::size_t nodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        float massX;    // центр мас
+        float massY;
+        float mass;
+        float size;     // сторона комірки
+        int child[4];   // -1, якщо дитини немає
+        std::uint32_t begin; // діапазон у відсортованому порядку
+        std::uint32_t end;
+        bool isLeaf;
+    };
+
+    static const int maxDepth = 16;
+    static const std::uint32_t leafSize = 8;
+
+    int buildNode(std::uint32_t begin, std::uint32_t end, int depth, float size);
+    // skip - позиція тіла у відсортованому порядку, яке не тягне саме себе
+    Vec2 accumulate(float x, float y, std::uint32_t skip) const;
+    // Паралельно обходить тіла в порядку Мортона й віддає visit(index, acceleration)
+    template <class Visitor>
+    void forEachAcceleration(const Vec2& blackHolePosition, float blackHoleMass, Visitor&& visit) const;
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> keys;
+    std::vector<std::uint32_t> order;
+    std::vector<float> sortedX;
+    std::vector<float> sortedY;
+    std::vector<float> sortedMass;
+};
+
+#endif
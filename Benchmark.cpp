@@ -0,0 +1,428 @@
+﻿#include <omp.h>
+#include "MatterGenerator.hpp" // Генератор матерії
+#include "Simulation.hpp" // Ядро симуляції без SFML
+#include "JobSystem.hpp" // Пул потоків для фаз кроку
+#include "RewindBuffer.hpp" // Історія для перемотування
+#include "Catalog.hpp" // Імпорт початкових умов
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Бенчмарки ядра симуляції: кожен сценарій проганяється на 10^3..10^7 тілах і 1..N потоках,
+// результати пишуться в JSON, щоб порівнювати пропускну здатність і масштабування між версіями.
+// Використання: KOSMOS-Benchmark [--min-bodies N] [--max-bodies N] [--threads 1,2,4]
+//                                [--repeats R] [--cases gravity,step,...] [--out файл]
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Ті самі параметри, що й у вікні 1800x1600
+const Vec2 blackHolePosition(900.0f, 800.0f);
+const float blackHoleMass = 500.0f;
+const float deletionRadius = 100.0f;
+const float gravityMultiplier = 70.5f;
+const float deltaTime = 1.0f / 60.0f;
+
+// Щільність як у вікні (7560 тіл до 17500 від центру): зіткнення й пошук цілей
+// навантажені однаково на будь-якому розмірі
+const float referenceBodies = 7560.0f;
+const float referenceRadius = 17500.0f;
+
+struct Measurement {
+    std::vector<double> seconds;
+    double items = 0.0; // оброблені елементи за один прогін (тіла або запити)
+};
+
+struct Result {
+    std::string name;
+    std::size_t bodies;
+    int threads;
+    Measurement measurement;
+    double speedup = 1.0;
+};
+
+// Один прогін без заміру (прогрів кешів і робочих буферів), далі repeats замірів.
+// prepare виконується перед кожним прогоном і в час не входить.
+template <class Prepare, class Body>
+void measure(int repeats, Measurement& out, Prepare&& prepare, Body&& body) {
+    for (int r = 0; r <= repeats; ++r) {
+        prepare();
+        auto start = Clock::now();
+        body();
+        auto end = Clock::now();
+        if (r > 0) {
+            out.seconds.push_back(std::chrono::duration<double>(end - start).count());
+        }
+    }
+}
+
+struct Scene {
+    MatterStore matters;
+    float outerRadius;
+};
+
+Scene makeScene(std::size_t bodies) {
+    MatterGenerator generator(blackHolePosition, blackHoleMass);
+    generator.outerRadius = referenceRadius * std::sqrt(static_cast<float>(bodies) / referenceBodies);
+    Scene scene;
+    scene.matters = generator.generateMatter(bodies);
+    scene.outerRadius = generator.outerRadius;
+    return scene;
+}
+
+// Точки запитів пошуку (як кораблі): детерміновано розкидані по сцені
+std::vector<Vec2> makeShips(const Scene& scene, std::size_t count) {
+    std::vector<Vec2> ships;
+    Philox4x32 random(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        Philox4x32::Block bits = random(static_cast<std::uint32_t>(i), 0, 0, 0);
+        float distance = Philox4x32::uniform(bits.v[0]) * scene.outerRadius;
+        float angle = Philox4x32::uniform(bits.v[1]) * 6.28318531f;
+        Vec2 position(blackHolePosition.x + distance * std::cos(angle), blackHolePosition.y + distance * std::sin(angle));
+        ships.push_back(position);
+    }
+    return ships;
+}
+
+// Та сама сцена з тілами в порядку Мортона (як після Simulation::reorderBodies)
+Scene mortonScene(const Scene& scene) {
+    Simulation simulation(blackHolePosition, blackHoleMass, deletionRadius);
+    simulation.matters = scene.matters;
+    simulation.reorderBodies();
+    Scene sorted;
+    sorted.matters = simulation.matters;
+    sorted.outerRadius = scene.outerRadius;
+    return sorted;
+}
+
+typedef std::function<Measurement(const Scene&, int repeats)> CaseFunction;
+
+struct Case {
+    const char* name;
+    CaseFunction run;
+};
+
+Measurement benchGenerate(const Scene& scene, int repeats) {
+    Measurement m;
+    MatterStore matters;
+    measure(repeats, m, [] {}, [&] {
+        MatterGenerator generator(blackHolePosition, blackHoleMass);
+        generator.outerRadius = scene.outerRadius;
+        matters = generator.generateMatter(scene.matters.size());
+    });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+Measurement benchGravity(const Scene& scene, int repeats, GravityMode mode) {
+    Measurement m;
+    MatterStore matters = scene.matters;
+    GravitySolver solver;
+    solver.mode = mode;
+    measure(repeats, m, [] {}, [&] {
+        applyGravityToMatters(matters, blackHolePosition, blackHoleMass, gravityMultiplier, deltaTime, solver);
+    });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Об'єднане векторне ядро, яким користується крок (для порівняння з applyGravityToMatters)
+Measurement benchKickDrift(const Scene& scene, int repeats) {
+    Measurement m;
+    MatterStore matters = scene.matters;
+    const KernelIsa isa = detectKernelIsa();
+    measure(repeats, m, [] {}, [&] {
+        blackHoleKickDrift(matters.posX.data(), matters.posY.data(), matters.velX.data(), matters.velY.data(), matters.size(),
+                           blackHolePosition.x, blackHolePosition.y, blackHoleMass * gravityMultiplier, deltaTime, isa);
+    });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+Measurement benchCollisions(const Scene& scene, int repeats) {
+    Measurement m;
+    MatterStore matters;
+    CollisionSolver solver;
+    measure(repeats, m, [&] { matters = scene.matters; }, [&] { handleCollisions(matters, solver); });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Повний перебір: O(N) на запит
+Measurement benchNearestScan(const Scene& scene, int repeats) {
+    Measurement m;
+    std::vector<Vec2> ships = makeShips(scene, 16);
+    std::size_t found = 0;
+    measure(repeats, m, [] {}, [&] {
+        for (const Vec2& ship : ships) found += findNearestMatter(ship, scene.matters) != noMatter;
+    });
+    m.items = static_cast<double>(ships.size());
+    return m;
+}
+
+Measurement benchNearestIndex(const Scene& scene, int repeats) {
+    Measurement m;
+    std::vector<Vec2> ships = makeShips(scene, 4096);
+    TargetIndex targets;
+    targets.rebuild(scene.matters);
+    std::size_t found = 0;
+    measure(repeats, m, [] {}, [&] {
+        for (const Vec2& ship : ships) found += findNearestMatter(ship, scene.matters, targets) != noMatter;
+    });
+    m.items = static_cast<double>(ships.size());
+    return m;
+}
+
+// Упорядкування сховища за Мортоном з порядку генератора (найгірший випадок)
+Measurement benchReorder(const Scene& scene, int repeats) {
+    Measurement m;
+    Simulation simulation(blackHolePosition, blackHoleMass, deletionRadius);
+    measure(repeats, m, [&] { simulation.matters = scene.matters; }, [&] { simulation.reorderBodies(); });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Пошук тіл у зоні знищення і їх видалення swap-and-pop (~1% тіл)
+Measurement benchKillZone(const Scene& scene, int repeats) {
+    Measurement m;
+    MatterStore matters;
+    KillList kill;
+    std::vector<BodyMove> moves;
+    const float radius = 100.0f + 0.01f * (scene.outerRadius - 100.0f);
+    measure(repeats, m, [&] { matters = scene.matters; }, [&] {
+        collectMattersInKillZone(matters, blackHolePosition, radius, kill);
+        matters.removeSwap(kill.indices, &moves);
+    });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Крок як у headless за замовчуванням: leapfrog навколо чорної діри зі знищенням тіл.
+// specialized = false - загальний крок, що перевіряє перемикачі під час виконання
+Measurement benchStep(const Scene& scene, int repeats, bool specialized) {
+    Measurement m;
+    Simulation simulation(blackHolePosition, blackHoleMass, deletionRadius);
+    simulation.specializedSteps = specialized;
+    simulation.matters = scene.matters;
+    measure(repeats, m, [] {}, [&] { simulation.step(deltaTime); });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Проміжний кадр історії перемотування: копія стану й кодування відхилень після кроку
+Measurement benchRewindFrame(const Scene& scene, int repeats) {
+    Measurement m;
+    Simulation simulation(blackHolePosition, blackHoleMass, deletionRadius);
+    simulation.matters = scene.matters;
+    RewindBuffer history;
+    history.budgetBytes = static_cast<std::size_t>(-1);
+    history.keyframeInterval = 0;
+    history.frameInterval = 1;
+    history.record(simulation, deltaTime);
+    measure(repeats, m, [&] { simulation.step(deltaTime); }, [&] {
+        history.record(simulation, deltaTime);
+        history.wait();
+    });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+// Розбір каталогу з пам'яті: без диска, лише паралельний розбір і заповнення сховища
+Measurement benchCatalog(const Scene& scene, int repeats, CatalogFormat format) {
+    Measurement m;
+    std::vector<unsigned char> bytes;
+    writeCatalog(scene.matters, format, bytes);
+    MatterStore imported;
+    measure(repeats, m, [&] { imported = MatterStore(); }, [&] { readCatalog(bytes.data(), bytes.size(), imported); });
+    m.items = static_cast<double>(scene.matters.size());
+    return m;
+}
+
+const Case cases[] = {
+    { "generate", benchGenerate },
+    { "gravity", [](const Scene& s, int r) { return benchGravity(s, r, GravityMode::BlackHoleOnly); } },
+    { "kick-drift", benchKickDrift },
+    { "gravity-barnes-hut", [](const Scene& s, int r) { return benchGravity(s, r, GravityMode::BarnesHut); } },
+    { "gravity-particle-mesh", [](const Scene& s, int r) { return benchGravity(s, r, GravityMode::ParticleMesh); } },
+    { "collisions", benchCollisions },
+    { "collisions-morton", [](const Scene& s, int r) { return benchCollisions(mortonScene(s), r); } },
+    { "gravity-barnes-hut-morton", [](const Scene& s, int r) { return benchGravity(mortonScene(s), r, GravityMode::BarnesHut); } },
+    { "reorder", benchReorder },
+    { "nearest-scan", benchNearestScan },
+    { "nearest-index", benchNearestIndex },
+    { "kill-zone", benchKillZone },
+    { "step", [](const Scene& s, int r) { return benchStep(s, r, true); } },
+    { "step-generic", [](const Scene& s, int r) { return benchStep(s, r, false); } },
+    { "rewind-frame", benchRewindFrame },
+    { "catalog-binary", [](const Scene& s, int r) { return benchCatalog(s, r, CatalogFormat::Binary); } },
+    { "catalog-csv", [](const Scene& s, int r) { return benchCatalog(s, r, CatalogFormat::Csv); } },
+};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    std::size_t half = values.size() / 2;
+    return values.size() % 2 ? values[half] : 0.5 * (values[half - 1] + values[half]);
+}
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    return sum / values.size();
+}
+
+bool parseList(const char* text, std::vector<std::string>& out) {
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) return false;
+        out.push_back(item);
+    }
+    return !out.empty();
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results, int repeats) {
+    out << "{\n"
+        << "  \"version\": 1,\n"
+        << "  \"max_threads\": " << omp_get_max_threads() << ",\n"
+        << "  \"kernel\": \"" << kernelIsaName(detectKernelIsa()) << "\",\n"
+        << "  \"bytes_per_body\": " << MatterStore::bytesPerBody() << ",\n"
+        << "  \"repeats\": " << repeats << ",\n"
+        << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const std::vector<double>& s = r.measurement.seconds;
+        double mid = median(s);
+        out << (i ? "," : "") << "\n    {"
+            << "\"case\": \"" << r.name << "\", "
+            << "\"bodies\": " << r.bodies << ", "
+            << "\"threads\": " << r.threads << ", "
+            << "\"min_ms\": " << *std::min_element(s.begin(), s.end()) * 1000.0 << ", "
+            << "\"median_ms\": " << mid * 1000.0 << ", "
+            << "\"mean_ms\": " << mean(s) * 1000.0 << ", "
+            << "\"items_per_second\": " << r.measurement.items / mid << ", "
+            << "\"speedup\": " << r.speedup << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void printUsage() {
+    std::cerr << "Usage: KOSMOS-Benchmark [--min-bodies N] [--max-bodies N] [--threads 1,2,4] "
+                 "[--repeats R] [--cases name,...] [--out file]\nCases:";
+    for (const Case& c : cases) std::cerr << " " << c.name;
+    std::cerr << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::size_t minBodies = 1000;
+    std::size_t maxBodies = 10000000;
+    std::vector<int> threadCounts;
+    int repeats = 5;
+    std::vector<std::string> selected;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--min-bodies") == 0 && hasValue) {
+            minBodies = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--max-bodies") == 0 && hasValue) {
+            maxBodies = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            std::vector<std::string> items;
+            if (!parseList(argv[++i], items)) {
+                printUsage();
+                return -1;
+            }
+            for (const std::string& item : items) threadCounts.push_back(std::atoi(item.c_str()));
+        }
+        else if (std::strcmp(argv[i], "--repeats") == 0 && hasValue) {
+            repeats = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--cases") == 0 && hasValue) {
+            if (!parseList(argv[++i], selected)) {
+                printUsage();
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        }
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+
+    // За замовчуванням 1, 2, 4, ... до всіх ядер
+    const int maxThreads = omp_get_max_threads();
+    if (threadCounts.empty()) {
+        for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+        threadCounts.push_back(maxThreads);
+    }
+
+    std::vector<const Case*> active;
+    for (const Case& c : cases) {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), c.name) != selected.end()) {
+            active.push_back(&c);
+        }
+    }
+    bool badThreads = std::any_of(threadCounts.begin(), threadCounts.end(), [](int t) { return t <= 0; });
+    if (minBodies == 0 || maxBodies < minBodies || repeats <= 0 || badThreads || active.size() != (selected.empty() ? std::size(cases) : selected.size())) {
+        printUsage();
+        return -1;
+    }
+
+    std::vector<Result> results;
+    for (std::size_t bodies = minBodies; bodies <= maxBodies; bodies *= 10) {
+        JobSystem::instance().setThreadCount(maxThreads);
+        Scene scene = makeScene(bodies);
+
+        for (const Case* c : active) {
+            double baseline = 0.0;
+            for (int threads : threadCounts) {
+                JobSystem::instance().setThreadCount(threads);
+                Result result;
+                result.name = c->name;
+                result.bodies = bodies;
+                result.threads = threads;
+                result.measurement = c->run(scene, repeats);
+
+                double mid = median(result.measurement.seconds);
+                if (baseline == 0.0) baseline = mid;
+                result.speedup = baseline / mid;
+
+                std::cerr << c->name << " bodies=" << bodies << " threads=" << threads
+                          << " median=" << mid * 1000.0 << " ms"
+                          << " items/s=" << result.measurement.items / mid << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (outPath.empty()) {
+        writeJson(std::cout, results, repeats);
+    }
+    else {
+        std::ofstream file(outPath);
+        writeJson(file, results, repeats);
+        if (!file) {
+            std::cerr << "Error: Could not write " << outPath << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
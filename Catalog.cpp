@@ -0,0 +1,453 @@
+﻿#include "Catalog.hpp"
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char catalogMagic[8] = { 'K', 'O', 'S', 'M', 'O', 'S', 'C', 'T' };
+const std::uint32_t catalogVersion = 1;
+const std::size_t catalogHeaderBytes = 24;
+const std::size_t recordBytes = 6 * sizeof(float) + 1;
+// Шматок CSV на одне завдання; межа зсувається до кінця рядка
+const std::size_t csvChunkBytes = std::size_t(1) << 22;
+// Слоти дескрипторів 32-бітні
+const std::size_t maxBodies = 0xFFFFFFFEu;
+const std::size_t maxColumns = 256;
+
+enum Field {
+    FieldX,
+    FieldY,
+    FieldVelX,
+    FieldVelY,
+    FieldMass,
+    FieldRadius,
+    FieldColony,
+    fieldCount
+};
+const char* const fieldNames[fieldCount] = { "x", "y", "vx", "vy", "mass", "radius", "colony" };
+const int skipColumn = -1;
+
+// Перша помилка шматка; з усіх шматків повідомляється найраніша
+struct CatalogError {
+    std::size_t where = static_cast<std::size_t>(-1); // рядок CSV або номер запису
+    const char* message = nullptr;
+};
+
+const CatalogError* firstError(const std::vector<CatalogError>& errors) {
+    const CatalogError* first = nullptr;
+    for (const CatalogError& error : errors) {
+        if (error.message && (!first || error.where < first->where)) first = &error;
+    }
+    return first;
+}
+
+const char* validate(const float* values) {
+    for (int field = 0; field < fieldCount; ++field) {
+        if (!std::isfinite(values[field])) return "value is not a finite number";
+    }
+    if (values[FieldMass] <= 0.0f) return "mass must be positive";
+    if (values[FieldRadius] <= 0.0f) return "radius must be positive";
+    if (values[FieldColony] != 0.0f && values[FieldColony] != 1.0f) return "colony must be 0 or 1";
+    return nullptr;
+}
+
+// Решта полів (прискорення, корабель, ціль) лишаються нулями з resize
+void storeBody(MatterStore& matters, std::size_t i, const float* values) {
+    matters.posX[i] = values[FieldX];
+    matters.posY[i] = values[FieldY];
+    matters.velX[i] = values[FieldVelX];
+    matters.velY[i] = values[FieldVelY];
+    matters.mass[i] = values[FieldMass];
+    matters.radius[i] = values[FieldRadius];
+    matters.isColony[i] = values[FieldColony] != 0.0f;
+}
+
+std::uint32_t loadU32(const unsigned char* p) {
+    return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8
+        | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+std::uint64_t loadU64(const unsigned char* p) {
+    return static_cast<std::uint64_t>(loadU32(p)) | static_cast<std::uint64_t>(loadU32(p + 4)) << 32;
+}
+
+float loadFloat(const unsigned char* p) {
+    const std::uint32_t bits = loadU32(p);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void storeU32(unsigned char* p, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void storeU64(unsigned char* p, std::uint64_t value) {
+    storeU32(p, static_cast<std::uint32_t>(value));
+    storeU32(p + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+void storeFloat(unsigned char* p, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    storeU32(p, bits);
+}
+
+bool readBinary(const unsigned char* data, std::size_t size, MatterStore& out, const std::string& name) {
+    if (size < catalogHeaderBytes) {
+        std::cerr << "Error: " << name << ": truncated catalog header" << std::endl;
+        return false;
+    }
+    const std::uint32_t version = loadU32(data + 8);
+    const std::uint32_t bytesPerRecord = loadU32(data + 12);
+    const std::uint64_t count = loadU64(data + 16);
+    if (version != catalogVersion || bytesPerRecord != recordBytes) {
+        std::cerr << "Error: " << name << ": unsupported catalog version " << version << " (" << bytesPerRecord << " bytes per body)" << std::endl;
+        return false;
+    }
+    if (count == 0 || count > maxBodies || count != (size - catalogHeaderBytes) / recordBytes || (size - catalogHeaderBytes) % recordBytes != 0) {
+        std::cerr << "Error: " << name << ": " << count << " bodies do not match the file size " << size << std::endl;
+        return false;
+    }
+
+    MatterStore matters;
+    matters.resize(static_cast<std::size_t>(count));
+    const unsigned char* records = data + catalogHeaderBytes;
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(matters.size());
+    std::vector<CatalogError> errors((matters.size() + grain - 1) / grain);
+    jobs.parallelFor(matters.size(), grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        float values[fieldCount];
+        for (std::size_t i = begin; i < end; ++i) {
+            const unsigned char* record = records + i * recordBytes;
+            for (int field = 0; field < FieldColony; ++field) values[field] = loadFloat(record + field * sizeof(float));
+            values[FieldColony] = record[FieldColony * sizeof(float)];
+            if (const char* message = validate(values)) {
+                errors[chunk].where = i;
+                errors[chunk].message = message;
+                return;
+            }
+            storeBody(matters, i, values);
+        }
+    });
+
+    if (const CatalogError* error = firstError(errors)) {
+        std::cerr << "Error: " << name << ": body " << error->where << ": " << error->message << std::endl;
+        return false;
+    }
+    out = std::move(matters);
+    return true;
+}
+
+const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+// Кінець рядка без '\r' (CRLF з Windows)
+const char* contentEnd(const char* begin, const char* newline) {
+    return newline > begin && newline[-1] == '\r' ? newline - 1 : newline;
+}
+
+const char* findNewline(const char* p, const char* end) {
+    const void* found = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+// Рядок з даними: не порожній і не коментар
+bool dataLine(const char* begin, const char* stop) {
+    begin = skipBlanks(begin, stop);
+    return begin < stop && *begin != '#';
+}
+
+// Як розкладено колонки: поле кожної колонки або skipColumn
+struct CsvLayout {
+    std::vector<int> columnField;
+    std::size_t requiredColumns = fieldCount - 1;
+};
+
+bool readHeader(const char* p, const char* stop, CsvLayout& layout, const char*& message) {
+    layout.columnField.clear();
+    bool seen[fieldCount] = {};
+    while (true) {
+        const char* comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(stop - p)));
+        const char* fieldEnd = comma ? comma : stop;
+        const char* nameBegin = skipBlanks(p, fieldEnd);
+        const char* nameEnd = fieldEnd;
+        while (nameEnd > nameBegin && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t')) --nameEnd;
+
+        int field = skipColumn;
+        for (int f = 0; f < fieldCount; ++f) {
+            if (std::strlen(fieldNames[f]) == static_cast<std::size_t>(nameEnd - nameBegin)
+                && std::memcmp(fieldNames[f], nameBegin, nameEnd - nameBegin) == 0) {
+                field = f;
+            }
+        }
+        if (field != skipColumn) {
+            if (seen[field]) {
+                message = "a column is given twice";
+                return false;
+            }
+            seen[field] = true;
+        }
+        layout.columnField.push_back(field);
+        if (layout.columnField.size() > maxColumns) {
+            message = "too many columns";
+            return false;
+        }
+        if (!comma) break;
+        p = comma + 1;
+    }
+    for (int field = 0; field < FieldColony; ++field) {
+        if (!seen[field]) {
+            message = "header must name the columns x, y, vx, vy, mass and radius";
+            return false;
+        }
+    }
+    layout.requiredColumns = layout.columnField.size();
+    return true;
+}
+
+// Один рядок тіла в values (colony - 0, якщо колонки немає)
+const char* parseRow(const char* p, const char* stop, const CsvLayout& layout, float* values) {
+    values[FieldColony] = 0.0f;
+    std::size_t column = 0;
+    while (true) {
+        if (column >= layout.columnField.size()) return "too many columns";
+        const int field = layout.columnField[column];
+        p = skipBlanks(p, stop);
+        if (field == skipColumn) {
+            const void* comma = std::memchr(p, ',', static_cast<std::size_t>(stop - p));
+            p = comma ? static_cast<const char*>(comma) : stop;
+        }
+        else {
+            if (p < stop && *p == '+') ++p;
+            const std::from_chars_result parsed = std::from_chars(p, stop, values[field]);
+            if (parsed.ec == std::errc::result_out_of_range) return "value is out of range";
+            if (parsed.ec != std::errc()) return "expected a number";
+            p = skipBlanks(parsed.ptr, stop);
+        }
+        ++column;
+        if (p == stop) break;
+        if (*p != ',') return "expected a comma";
+        ++p;
+    }
+    if (column < layout.requiredColumns) return "too few columns";
+    return validate(values);
+}
+
+bool readCsv(const char* begin, const char* end, MatterStore& out, const std::string& name) {
+    // Заголовок - перший рядок з даними, якщо він починається з літери
+    CsvLayout layout;
+    for (int field = 0; field < fieldCount; ++field) layout.columnField.push_back(field);
+    std::size_t line = 1;
+    const char* body = begin;
+    while (body < end) {
+        const char* newline = findNewline(body, end);
+        const char* stop = contentEnd(body, newline);
+        if (dataLine(body, stop)) {
+            const char* first = skipBlanks(body, stop);
+            const bool special = stop - first >= 3 && (std::memcmp(first, "nan", 3) == 0 || std::memcmp(first, "inf", 3) == 0);
+            if (std::isalpha(static_cast<unsigned char>(*first)) && !special) {
+                const char* message = nullptr;
+                if (!readHeader(first, stop, layout, message)) {
+                    std::cerr << "Error: " << name << ":" << line << ": " << message << std::endl;
+                    return false;
+                }
+                body = newline < end ? newline + 1 : end;
+                ++line;
+            }
+            break;
+        }
+        body = newline < end ? newline + 1 : end;
+        ++line;
+    }
+
+    // Шматки закінчуються на межі рядка
+    std::vector<const char*> bounds(1, body);
+    while (bounds.back() < end) {
+        const char* next = bounds.back() + csvChunkBytes;
+        if (next >= end) {
+            bounds.push_back(end);
+            break;
+        }
+        const char* newline = findNewline(next - 1, end);
+        bounds.push_back(newline < end ? newline + 1 : end);
+    }
+    const std::size_t chunks = bounds.size() - 1;
+
+    // Перший прохід: рядки й тіла кожного шматка, щоб знати, куди писати
+    std::vector<std::size_t> chunkLines(chunks + 1, 0);
+    std::vector<std::size_t> chunkRows(chunks + 1, 0);
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(chunks, 1, [&](std::size_t, std::size_t first, std::size_t last) {
+        for (std::size_t chunk = first; chunk < last; ++chunk) {
+            std::size_t lines = 0;
+            std::size_t rows = 0;
+            for (const char* p = bounds[chunk]; p < bounds[chunk + 1]; ++lines) {
+                const char* newline = findNewline(p, bounds[chunk + 1]);
+                rows += dataLine(p, contentEnd(p, newline));
+                p = newline + 1;
+            }
+            chunkLines[chunk + 1] = lines;
+            chunkRows[chunk + 1] = rows;
+        }
+    });
+    chunkLines[0] = line;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        chunkLines[chunk + 1] += chunkLines[chunk];
+        chunkRows[chunk + 1] += chunkRows[chunk];
+    }
+    const std::size_t count = chunkRows[chunks];
+    if (count == 0 || count > maxBodies) {
+        std::cerr << "Error: " << name << ": " << (count == 0 ? "no bodies" : "too many bodies") << std::endl;
+        return false;
+    }
+
+    // Другий прохід: значення одразу в масиви сховища
+    MatterStore matters;
+    matters.resize(count);
+    std::vector<CatalogError> errors(chunks);
+    jobs.parallelFor(chunks, 1, [&](std::size_t, std::size_t first, std::size_t last) {
+        for (std::size_t chunk = first; chunk < last; ++chunk) {
+            std::size_t row = chunkRows[chunk];
+            std::size_t lineNumber = chunkLines[chunk];
+            float values[fieldCount];
+            for (const char* p = bounds[chunk]; p < bounds[chunk + 1]; ++lineNumber) {
+                const char* newline = findNewline(p, bounds[chunk + 1]);
+                const char* stop = contentEnd(p, newline);
+                const char* lineBegin = p;
+                p = newline + 1;
+                if (!dataLine(lineBegin, stop)) continue;
+                if (const char* message = parseRow(lineBegin, stop, layout, values)) {
+                    errors[chunk].where = lineNumber;
+                    errors[chunk].message = message;
+                    break;
+                }
+                storeBody(matters, row++, values);
+            }
+        }
+    });
+
+    if (const CatalogError* error = firstError(errors)) {
+        std::cerr << "Error: " << name << ":" << error->where << ": " << error->message << std::endl;
+        return false;
+    }
+    out = std::move(matters);
+    return true;
+}
+
+}
+
+CatalogFormat catalogFormatFor(const std::string& path) {
+    const std::size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    for (char& c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return extension == "csv" ? CatalogFormat::Csv : CatalogFormat::Binary;
+}
+
+bool readCatalog(const unsigned char* data, std::size_t size, MatterStore& matters, CatalogStats* stats, const std::string& name) {
+    const auto start = std::chrono::steady_clock::now();
+    const bool binary = size >= sizeof(catalogMagic) && std::memcmp(data, catalogMagic, sizeof(catalogMagic)) == 0;
+    const char* text = reinterpret_cast<const char*>(data);
+    if (!(binary ? readBinary(data, size, matters, name) : readCsv(text, text + size, matters, name))) return false;
+
+    if (stats) {
+        stats->bodies = matters.size();
+        stats->colonies = 0;
+        for (std::uint8_t colony : matters.isColony) stats->colonies += colony;
+        stats->bytes = size;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
+
+void writeCatalog(const MatterStore& matters, CatalogFormat format, std::vector<unsigned char>& out) {
+    const std::size_t count = matters.size();
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+
+    if (format == CatalogFormat::Binary) {
+        out.assign(catalogHeaderBytes + count * recordBytes, 0);
+        std::memcpy(out.data(), catalogMagic, sizeof(catalogMagic));
+        storeU32(out.data() + 8, catalogVersion);
+        storeU32(out.data() + 12, static_cast<std::uint32_t>(recordBytes));
+        storeU64(out.data() + 16, count);
+        unsigned char* records = out.data() + catalogHeaderBytes;
+        jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                unsigned char* record = records + i * recordBytes;
+                const float values[FieldColony] = { matters.posX[i], matters.posY[i], matters.velX[i], matters.velY[i], matters.mass[i], matters.radius[i] };
+                for (int field = 0; field < FieldColony; ++field) storeFloat(record + field * sizeof(float), values[field]);
+                record[FieldColony * sizeof(float)] = matters.isColony[i] ? 1 : 0;
+            }
+        });
+        return;
+    }
+
+    // Найкоротший запис, що читається назад у той самий float
+    std::vector<std::vector<char>> pieces(count > 0 ? (count + grain - 1) / grain : 0);
+    jobs.parallelFor(count, grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::vector<char>& text = pieces[chunk];
+        text.resize((end - begin) * (FieldColony * 16 + 3));
+        char* p = text.data();
+        char* const limit = text.data() + text.size();
+        for (std::size_t i = begin; i < end; ++i) {
+            const float values[FieldColony] = { matters.posX[i], matters.posY[i], matters.velX[i], matters.velY[i], matters.mass[i], matters.radius[i] };
+            for (int field = 0; field < FieldColony; ++field) {
+                p = std::to_chars(p, limit, values[field]).ptr;
+                *p++ = ',';
+            }
+            *p++ = matters.isColony[i] ? '1' : '0';
+            *p++ = '\n';
+        }
+        text.resize(static_cast<std::size_t>(p - text.data()));
+    });
+
+    const char header[] = "x,y,vx,vy,mass,radius,colony\n";
+    std::size_t total = sizeof(header) - 1;
+    for (const std::vector<char>& text : pieces) total += text.size();
+    out.clear();
+    out.reserve(total);
+    out.insert(out.end(), header, header + sizeof(header) - 1);
+    for (const std::vector<char>& text : pieces) out.insert(out.end(), text.begin(), text.end());
+}
+
+bool importCatalog(const std::string& path, MatterStore& matters, CatalogStats* stats) {
+    const auto start = std::chrono::steady_clock::now();
+    CatalogStats loaded;
+    // Порожній файл не відображається в пам'ять, але це той самий каталог без тіл
+    std::ifstream probe(path, std::ios::binary | std::ios::ate);
+    if (probe && probe.tellg() == 0) {
+        const unsigned char none = 0;
+        return readCatalog(&none, 0, matters, &loaded, path);
+    }
+    probe.close();
+
+    MappedFile file;
+    if (!file.open(path.c_str())) {
+        std::cerr << "Error: Could not open catalog " << path << std::endl;
+        return false;
+    }
+    if (!readCatalog(file.data(), file.size(), matters, &loaded, path)) return false;
+    loaded.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) *stats = loaded;
+    return true;
+}
+
+bool exportCatalog(const std::string& path, const MatterStore& matters) {
+    std::vector<unsigned char> bytes;
+    writeCatalog(matters, catalogFormatFor(path), bytes);
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
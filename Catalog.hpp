@@ -0,0 +1,40 @@
+﻿#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MatterStore.hpp"
+
+// Зовнішні каталоги початкових умов: позиція, швидкість, маса, радіус і прапорець колонії кожного тіла.
+//  - CSV: рядок на тіло "x,y,vx,vy,mass,radius[,colony]". Перший рядок може бути заголовком з назвами
+//    цих колонок у будь-якому порядку (інші колонки пропускаються); порожні рядки й рядки з # - пропускаються.
+//  - Двійковий: заголовок "KOSMOSCT", u32 версія, u32 байтів на запис (25), u64 кількість тіл,
+//    далі записи впритул: 6 float (x, y, vx, vy, mass, radius) і u8 colony, little-endian.
+// Формат визначається за вмістом. Файл відображається в пам'ять і розбирається шматками паралельно:
+// перший прохід рахує рядки кожного шматка, другий пише значення одразу в масиви MatterStore.
+// Маса й радіус мають бути додатними, решта - скінченними, colony - 0 або 1; помилка вказує на рядок.
+enum class CatalogFormat {
+    Csv,
+    Binary
+};
+
+// .csv - CSV, решта - двійковий
+CatalogFormat catalogFormatFor(const std::string& path);
+
+struct CatalogStats {
+    std::size_t bodies = 0;
+    std::size_t colonies = 0;
+    std::size_t bytes = 0;
+    double seconds = 0.0; // від відкриття файла до заповненого сховища
+};
+
+// name - для повідомлень про помилки. matters змінюється лише при успіху
+bool readCatalog(const unsigned char* data, std::size_t size, MatterStore& matters, CatalogStats* stats = nullptr,
+                 const std::string& name = "catalog");
+void writeCatalog(const MatterStore& matters, CatalogFormat format, std::vector<unsigned char>& out);
+
+bool importCatalog(const std::string& path, MatterStore& matters, CatalogStats* stats = nullptr);
+bool exportCatalog(const std::string& path, const MatterStore& matters);
+
+#endif
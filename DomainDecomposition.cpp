@@ -0,0 +1,439 @@
+﻿#include "DomainDecomposition.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const float pi = 3.14159265358979f;
+
+// Повідомлення між доменами - сирі байти в порядку машини: усі процеси на одній машині
+template <class T>
+void put(std::vector<unsigned char>& out, const T& value) {
+    const std::size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+struct MessageReader {
+    const std::vector<unsigned char>& data;
+    std::size_t position = 0;
+
+    explicit MessageReader(const std::vector<unsigned char>& data) : data(data) {}
+
+    template <class T>
+    bool get(T& value) {
+        if (data.size() - position < sizeof(T)) return false;
+        std::memcpy(&value, data.data() + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+};
+
+// Тіло, що переходить у чужий домен
+struct MigrantBody {
+    float posX, posY, velX, velY, accX, accY, mass, radius;
+    std::uint8_t isColony, hasShip;
+};
+
+// Копія тіла з гало: лише те, що потрібно зіткненням
+struct HaloBody {
+    float posX, posY, velX, velY, mass, radius;
+};
+
+}
+
+int DomainLayout::domainOf(float x, float y) const {
+    const float dx = x - center.x;
+    const float dy = y - center.y;
+    const float distance = std::sqrt(dx * dx + dy * dy);
+    const int ring = static_cast<int>(std::upper_bound(ringRadii.begin(), ringRadii.end(), distance) - ringRadii.begin());
+    int sector = static_cast<int>((std::atan2(dy, dx) + pi) * (sectors / (2.0f * pi)));
+    sector = std::min(std::max(sector, 0), sectors - 1);
+    return ring * sectors + sector;
+}
+
+DomainLayout balanceDomains(const MatterStore& matters, const Vec2& center, int sectors, int rings) {
+    DomainLayout layout;
+    layout.center = center;
+    layout.sectors = std::max(sectors, 1);
+    if (rings <= 1 || matters.empty()) return layout;
+
+    std::vector<float> distances(matters.size());
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        const float dx = matters.posX[i] - center.x;
+        const float dy = matters.posY[i] - center.y;
+        distances[i] = std::sqrt(dx * dx + dy * dy);
+    }
+    for (int ring = 1; ring < rings; ++ring) {
+        const std::size_t quantile = distances.size() * ring / rings;
+        std::nth_element(distances.begin(), distances.begin() + quantile, distances.end());
+        layout.ringRadii.push_back(distances[quantile]);
+    }
+    std::sort(layout.ringRadii.begin(), layout.ringRadii.end());
+    return layout;
+}
+
+DomainWorker::DomainWorker(Simulation& simulation, const DomainLayout& layout, DomainTransport& transport)
+    : simulation(simulation), layout(layout), transport(transport) {
+    const int self = std::max(transport.rank(), 0);
+    const int sector = self % this->layout.sectors;
+    const std::size_t ring = static_cast<std::size_t>(self / this->layout.sectors);
+    const float width = 2.0f * pi / this->layout.sectors;
+    startX = std::cos(-pi + sector * width);
+    startY = std::sin(-pi + sector * width);
+    endX = std::cos(-pi + (sector + 1) * width);
+    endY = std::sin(-pi + (sector + 1) * width);
+    const std::vector<float>& radii = this->layout.ringRadii;
+    inner2 = ring > 0 && ring <= radii.size() ? radii[ring - 1] * radii[ring - 1] : 0.0f;
+    outer2 = ring < radii.size() ? radii[ring] * radii[ring] : std::numeric_limits<float>::infinity();
+
+    bounds.resize(static_cast<std::size_t>(this->layout.count()));
+    for (int domain = 0; domain < this->layout.count(); ++domain) {
+        const int s = domain % this->layout.sectors;
+        const std::size_t r = static_cast<std::size_t>(domain / this->layout.sectors);
+        DomainBounds& b = bounds[domain];
+        b.startX = std::cos(-pi + s * width);
+        b.startY = std::sin(-pi + s * width);
+        b.endX = std::cos(-pi + (s + 1) * width);
+        b.endY = std::sin(-pi + (s + 1) * width);
+        b.inner = r > 0 && r <= radii.size() ? radii[r - 1] : 0.0f;
+        b.outer = r < radii.size() ? radii[r] : std::numeric_limits<float>::infinity();
+    }
+}
+
+float DomainWorker::distanceTo(const DomainBounds& b, float x, float y) const {
+    const float dx = x - layout.center.x;
+    const float dy = y - layout.center.y;
+    // Усередині кута сектора найближча точка - на тому ж промені, тож лишається відстань до кільця
+    if (layout.sectors == 1 || (b.startX * dy - b.startY * dx >= 0.0f && dx * b.endY - dy * b.endX > 0.0f)) {
+        const float distance = std::sqrt(dx * dx + dy * dy);
+        return std::max(std::max(b.inner - distance, distance - b.outer), 0.0f);
+    }
+    // Поза кутом - до ближчого з відрізків меж сектора між радіусами кільця
+    float nearest = std::numeric_limits<float>::infinity();
+    const float edges[2][2] = { { b.startX, b.startY }, { b.endX, b.endY } };
+    for (const auto& edge : edges) {
+        const float along = std::min(std::max(dx * edge[0] + dy * edge[1], b.inner), b.outer);
+        const float ex = dx - along * edge[0];
+        const float ey = dy - along * edge[1];
+        nearest = std::min(nearest, std::sqrt(ex * ex + ey * ey));
+    }
+    return nearest;
+}
+
+void DomainWorker::keepOwnMatters() {
+    const MatterStore& matters = simulation.matters;
+    leaving.clear();
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        if (layout.domainOf(matters.posX[i], matters.posY[i]) != transport.rank()) leaving.push_back(static_cast<std::uint32_t>(i));
+    }
+    simulation.removeMatters(leaving);
+    simulation.resetAccelerations();
+}
+
+void DomainWorker::packSummary(std::vector<unsigned char>& out) {
+    // Маса й центр мас кожної непорожньої комірки сітки summaryGrid x summaryGrid над рамкою тіл
+    const MatterStore& matters = simulation.matters;
+    out.clear();
+    if (matters.empty()) {
+        put(out, std::uint32_t(0));
+        return;
+    }
+
+    float minX = matters.posX[0], maxX = minX, minY = matters.posY[0], maxY = minY;
+    for (std::size_t i = 1; i < matters.size(); ++i) {
+        minX = std::min(minX, matters.posX[i]);
+        maxX = std::max(maxX, matters.posX[i]);
+        minY = std::min(minY, matters.posY[i]);
+        maxY = std::max(maxY, matters.posY[i]);
+    }
+
+    const int grid = std::max(summaryGrid, 1);
+    const float scaleX = grid / std::max(maxX - minX, 1e-3f);
+    const float scaleY = grid / std::max(maxY - minY, 1e-3f);
+    std::vector<float> cellMass(static_cast<std::size_t>(grid) * grid, 0.0f);
+    std::vector<float> cellX(cellMass.size(), 0.0f);
+    std::vector<float> cellY(cellMass.size(), 0.0f);
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        const int column = std::min(static_cast<int>((matters.posX[i] - minX) * scaleX), grid - 1);
+        const int row = std::min(static_cast<int>((matters.posY[i] - minY) * scaleY), grid - 1);
+        const std::size_t cell = static_cast<std::size_t>(row) * grid + column;
+        cellMass[cell] += matters.mass[i];
+        cellX[cell] += matters.mass[i] * matters.posX[i];
+        cellY[cell] += matters.mass[i] * matters.posY[i];
+    }
+
+    std::uint32_t cells = 0;
+    for (float mass : cellMass) cells += mass > 0.0f;
+    put(out, cells);
+    for (std::size_t cell = 0; cell < cellMass.size(); ++cell) {
+        if (cellMass[cell] <= 0.0f) continue;
+        put(out, cellX[cell] / cellMass[cell]);
+        put(out, cellY[cell] / cellMass[cell]);
+        put(out, cellMass[cell]);
+    }
+}
+
+void DomainWorker::packHalo(float margin) {
+    // Тіло копіюється в кожен чужий домен ближче за margin: з тілом звідти воно може зіткнутись.
+    // Відстань - до справжніх меж сектора й кільця, а не до кутів квадрата: тонке кільце біля діри
+    // або вузький сектор біля центру можуть пройти між кутами
+    const MatterStore& matters = simulation.matters;
+    const int self = transport.rank();
+    std::vector<std::vector<std::uint32_t>> halo(transport.size());
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        const float x = matters.posX[i];
+        const float y = matters.posY[i];
+        for (int domain = 0; domain < transport.size(); ++domain) {
+            if (domain != self && distanceTo(bounds[domain], x, y) < margin) {
+                halo[domain].push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+    }
+
+    for (int peer = 0; peer < transport.size(); ++peer) {
+        if (peer == self) continue;
+        std::vector<unsigned char>& out = outgoing[peer];
+        put(out, static_cast<std::uint32_t>(halo[peer].size()));
+        for (std::uint32_t i : halo[peer]) {
+            HaloBody body = { matters.posX[i], matters.posY[i], matters.velX[i], matters.velY[i], matters.mass[i], matters.radius[i] };
+            put(out, body);
+        }
+    }
+}
+
+void DomainWorker::resolveCollisions(const std::vector<std::size_t>& haloStart) {
+    // Свої тіла + гало в одному сховищі для того ж ядра зіткнень; назад копіюються лише свої швидкості
+    KOSMOS_PROFILE_SCOPE("domain collisions");
+    MatterStore& matters = simulation.matters;
+    const std::size_t own = matters.size();
+    combined.posX.assign(matters.posX.begin(), matters.posX.end());
+    combined.posY.assign(matters.posY.begin(), matters.posY.end());
+    combined.velX.assign(matters.velX.begin(), matters.velX.end());
+    combined.velY.assign(matters.velY.begin(), matters.velY.end());
+    combined.mass.assign(matters.mass.begin(), matters.mass.end());
+    combined.radius.assign(matters.radius.begin(), matters.radius.end());
+
+    for (int peer = 0; peer < transport.size(); ++peer) {
+        if (peer == transport.rank()) continue;
+        MessageReader reader(incoming[peer]);
+        reader.position = haloStart[peer];
+        std::uint32_t count = 0;
+        reader.get(count);
+        HaloBody body;
+        for (std::uint32_t k = 0; k < count && reader.get(body); ++k) {
+            combined.posX.push_back(body.posX);
+            combined.posY.push_back(body.posY);
+            combined.velX.push_back(body.velX);
+            combined.velY.push_back(body.velY);
+            combined.mass.push_back(body.mass);
+            combined.radius.push_back(body.radius);
+        }
+    }
+
+    handleCollisions(combined, simulation.collisions);
+    std::copy(combined.velX.begin(), combined.velX.begin() + own, matters.velX.begin());
+    std::copy(combined.velY.begin(), combined.velY.begin() + own, matters.velY.begin());
+}
+
+bool DomainWorker::step(float deltaTime) {
+    KOSMOS_PROFILE_SCOPE("domain step");
+    const int self = transport.rank();
+    const int domains = transport.size();
+    const bool mutualGravity = simulation.gravity.mode != GravityMode::BlackHoleOnly;
+    const bool collisions = simulation.collisionHandlingActive;
+
+    // Зведення гравітації й гало - одним повідомленням кожному сусіду
+    if (mutualGravity) {
+        packSummary(summary);
+    }
+    else {
+        summary.assign(sizeof(std::uint32_t), 0);
+    }
+    outgoing.resize(domains);
+    for (int peer = 0; peer < domains; ++peer) {
+        outgoing[peer].clear();
+        if (peer != self) outgoing[peer] = summary;
+    }
+
+    float margin = haloMargin;
+    if (collisions && margin <= 0.0f) {
+        for (float radius : simulation.matters.radius) margin = std::max(margin, 2.0f * radius);
+    }
+    if (collisions) {
+        packHalo(margin);
+    }
+    else {
+        for (int peer = 0; peer < domains; ++peer) {
+            if (peer != self) put(outgoing[peer], std::uint32_t(0));
+        }
+    }
+
+    {
+        KOSMOS_PROFILE_SCOPE("domain exchange");
+        if (!transport.exchange(outgoing, incoming)) return false;
+    }
+
+    // Зведення сусідів стають зовнішніми масами; гало лишається в повідомленні до зіткнень
+    GravitySolver& gravity = simulation.gravity;
+    gravity.externalX.clear();
+    gravity.externalY.clear();
+    gravity.externalMass.clear();
+    std::vector<std::size_t> haloStart(domains, 0);
+    std::uint64_t halo = 0;
+    for (int peer = 0; peer < domains; ++peer) {
+        if (peer == self) continue;
+        MessageReader reader(incoming[peer]);
+        std::uint32_t cells = 0;
+        if (!reader.get(cells)) return false;
+        for (std::uint32_t c = 0; c < cells; ++c) {
+            float x, y, mass;
+            if (!reader.get(x) || !reader.get(y) || !reader.get(mass)) return false;
+            gravity.externalX.push_back(x);
+            gravity.externalY.push_back(y);
+            gravity.externalMass.push_back(mass);
+        }
+        haloStart[peer] = reader.position;
+        std::uint32_t count = 0;
+        if (!reader.get(count) || incoming[peer].size() - reader.position < count * sizeof(HaloBody)) return false;
+        halo += count;
+    }
+    haloBodies += halo;
+
+    // Без гало зіткнення всередині домену ідуть звичайним шляхом кроку
+    if (collisions && halo > 0) {
+        resolveCollisions(haloStart);
+        simulation.collisionHandlingActive = false;
+    }
+    simulation.step(deltaTime);
+    simulation.collisionHandlingActive = collisions;
+
+    return migrate();
+}
+
+bool DomainWorker::migrate() {
+    KOSMOS_PROFILE_SCOPE("domain migrate");
+    const int self = transport.rank();
+    const int domains = transport.size();
+    MatterStore& matters = simulation.matters;
+
+    std::vector<std::uint32_t> counts(domains, 0);
+    leaving.clear();
+    std::vector<int> owners;
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        if (owns(matters.posX[i], matters.posY[i])) continue;
+        const int owner = layout.domainOf(matters.posX[i], matters.posY[i]);
+        if (owner == self) continue;
+        leaving.push_back(static_cast<std::uint32_t>(i));
+        owners.push_back(owner);
+        ++counts[owner];
+    }
+
+    for (int peer = 0; peer < domains; ++peer) {
+        outgoing[peer].clear();
+        if (peer != self) put(outgoing[peer], counts[peer]);
+    }
+    for (std::size_t k = 0; k < leaving.size(); ++k) {
+        const std::uint32_t i = leaving[k];
+        MigrantBody body = {
+            matters.posX[i], matters.posY[i], matters.velX[i], matters.velY[i], matters.accX[i], matters.accY[i],
+            matters.mass[i], matters.radius[i], matters.isColony[i], matters.hasShip[i]
+        };
+        put(outgoing[owners[k]], body);
+    }
+
+    if (!transport.exchange(outgoing, incoming)) return false;
+
+    simulation.removeMatters(leaving);
+    migrated += leaving.size();
+
+    // Прибулі тіла - у порядку рангів, тож стан не залежить від того, хто відповів першим
+    bool arrived = false;
+    for (int peer = 0; peer < domains; ++peer) {
+        if (peer == self) continue;
+        MessageReader reader(incoming[peer]);
+        std::uint32_t count = 0;
+        if (!reader.get(count)) return false;
+        MigrantBody body;
+        for (std::uint32_t k = 0; k < count; ++k) {
+            if (!reader.get(body)) return false;
+            const std::size_t index = matters.add(body.radius, body.mass, Vec2(body.posX, body.posY), Vec2(body.velX, body.velY));
+            matters.accX[index] = body.accX;
+            matters.accY[index] = body.accY;
+            matters.isColony[index] = body.isColony;
+            matters.hasShip[index] = body.hasShip;
+            arrived = true;
+        }
+    }
+    if (arrived) simulation.mattersAdded();
+    return true;
+}
+
+bool sendReport(DomainTransport& transport, const DomainReport& report) {
+    std::vector<unsigned char> message;
+    put(message, report);
+    return transport.send(transport.coordinator(), message);
+}
+
+bool receiveReport(DomainTransport& transport, int domain, DomainReport& report) {
+    std::vector<unsigned char> message;
+    if (!transport.receive(domain, message)) return false;
+    MessageReader reader(message);
+    return reader.get(report);
+}
+
+#ifdef _WIN32
+
+int forkDomainProcesses(int, UnixSocketTransport&, std::vector<int>&) {
+    std::cerr << "Error: Domain processes are only supported on POSIX systems." << std::endl;
+    return -1;
+}
+
+bool waitDomainProcesses(const std::vector<int>&) {
+    return false;
+}
+
+#else
+
+int forkDomainProcesses(int domains, UnixSocketTransport& transport, std::vector<int>& children) {
+    if (!transport.create(domains)) return -1;
+
+    // Інакше буфер виводу, не скинутий до fork, надрукувала б кожна копія
+    std::cout.flush();
+    std::cerr.flush();
+    for (int rank = 0; rank < domains; ++rank) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Error: Could not start the process for domain " << rank << "." << std::endl;
+            return -1;
+        }
+        if (pid == 0) {
+            transport.bind(rank);
+            return rank;
+        }
+        children.push_back(static_cast<int>(pid));
+    }
+    transport.bind(domains);
+    return domains;
+}
+
+bool waitDomainProcesses(const std::vector<int>& children) {
+    bool succeeded = true;
+    for (int child : children) {
+        int status = 0;
+        if (waitpid(static_cast<pid_t>(child), &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) succeeded = false;
+    }
+    return succeeded;
+}
+
+#endif
@@ -0,0 +1,110 @@
+﻿#ifndef DOMAIN_DECOMPOSITION_HPP
+#define DOMAIN_DECOMPOSITION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DomainTransport.hpp"
+#include "Simulation.hpp"
+
+// Розподілений режим: диск ділиться на домени (кутові сектори навколо чорної діри x кільця),
+// кожен домен - окремий процес зі своєю Simulation і тими самими ядрами гравітації, зіткнень
+// і колонізації. Домени обмінюються через DomainTransport:
+//  - зведенням гравітації: маси й центри мас комірок грубої сітки над своїми тілами;
+//  - гало: копіями тіл біля межі, щоб зіткнення через межу не губились;
+//  - тілами, що після кроку перейшли в чужий домен (разом із прискореннями, тож leapfrog не збивається).
+// Кораблі лишаються в домені, де стартували, і обирають цілі серед його тіл.
+
+struct DomainLayout {
+    Vec2 center;
+    int sectors = 1;
+    std::vector<float> ringRadii; // межі між кільцями, за зростанням (кілець на одне більше)
+
+    int count() const { return sectors * static_cast<int>(ringRadii.size() + 1); }
+    int domainOf(float x, float y) const;
+};
+
+// Межі кілець за квантилями відстані до center, щоб кільця мали порівну тіл
+DomainLayout balanceDomains(const MatterStore& matters, const Vec2& center, int sectors, int rings);
+
+class DomainWorker {
+public:
+    DomainWorker(Simulation& simulation, const DomainLayout& layout, DomainTransport& transport);
+
+    // Лишає в симуляції лише тіла свого домену (на старті, коли всі процеси мають однаковий стан)
+    void keepOwnMatters();
+
+    // Крок домену: обмін зведеннями й гало, крок Simulation, перенесення тіл. false - транспорт зламався
+    bool step(float deltaTime);
+
+    int summaryGrid = 16;     // комірок зведення гравітації на бік (над рамкою тіл домену)
+    float haloMargin = 0.0f;  // ширина гало; 0 - два найбільші радіуси
+
+    std::uint64_t migrated = 0;   // тіл, відданих іншим доменам
+    std::uint64_t haloBodies = 0; // отриманих копій тіл із гало
+
+private:
+    // Швидка перевірка свого домену (два векторні добутки й радіус); на межі точніше рахує domainOf
+    bool owns(float x, float y) const {
+        const float dx = x - layout.center.x;
+        const float dy = y - layout.center.y;
+        const float distance2 = dx * dx + dy * dy;
+        return distance2 >= inner2 && distance2 < outer2
+            && (layout.sectors == 1 || (startX * dy - startY * dx >= 0.0f && dx * endY - dy * endX > 0.0f));
+    }
+
+    // Межі домену: промені сектора й радіуси кільця
+    struct DomainBounds {
+        float startX, startY, endX, endY;
+        float inner, outer;
+    };
+    // Відстань від точки до домену (0 - всередині)
+    float distanceTo(const DomainBounds& bounds, float x, float y) const;
+
+    void packSummary(std::vector<unsigned char>& out);
+    void packHalo(float margin);
+    void resolveCollisions(const std::vector<std::size_t>& haloStart);
+    bool migrate();
+
+    Simulation& simulation;
+    DomainLayout layout;
+    DomainTransport& transport;
+    std::vector<std::vector<unsigned char>> outgoing;
+    std::vector<std::vector<unsigned char>> incoming;
+    std::vector<unsigned char> summary;
+    MatterStore combined; // свої тіла + гало для зіткнень
+    std::vector<std::uint32_t> leaving;
+    std::vector<DomainBounds> bounds; // усіх доменів, за рангом
+
+    // Свій домен: промені меж сектора й квадрати радіусів кільця
+    float startX = 1.0f;
+    float startY = 0.0f;
+    float endX = 1.0f;
+    float endY = 0.0f;
+    float inner2 = 0.0f;
+    float outer2 = 0.0f;
+};
+
+// Підсумок домену для координатора
+struct DomainReport {
+    double seconds = 0.0;
+    std::uint64_t bodies = 0;
+    std::uint64_t ships = 0;
+    std::uint64_t colonies = 0;
+    std::uint64_t shipArrivals = 0;
+    std::uint64_t bodySteps = 0;
+    std::uint64_t migrated = 0;
+    std::uint64_t haloBodies = 0;
+    std::uint64_t stateHash = 0;
+};
+
+bool sendReport(DomainTransport& transport, const DomainReport& report);
+bool receiveReport(DomainTransport& transport, int domain, DomainReport& report);
+
+// Процес на кожен домен (fork), з'єднані transport. Повертає ранг домену в дочірньому процесі,
+// transport.coordinator() у батьківському і -1, якщо запустити не вдалось
+int forkDomainProcesses(int domains, UnixSocketTransport& transport, std::vector<int>& children);
+// Чекає на дочірні процеси; true, якщо всі завершились успішно
+bool waitDomainProcesses(const std::vector<int>& children);
+
+#endif
@@ -0,0 +1,222 @@
+﻿#include "DomainTransport.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+UnixSocketTransport::~UnixSocketTransport() {
+    closeAll();
+}
+
+#ifdef _WIN32
+
+bool UnixSocketTransport::create(int) {
+    std::cerr << "Error: Domain processes need Unix sockets, which this build does not have." << std::endl;
+    return false;
+}
+
+void UnixSocketTransport::bind(int rank) {
+    self = rank;
+}
+
+void UnixSocketTransport::closeAll() {
+}
+
+bool UnixSocketTransport::send(int, const std::vector<unsigned char>&) {
+    return false;
+}
+
+bool UnixSocketTransport::receive(int, std::vector<unsigned char>&) {
+    return false;
+}
+
+bool UnixSocketTransport::exchange(const std::vector<std::vector<unsigned char>>&, std::vector<std::vector<unsigned char>>&) {
+    return false;
+}
+
+#else
+
+namespace {
+
+// Кадр: довжина (std::uint64_t, порядок байтів машини - обидва кінці на ній) і байти повідомлення
+typedef std::uint64_t FrameHeader;
+
+bool writeAll(int descriptor, const unsigned char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(descriptor, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int descriptor, unsigned char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t got = ::recv(descriptor, data, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+// Стан одного напрямку обміну: спершу заголовок, потім тіло кадру
+struct Transfer {
+    FrameHeader header = 0;
+    std::size_t done = 0; // байтів заголовка + тіла
+    bool finished = false;
+};
+
+}
+
+bool UnixSocketTransport::create(int count) {
+    closeAll();
+    domains = count;
+    const int ranks = count + 1;
+    ends.assign(static_cast<std::size_t>(ranks) * ranks, -1);
+    for (int a = 0; a < ranks; ++a) {
+        for (int b = a + 1; b < ranks; ++b) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                std::cerr << "Error: Could not create a socket pair for domain " << a << "." << std::endl;
+                closeAll();
+                return false;
+            }
+            ends[static_cast<std::size_t>(a) * ranks + b] = pair[0];
+            ends[static_cast<std::size_t>(b) * ranks + a] = pair[1];
+        }
+    }
+    return true;
+}
+
+void UnixSocketTransport::bind(int rank) {
+    self = rank;
+    const int ranks = domains + 1;
+    for (int from = 0; from < ranks; ++from) {
+        if (from == rank) continue;
+        for (int to = 0; to < ranks; ++to) {
+            int& descriptor = ends[static_cast<std::size_t>(from) * ranks + to];
+            if (descriptor >= 0) ::close(descriptor);
+            descriptor = -1;
+        }
+    }
+}
+
+void UnixSocketTransport::closeAll() {
+    for (int descriptor : ends) {
+        if (descriptor >= 0) ::close(descriptor);
+    }
+    ends.clear();
+}
+
+bool UnixSocketTransport::send(int peer, const std::vector<unsigned char>& message) {
+    const FrameHeader header = message.size();
+    const int descriptor = endpoint(self, peer);
+    return writeAll(descriptor, reinterpret_cast<const unsigned char*>(&header), sizeof(header))
+        && writeAll(descriptor, message.data(), message.size());
+}
+
+bool UnixSocketTransport::receive(int peer, std::vector<unsigned char>& message) {
+    FrameHeader header = 0;
+    const int descriptor = endpoint(self, peer);
+    if (!readAll(descriptor, reinterpret_cast<unsigned char*>(&header), sizeof(header))) return false;
+    message.resize(static_cast<std::size_t>(header));
+    return readAll(descriptor, message.data(), message.size());
+}
+
+bool UnixSocketTransport::exchange(const std::vector<std::vector<unsigned char>>& outgoing, std::vector<std::vector<unsigned char>>& incoming) {
+    incoming.resize(domains);
+    std::vector<Transfer> sending(domains);
+    std::vector<Transfer> receiving(domains);
+    std::vector<pollfd> polls;
+    std::vector<int> pollPeers;
+    int remaining = 0;
+
+    for (int peer = 0; peer < domains; ++peer) {
+        if (peer == self) continue;
+        sending[peer].header = outgoing[peer].size();
+        incoming[peer].clear();
+        remaining += 2;
+    }
+
+    // Неблокуючі send/recv по всіх сусідах разом: буфер сокета не вміщає великий кадр,
+    // і два домени, що одночасно лише пишуть один одному, інакше чекали б вічно
+    while (remaining > 0) {
+        polls.clear();
+        pollPeers.clear();
+        for (int peer = 0; peer < domains; ++peer) {
+            if (peer == self) continue;
+            short events = 0;
+            if (!sending[peer].finished) events |= POLLOUT;
+            if (!receiving[peer].finished) events |= POLLIN;
+            if (events == 0) continue;
+            pollfd entry = { endpoint(self, peer), events, 0 };
+            polls.push_back(entry);
+            pollPeers.push_back(peer);
+        }
+        if (::poll(polls.data(), polls.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        for (std::size_t p = 0; p < polls.size(); ++p) {
+            const int peer = pollPeers[p];
+            const int descriptor = polls[p].fd;
+            if (polls[p].revents & (POLLERR | POLLNVAL)) return false;
+
+            Transfer& out = sending[peer];
+            if (!out.finished && (polls[p].revents & POLLOUT)) {
+                const std::vector<unsigned char>& message = outgoing[peer];
+                const std::size_t total = sizeof(FrameHeader) + message.size();
+                const unsigned char* from = out.done < sizeof(FrameHeader)
+                    ? reinterpret_cast<const unsigned char*>(&out.header) + out.done
+                    : message.data() + (out.done - sizeof(FrameHeader));
+                const std::size_t size = out.done < sizeof(FrameHeader) ? sizeof(FrameHeader) - out.done : total - out.done;
+                ssize_t written = ::send(descriptor, from, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+                if (written > 0) out.done += static_cast<std::size_t>(written);
+                if (out.done == total) {
+                    out.finished = true;
+                    --remaining;
+                }
+            }
+
+            Transfer& in = receiving[peer];
+            if (!in.finished && (polls[p].revents & (POLLIN | POLLHUP))) {
+                std::vector<unsigned char>& message = incoming[peer];
+                unsigned char* to = in.done < sizeof(FrameHeader)
+                    ? reinterpret_cast<unsigned char*>(&in.header) + in.done
+                    : message.data() + (in.done - sizeof(FrameHeader));
+                const std::size_t size = in.done < sizeof(FrameHeader)
+                    ? sizeof(FrameHeader) - in.done
+                    : sizeof(FrameHeader) + message.size() - in.done;
+                ssize_t got = ::recv(descriptor, to, size, MSG_DONTWAIT);
+                if (got == 0) return false; // сусід завершився посеред обміну
+                if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+                if (got > 0) {
+                    const bool hadHeader = in.done >= sizeof(FrameHeader);
+                    in.done += static_cast<std::size_t>(got);
+                    if (!hadHeader && in.done == sizeof(FrameHeader)) message.resize(static_cast<std::size_t>(in.header));
+                }
+                if (in.done >= sizeof(FrameHeader) && in.done == sizeof(FrameHeader) + message.size()) {
+                    in.finished = true;
+                    --remaining;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+﻿#ifndef DOMAIN_TRANSPORT_HPP
+#define DOMAIN_TRANSPORT_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Транспорт між процесами-доменами. Домени мають ранги 0..size()-1, координатор - ранг size().
+// Повідомлення - цілі буфери байтів; порядок повідомлень між двома рангами зберігається.
+// Реалізація підміняється (сокети Unix зараз, TCP чи спільна пам'ять пізніше), DomainWorker
+// бачить лише цей інтерфейс.
+class DomainTransport {
+public:
+    virtual ~DomainTransport() {}
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0; // доменів, без координатора
+    int coordinator() const { return size(); }
+
+    virtual bool send(int peer, const std::vector<unsigned char>& message) = 0;
+    virtual bool receive(int peer, std::vector<unsigned char>& message) = 0;
+
+    // Обмін "усі з усіма" між доменами: outgoing[peer] іде до peer, incoming[peer] приходить від нього.
+    // Власний ранг пропускається. Відправлення й отримання йдуть разом, тож великі буфери не блокують одне одного
+    virtual bool exchange(const std::vector<std::vector<unsigned char>>& outgoing, std::vector<std::vector<unsigned char>>& incoming) = 0;
+};
+
+// Пари сокетів Unix між усіма рангами (домени + координатор) на одній машині.
+// Створюється до fork; кожен процес потім забирає свої кінці й закриває решту
+class UnixSocketTransport : public DomainTransport {
+public:
+    UnixSocketTransport() {}
+    ~UnixSocketTransport();
+
+    UnixSocketTransport(const UnixSocketTransport&) = delete;
+    UnixSocketTransport& operator=(const UnixSocketTransport&) = delete;
+
+    // Усі пари для domains доменів і координатора
+    bool create(int domains);
+    // Лишає кінці рангу rank (після fork)
+    void bind(int rank);
+
+    int rank() const override { return self; }
+    int size() const override { return domains; }
+
+    bool send(int peer, const std::vector<unsigned char>& message) override;
+    bool receive(int peer, std::vector<unsigned char>& message) override;
+    bool exchange(const std::vector<std::vector<unsigned char>>& outgoing, std::vector<std::vector<unsigned char>>& incoming) override;
+
+private:
+    void closeAll();
+    int endpoint(int from, int to) const { return ends[static_cast<std::size_t>(from) * (domains + 1) + to]; }
+
+    int domains = 0;
+    int self = -1;
+    std::vector<int> ends; // ends[from * (domains + 1) + to] - дескриптор from для зв'язку з to
+};
+
+#endif
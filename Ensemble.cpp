@@ -0,0 +1,261 @@
+﻿#include "Ensemble.hpp"
+#include "JobSystem.hpp"
+#include "Simulation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace {
+
+// Ті самі параметри, що й у вікні 1800x1600
+const Vec2 blackHolePosition(900.0f, 800.0f);
+const float blackHoleMass = 500.0f;
+
+// Більше прогонів в одному описі - майже напевно помилка в діапазоні
+const std::size_t maxRuns = 1000000;
+
+std::string trim(const std::string& text) {
+    const std::size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return std::string();
+    const std::size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool parseInteger(const std::string& text, long long minimum, long long& value) {
+    char* end = nullptr;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return end != text.c_str() && *end == '\0' && value >= minimum;
+}
+
+bool parseFloat(const std::string& text, float minimum, float& value) {
+    char* end = nullptr;
+    value = std::strtof(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' && value >= minimum;
+}
+
+bool parseFlag(const std::string& text, bool& value) {
+    if (text == "1" || text == "true" || text == "on") value = true;
+    else if (text == "0" || text == "false" || text == "off") value = false;
+    else return false;
+    return true;
+}
+
+struct SweepKey {
+    const char* name;
+    bool (*apply)(EnsembleRun& run, const std::string& value);
+};
+
+const SweepKey sweepKeys[] = {
+    { "bodies", [](EnsembleRun& r, const std::string& v) { long long n; return parseInteger(v, 1, n) && n <= 0x7FFFFFFF && (r.bodies = static_cast<int>(n), true); } },
+    { "ticks", [](EnsembleRun& r, const std::string& v) { long long n; return parseInteger(v, 1, n) && n <= 0x7FFFFFFF && (r.ticks = static_cast<int>(n), true); } },
+    { "dt", [](EnsembleRun& r, const std::string& v) { return parseFloat(v, 0.0f, r.deltaTime) && r.deltaTime > 0.0f; } },
+    { "gravity-multiplier", [](EnsembleRun& r, const std::string& v) { return parseFloat(v, 0.0f, r.gravityMultiplier); } },
+    { "speed-multiplier", [](EnsembleRun& r, const std::string& v) { return parseFloat(v, 0.0f, r.speedMultiplier); } },
+    { "deletion-radius", [](EnsembleRun& r, const std::string& v) { return parseFloat(v, 0.0f, r.deletionRadius); } },
+    { "seed", [](EnsembleRun& r, const std::string& v) { long long n; return parseInteger(v, 0, n) && (r.seed = static_cast<std::uint64_t>(n), true); } },
+    { "profile", [](EnsembleRun& r, const std::string& v) { return parseRadialProfile(v.c_str(), r.profile); } },
+    { "collisions", [](EnsembleRun& r, const std::string& v) { return parseFlag(v, r.collisions); } },
+    { "colonize", [](EnsembleRun& r, const std::string& v) { return parseFlag(v, r.colonize); } },
+};
+
+const SweepKey* findSweepKey(const std::string& name) {
+    for (const SweepKey& key : sweepKeys) {
+        if (name == key.name) return &key;
+    }
+    return nullptr;
+}
+
+// Значення через кому; "a..b" - усі цілі від a до b
+bool splitValues(const std::string& text, std::vector<std::string>& values) {
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        std::size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        const std::string value = trim(text.substr(start, comma - start));
+        start = comma + 1;
+        if (value.empty()) return false;
+
+        const std::size_t dots = value.find("..");
+        if (dots == std::string::npos) {
+            values.push_back(value);
+            continue;
+        }
+        long long first, last;
+        if (!parseInteger(trim(value.substr(0, dots)), 0, first) || !parseInteger(trim(value.substr(dots + 2)), first, last)
+            || last - first >= static_cast<long long>(maxRuns)) {
+            return false;
+        }
+        for (long long v = first; v <= last; ++v) values.push_back(std::to_string(v));
+    }
+    return true;
+}
+
+void sample(const Simulation& simulation, double seconds, EnsembleResult& result) {
+    EnsembleSample s;
+    s.tick = simulation.tick;
+    s.time = simulation.time;
+    s.bodies = simulation.matters.size();
+    for (std::uint8_t colony : simulation.matters.isColony) s.colonies += colony;
+    s.shipArrivals = simulation.shipArrivals;
+    s.seconds = seconds;
+    result.samples.push_back(s);
+}
+
+void runOne(const EnsembleRun& run, int sampleEvery, EnsembleResult& result) {
+    // Паралельні прогони, а не фази всередині них: без синхронізації на кожному кроці
+    SerialJobScope serial;
+
+    Simulation simulation(blackHolePosition, blackHoleMass, run.deletionRadius);
+    simulation.gravityMultiplier = run.gravityMultiplier;
+    simulation.collisionHandlingActive = run.collisions;
+
+    MatterGenerator generator(blackHolePosition, blackHoleMass, run.seed);
+    generator.profile = run.profile;
+    generator.speedMultiplier = run.speedMultiplier;
+    simulation.matters = generator.generateMatter(static_cast<std::size_t>(run.bodies));
+    result.initialBodies = simulation.matters.size();
+
+    if (run.colonize && !simulation.matters.empty()) {
+        simulation.makeColony(0);
+        simulation.createShip(0);
+        simulation.colonizationActive = true;
+    }
+
+    result.samples.clear();
+    sample(simulation, 0.0, result);
+    const auto start = std::chrono::steady_clock::now();
+    for (int tick = 1; tick <= run.ticks; ++tick) {
+        simulation.step(run.deltaTime);
+        if (tick % sampleEvery == 0 || tick == run.ticks) {
+            sample(simulation, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), result);
+        }
+    }
+}
+
+}
+
+bool readSweep(const std::string& path, EnsembleSweep& sweep) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: Could not open sweep " << path << std::endl;
+        return false;
+    }
+
+    // Осі перебору в порядку файла; остання змінюється найшвидше
+    std::vector<const SweepKey*> axes;
+    std::vector<std::vector<std::string>> axisValues;
+    sweep = EnsembleSweep();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        const std::size_t equals = line.find('=');
+        const std::string name = equals == std::string::npos ? line : trim(line.substr(0, equals));
+        std::vector<std::string> values;
+        if (equals == std::string::npos || !splitValues(line.substr(equals + 1), values)) {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": expected key = value[, value...]" << std::endl;
+            return false;
+        }
+
+        if (name == "sample-every") {
+            long long every;
+            if (values.size() != 1 || !parseInteger(values[0], 1, every) || every > 0x7FFFFFFF) {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": sample-every takes one positive number" << std::endl;
+                return false;
+            }
+            sweep.sampleEvery = static_cast<int>(every);
+            continue;
+        }
+
+        const SweepKey* key = findSweepKey(name);
+        if (!key) {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": unknown key " << name << std::endl;
+            return false;
+        }
+        // Значення перевіряються одразу, щоб помилка вказувала на рядок
+        EnsembleRun probe;
+        for (const std::string& value : values) {
+            if (!key->apply(probe, value)) {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": bad value " << value << " for " << name << std::endl;
+                return false;
+            }
+        }
+        if (std::find(axes.begin(), axes.end(), key) != axes.end()) {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": " << name << " is given twice" << std::endl;
+            return false;
+        }
+        axes.push_back(key);
+        axisValues.push_back(values);
+    }
+
+    std::size_t total = 1;
+    for (const auto& values : axisValues) {
+        if (total > maxRuns / values.size()) {
+            std::cerr << "Error: " << path << " describes more than " << maxRuns << " runs" << std::endl;
+            return false;
+        }
+        total *= values.size();
+    }
+
+    sweep.runs.resize(total);
+    for (std::size_t index = 0; index < total; ++index) {
+        std::size_t rest = index;
+        for (std::size_t axis = axes.size(); axis-- > 0;) {
+            const std::size_t count = axisValues[axis].size();
+            axes[axis]->apply(sweep.runs[index], axisValues[axis][rest % count]);
+            rest /= count;
+        }
+    }
+    return true;
+}
+
+void runEnsemble(const EnsembleSweep& sweep, std::vector<EnsembleResult>& results) {
+    results.assign(sweep.runs.size(), EnsembleResult());
+
+    // Найдовші прогони - першими, щоб у кінці потоки не чекали на один великий
+    std::vector<std::size_t> order(sweep.runs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        const EnsembleRun& ra = sweep.runs[a];
+        const EnsembleRun& rb = sweep.runs[b];
+        return static_cast<double>(ra.bodies) * ra.ticks > static_cast<double>(rb.bodies) * rb.ticks;
+    });
+
+    JobSystem& jobs = JobSystem::instance();
+    JobGroup group;
+    for (std::size_t index : order) {
+        jobs.run(group, [&sweep, &results, index] { runOne(sweep.runs[index], sweep.sampleEvery, results[index]); });
+    }
+    jobs.wait(group);
+}
+
+bool writeEnsembleCsv(const std::string& path, const EnsembleSweep& sweep, const std::vector<EnsembleResult>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    out << "run,bodies,ticks,dt,gravity_multiplier,speed_multiplier,deletion_radius,seed,profile,collisions,colonize,"
+           "tick,time,bodies_left,swallowed,colonies,colonized_fraction,ship_arrivals,steps_per_second\n";
+    for (std::size_t i = 0; i < sweep.runs.size(); ++i) {
+        const EnsembleRun& run = sweep.runs[i];
+        const EnsembleResult& result = results[i];
+        for (const EnsembleSample& s : result.samples) {
+            // Частка колоній серед тіл, що ще лишились; поглинуті - усі зниклі тіла (інших видалень немає)
+            const double fraction = s.bodies > 0 ? static_cast<double>(s.colonies) / s.bodies : 0.0;
+            const double stepsPerSecond = s.seconds > 0.0 ? s.tick / s.seconds : 0.0;
+            out << i << "," << run.bodies << "," << run.ticks << "," << run.deltaTime << "," << run.gravityMultiplier << ","
+                << run.speedMultiplier << "," << run.deletionRadius << "," << run.seed << "," << radialProfileName(run.profile) << ","
+                << run.collisions << "," << run.colonize << ","
+                << s.tick << "," << s.time << "," << s.bodies << "," << result.initialBodies - s.bodies << "," << s.colonies << ","
+                << fraction << "," << s.shipArrivals << "," << stepsPerSecond << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
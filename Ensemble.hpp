@@ -0,0 +1,66 @@
+﻿#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MatterGenerator.hpp"
+
+// Ансамбль незалежних прогонів для перебору параметрів (замість ручних пресетів Num1-Num6).
+// Опис перебору - текстовий файл "ключ = значення, значення, ..." (# - коментар, a..b - цілі від a до b):
+//
+//     bodies = 2000, 5000
+//     gravity-multiplier = 16, 70.5, 100
+//     speed-multiplier = 2.5, 3, 3.5
+//     seed = 1..8
+//     ticks = 2000
+//     sample-every = 100
+//
+// Прогони - усі комбінації значень. Кожен прогін - одне завдання на спільному пулі JobSystem і крокує
+// послідовно всередині нього, тож паралельні самі прогони, а не їхні фази. Прогін залежить лише від
+// своїх параметрів і seed, тож результати однакові за будь-якої кількості потоків; прогони з однаковим
+// seed стартують з однакових тіл, і різниця між ними - лише від параметрів.
+
+struct EnsembleRun {
+    int bodies = 7560;
+    int ticks = 1000;
+    float deltaTime = 1.0f / 60.0f;
+    float gravityMultiplier = 70.5f;
+    float speedMultiplier = 3.0f; // орбітальна швидкість генератора (MatterGenerator::speedMultiplier)
+    float deletionRadius = 100.0f;
+    std::uint64_t seed = defaultGeneratorSeed;
+    RadialProfile profile = RadialProfile::Annulus;
+    bool collisions = false;
+    bool colonize = true; // перша колонія - тіло 0, як у headless
+};
+
+struct EnsembleSweep {
+    std::vector<EnsembleRun> runs;
+    int sampleEvery = 100; // тактів між замірами (і завжди в кінці)
+};
+
+// Стан прогону після такту tick
+struct EnsembleSample {
+    std::uint64_t tick = 0;
+    double time = 0.0;
+    std::size_t bodies = 0;
+    std::size_t colonies = 0;
+    std::uint64_t shipArrivals = 0;
+    double seconds = 0.0; // час кроків від початку прогону
+};
+
+struct EnsembleResult {
+    std::vector<EnsembleSample> samples;
+    std::size_t initialBodies = 0;
+};
+
+bool readSweep(const std::string& path, EnsembleSweep& sweep);
+
+// Усі прогони на пулі JobSystem; results[i] відповідає sweep.runs[i]
+void runEnsemble(const EnsembleSweep& sweep, std::vector<EnsembleResult>& results);
+
+// Один рядок на замір: параметри прогону, частка колоній, поглинуті тіла й кроки за секунду
+bool writeEnsembleCsv(const std::string& path, const EnsembleSweep& sweep, const std::vector<EnsembleResult>& results);
+
+#endif
@@ -0,0 +1,586 @@
+﻿#include "GravityKernels.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KOSMOS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang компілюють векторні функції з атрибутом target, решта файлу лишається базовою
+#if defined(__GNUC__) || defined(__clang__)
+#define KOSMOS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KOSMOS_TARGET(isa)
+#endif
+
+namespace {
+
+// Kill - чи перевіряти зону знищення: обидва варіанти кожного ядра компілюються окремо,
+// тож у гарячому циклі немає перевірки списку на кожне тіло
+template <bool Kill>
+void kickDriftScalar(float* posX, float* posY, float* velX, float* velY, std::size_t begin, std::size_t end,
+                     float holeX, float holeY, float pullStep, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    for (std::size_t i = begin; i < end; ++i) {
+        float dx = holeX - posX[i];
+        float dy = holeY - posY[i];
+        float distance2 = dx * dx + dy * dy;
+        float scale = pullStep / (distance2 * std::sqrt(distance2));
+        velX[i] += dx * scale;
+        velY[i] += dy * scale;
+        posX[i] += velX[i] * deltaTime;
+        posY[i] += velY[i] * deltaTime;
+
+        if constexpr (Kill) {
+            float kx = holeX - posX[i];
+            float ky = holeY - posY[i];
+            if (kx * kx + ky * ky < killRadius2) killed->push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+}
+
+template <bool Kill>
+void leapfrogScalar(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t begin, std::size_t end,
+                    float holeX, float holeY, float pullMass, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    const float halfStep = 0.5f * deltaTime;
+    for (std::size_t i = begin; i < end; ++i) {
+        float vx = velX[i] + accX[i] * halfStep;
+        float vy = velY[i] + accY[i] * halfStep;
+        float x = posX[i] + vx * deltaTime;
+        float y = posY[i] + vy * deltaTime;
+
+        float dx = holeX - x;
+        float dy = holeY - y;
+        float distance2 = dx * dx + dy * dy;
+        float scale = pullMass / (distance2 * std::sqrt(distance2));
+        float ax = dx * scale;
+        float ay = dy * scale;
+
+        posX[i] = x;
+        posY[i] = y;
+        velX[i] = vx + ax * halfStep;
+        velY[i] = vy + ay * halfStep;
+        accX[i] = ax;
+        accY[i] = ay;
+
+        if constexpr (Kill) {
+            if (distance2 < killRadius2) killed->push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+}
+
+// Суцільні шматки (kernel(chunk, begin, end)) на пулі JobSystem: по кілька на потік, вирівняні на 16 елементів,
+// щоб вектори не ділили кеш-лінії між потоками. Межі залежать лише від count і кількості потоків пулу,
+// а тіла незалежні, тож результат від розбиття не залежить. name - фаза профайлера для кожного шматка
+template <class Kernel>
+void forEachChunk(const char* name, std::size_t count, KillList* kill, Kernel&& kernel) {
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+    if (kill) kill->prepare((count + grain - 1) / grain);
+    jobs.parallelFor(count, grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        KOSMOS_PROFILE_SCOPE(name);
+        kernel(chunk, begin, end);
+    });
+    if (kill) kill->gather();
+}
+
+#ifdef KOSMOS_X86
+
+// Індекси тіл із встановленими бітами маски векторного порівняння
+void pushLanes(std::vector<std::uint32_t>& killed, std::size_t base, unsigned bits, int lanes) {
+    for (int lane = 0; lane < lanes; ++lane) {
+        if (bits & (1u << lane)) killed.push_back(static_cast<std::uint32_t>(base + lane));
+    }
+}
+
+template <bool Kill>
+KOSMOS_TARGET("avx2,fma")
+void kickDriftAvx2(float* posX, float* posY, float* velX, float* velY, std::size_t begin, std::size_t end,
+                   float holeX, float holeY, float pullStep, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    const __m256 hx = _mm256_set1_ps(holeX);
+    const __m256 hy = _mm256_set1_ps(holeY);
+    const __m256 pull = _mm256_set1_ps(pullStep);
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(posX + i);
+        __m256 y = _mm256_loadu_ps(posY + i);
+        __m256 vx = _mm256_loadu_ps(velX + i);
+        __m256 vy = _mm256_loadu_ps(velY + i);
+
+        __m256 dx = _mm256_sub_ps(hx, x);
+        __m256 dy = _mm256_sub_ps(hy, y);
+        __m256 distance2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+        __m256 scale = _mm256_div_ps(pull, _mm256_mul_ps(distance2, _mm256_sqrt_ps(distance2)));
+
+        vx = _mm256_fmadd_ps(dx, scale, vx);
+        vy = _mm256_fmadd_ps(dy, scale, vy);
+        x = _mm256_fmadd_ps(vx, dt, x);
+        y = _mm256_fmadd_ps(vy, dt, y);
+
+        _mm256_storeu_ps(posX + i, x);
+        _mm256_storeu_ps(posY + i, y);
+        _mm256_storeu_ps(velX + i, vx);
+        _mm256_storeu_ps(velY + i, vy);
+
+        if constexpr (Kill) {
+            __m256 kx = _mm256_sub_ps(hx, x);
+            __m256 ky = _mm256_sub_ps(hy, y);
+            __m256 kill2 = _mm256_fmadd_ps(kx, kx, _mm256_mul_ps(ky, ky));
+            int bits = _mm256_movemask_ps(_mm256_cmp_ps(kill2, _mm256_set1_ps(killRadius2), _CMP_LT_OQ));
+            if (bits) pushLanes(*killed, i, static_cast<unsigned>(bits), 8);
+        }
+    }
+    kickDriftScalar<Kill>(posX, posY, velX, velY, i, end, holeX, holeY, pullStep, deltaTime, killRadius2, killed);
+}
+
+template <bool Kill>
+KOSMOS_TARGET("avx512f")
+void kickDriftAvx512(float* posX, float* posY, float* velX, float* velY, std::size_t begin, std::size_t end,
+                     float holeX, float holeY, float pullStep, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    const __m512 hx = _mm512_set1_ps(holeX);
+    const __m512 hy = _mm512_set1_ps(holeY);
+    const __m512 pull = _mm512_set1_ps(pullStep);
+    const __m512 dt = _mm512_set1_ps(deltaTime);
+
+    for (std::size_t i = begin; i < end; i += 16) {
+        // Хвіст обробляється маскою замість скалярного циклу
+        std::size_t remaining = end - i;
+        __mmask16 mask = remaining >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << remaining) - 1u);
+
+        __m512 x = _mm512_maskz_loadu_ps(mask, posX + i);
+        __m512 y = _mm512_maskz_loadu_ps(mask, posY + i);
+        __m512 vx = _mm512_maskz_loadu_ps(mask, velX + i);
+        __m512 vy = _mm512_maskz_loadu_ps(mask, velY + i);
+
+        __m512 dx = _mm512_sub_ps(hx, x);
+        __m512 dy = _mm512_sub_ps(hy, y);
+        __m512 distance2 = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+        __m512 scale = _mm512_div_ps(pull, _mm512_mul_ps(distance2, _mm512_sqrt_ps(distance2)));
+
+        vx = _mm512_fmadd_ps(dx, scale, vx);
+        vy = _mm512_fmadd_ps(dy, scale, vy);
+        x = _mm512_fmadd_ps(vx, dt, x);
+        y = _mm512_fmadd_ps(vy, dt, y);
+
+        _mm512_mask_storeu_ps(posX + i, mask, x);
+        _mm512_mask_storeu_ps(posY + i, mask, y);
+        _mm512_mask_storeu_ps(velX + i, mask, vx);
+        _mm512_mask_storeu_ps(velY + i, mask, vy);
+
+        if constexpr (Kill) {
+            __m512 kx = _mm512_sub_ps(hx, x);
+            __m512 ky = _mm512_sub_ps(hy, y);
+            __m512 kill2 = _mm512_fmadd_ps(kx, kx, _mm512_mul_ps(ky, ky));
+            __mmask16 inside = _mm512_mask_cmp_ps_mask(mask, kill2, _mm512_set1_ps(killRadius2), _CMP_LT_OQ);
+            if (inside) pushLanes(*killed, i, inside, 16);
+        }
+    }
+}
+
+template <bool Kill>
+KOSMOS_TARGET("avx2,fma")
+void leapfrogAvx2(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t begin, std::size_t end,
+                  float holeX, float holeY, float pullMass, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    const __m256 hx = _mm256_set1_ps(holeX);
+    const __m256 hy = _mm256_set1_ps(holeY);
+    const __m256 pull = _mm256_set1_ps(pullMass);
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 half = _mm256_set1_ps(0.5f * deltaTime);
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 vx = _mm256_fmadd_ps(_mm256_loadu_ps(accX + i), half, _mm256_loadu_ps(velX + i));
+        __m256 vy = _mm256_fmadd_ps(_mm256_loadu_ps(accY + i), half, _mm256_loadu_ps(velY + i));
+        __m256 x = _mm256_fmadd_ps(vx, dt, _mm256_loadu_ps(posX + i));
+        __m256 y = _mm256_fmadd_ps(vy, dt, _mm256_loadu_ps(posY + i));
+
+        __m256 dx = _mm256_sub_ps(hx, x);
+        __m256 dy = _mm256_sub_ps(hy, y);
+        __m256 distance2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+        __m256 scale = _mm256_div_ps(pull, _mm256_mul_ps(distance2, _mm256_sqrt_ps(distance2)));
+        __m256 ax = _mm256_mul_ps(dx, scale);
+        __m256 ay = _mm256_mul_ps(dy, scale);
+
+        _mm256_storeu_ps(posX + i, x);
+        _mm256_storeu_ps(posY + i, y);
+        _mm256_storeu_ps(velX + i, _mm256_fmadd_ps(ax, half, vx));
+        _mm256_storeu_ps(velY + i, _mm256_fmadd_ps(ay, half, vy));
+        _mm256_storeu_ps(accX + i, ax);
+        _mm256_storeu_ps(accY + i, ay);
+
+        if constexpr (Kill) {
+            int bits = _mm256_movemask_ps(_mm256_cmp_ps(distance2, _mm256_set1_ps(killRadius2), _CMP_LT_OQ));
+            if (bits) pushLanes(*killed, i, static_cast<unsigned>(bits), 8);
+        }
+    }
+    leapfrogScalar<Kill>(posX, posY, velX, velY, accX, accY, i, end, holeX, holeY, pullMass, deltaTime, killRadius2, killed);
+}
+
+template <bool Kill>
+KOSMOS_TARGET("avx512f")
+void leapfrogAvx512(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t begin, std::size_t end,
+                    float holeX, float holeY, float pullMass, float deltaTime, float killRadius2, std::vector<std::uint32_t>* killed) {
+    const __m512 hx = _mm512_set1_ps(holeX);
+    const __m512 hy = _mm512_set1_ps(holeY);
+    const __m512 pull = _mm512_set1_ps(pullMass);
+    const __m512 dt = _mm512_set1_ps(deltaTime);
+    const __m512 half = _mm512_set1_ps(0.5f * deltaTime);
+
+    for (std::size_t i = begin; i < end; i += 16) {
+        std::size_t remaining = end - i;
+        __mmask16 mask = remaining >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << remaining) - 1u);
+
+        __m512 vx = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, accX + i), half, _mm512_maskz_loadu_ps(mask, velX + i));
+        __m512 vy = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, accY + i), half, _mm512_maskz_loadu_ps(mask, velY + i));
+        __m512 x = _mm512_fmadd_ps(vx, dt, _mm512_maskz_loadu_ps(mask, posX + i));
+        __m512 y = _mm512_fmadd_ps(vy, dt, _mm512_maskz_loadu_ps(mask, posY + i));
+
+        __m512 dx = _mm512_sub_ps(hx, x);
+        __m512 dy = _mm512_sub_ps(hy, y);
+        __m512 distance2 = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+        __m512 scale = _mm512_div_ps(pull, _mm512_mul_ps(distance2, _mm512_sqrt_ps(distance2)));
+        __m512 ax = _mm512_mul_ps(dx, scale);
+        __m512 ay = _mm512_mul_ps(dy, scale);
+
+        _mm512_mask_storeu_ps(posX + i, mask, x);
+        _mm512_mask_storeu_ps(posY + i, mask, y);
+        _mm512_mask_storeu_ps(velX + i, mask, _mm512_fmadd_ps(ax, half, vx));
+        _mm512_mask_storeu_ps(velY + i, mask, _mm512_fmadd_ps(ay, half, vy));
+        _mm512_mask_storeu_ps(accX + i, mask, ax);
+        _mm512_mask_storeu_ps(accY + i, mask, ay);
+
+        if constexpr (Kill) {
+            __mmask16 inside = _mm512_mask_cmp_ps_mask(mask, distance2, _mm512_set1_ps(killRadius2), _CMP_LT_OQ);
+            if (inside) pushLanes(*killed, i, inside, 16);
+        }
+    }
+}
+
+bool cpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSaves = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 12)) != 0;
+    if (!osSaves || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+bool cpuSupportsAvx512() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx512f");
+#else
+    if (!cpuSupportsAvx2()) return false;
+    if ((_xgetbv(0) & 0xE6) != 0xE6) return false;
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) != 0;
+#endif
+}
+
+#endif
+
+typedef void (*LeapfrogKernel)(float*, float*, float*, float*, float*, float*, std::size_t, std::size_t,
+                               float, float, float, float, float, std::vector<std::uint32_t>*);
+
+typedef void (*KickDriftKernel)(float*, float*, float*, float*, std::size_t, std::size_t,
+                                float, float, float, float, float, std::vector<std::uint32_t>*);
+
+template <bool Kill>
+LeapfrogKernel leapfrogKernel(KernelIsa isa) {
+    switch (isa) {
+#ifdef KOSMOS_X86
+    case KernelIsa::Avx512: return leapfrogAvx512<Kill>;
+    case KernelIsa::Avx2: return leapfrogAvx2<Kill>;
+#endif
+    default: return leapfrogScalar<Kill>;
+    }
+}
+
+LeapfrogKernel leapfrogKernel(KernelIsa isa, bool kill) {
+    return kill ? leapfrogKernel<true>(isa) : leapfrogKernel<false>(isa);
+}
+
+template <bool Kill>
+KickDriftKernel kickDriftKernel(KernelIsa isa) {
+    switch (isa) {
+#ifdef KOSMOS_X86
+    case KernelIsa::Avx512: return kickDriftAvx512<Kill>;
+    case KernelIsa::Avx2: return kickDriftAvx2<Kill>;
+#endif
+    default: return kickDriftScalar<Kill>;
+    }
+}
+
+KickDriftKernel kickDriftKernel(KernelIsa isa, bool kill) {
+    return kill ? kickDriftKernel<true>(isa) : kickDriftKernel<false>(isa);
+}
+
+// Тіла обробляються блоками: якщо жодному не потрібен коротший крок, блок іде векторним ядром
+const std::size_t rungBlock = 256;
+const int maxBlockRung = 20;
+
+// ratio = (deltaTime / h_max)^4, тож рівень (поділ кроку на 2^rung) - ceil(log2(ratio) / 4).
+// Рахується з показника float без циклу; нуль, нескінченність і NaN дають 0 або maxRung
+inline int rungOf(float ratio, int maxRung) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &ratio, sizeof(bits));
+    int log2Ceil = static_cast<int>(bits >> 23) - 127 + ((bits & 0x7fffffu) != 0);
+    return std::min(std::max((log2Ceil + 3) >> 2, 0), maxRung);
+}
+
+// Власні підкроки одного тіла. Рівень перевіряється на кожній межі підкроку: дрібнішати можна
+// будь-коли, грубішати - лише на межі грубшого рівня, тож тіло приходить рівно в кінець кроку.
+// Тіло, що пірнуло в зону знищення, зупиняється там і йде в killed (якщо список є)
+std::uint64_t subcycleBody(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t i,
+                           float holeX, float holeY, float pullMass, float deltaTime, float scale, int maxRung,
+                           float killRadius2, std::vector<std::uint32_t>* killed) {
+    const std::uint32_t total = 1u << maxRung;
+    std::uint32_t tick = 0;
+    std::uint64_t steps = 0;
+    while (tick < total) {
+        float dx = holeX - posX[i];
+        float dy = holeY - posY[i];
+        int rung = rungOf(scale * (accX[i] * accX[i] + accY[i] * accY[i]) / (dx * dx + dy * dy), maxRung);
+        while ((tick & ((total >> rung) - 1)) != 0) ++rung;
+        const std::uint32_t span = total >> rung;
+
+        leapfrogScalar<false>(posX, posY, velX, velY, accX, accY, i, i + 1, holeX, holeY, pullMass, deltaTime * span / total, 0.0f, nullptr);
+        tick += span;
+        ++steps;
+
+        if (killed) {
+            float kx = holeX - posX[i];
+            float ky = holeY - posY[i];
+            if (kx * kx + ky * ky < killRadius2) {
+                killed->push_back(static_cast<std::uint32_t>(i));
+                break;
+            }
+        }
+    }
+    return steps;
+}
+
+}
+
+bool kernelIsaSupported(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Reference:
+    case KernelIsa::Scalar:
+        return true;
+#ifdef KOSMOS_X86
+    case KernelIsa::Avx2:
+        return cpuSupportsAvx2();
+    case KernelIsa::Avx512:
+        return cpuSupportsAvx512();
+#endif
+    default:
+        return false;
+    }
+}
+
+KernelIsa detectKernelIsa() {
+    static const KernelIsa detected =
+        kernelIsaSupported(KernelIsa::Avx512) ? KernelIsa::Avx512 :
+        kernelIsaSupported(KernelIsa::Avx2) ? KernelIsa::Avx2 : KernelIsa::Scalar;
+    return detected;
+}
+
+const char* kernelIsaName(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Reference: return "reference";
+    case KernelIsa::Scalar: return "scalar";
+    case KernelIsa::Avx2: return "avx2";
+    case KernelIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool parseKernelIsa(const char* name, KernelIsa& isa) {
+    const KernelIsa all[] = { KernelIsa::Reference, KernelIsa::Scalar, KernelIsa::Avx2, KernelIsa::Avx512 };
+    for (KernelIsa candidate : all) {
+        if (std::strcmp(name, kernelIsaName(candidate)) == 0) {
+            isa = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void KillList::prepare(std::size_t chunks) {
+    perChunk.resize(chunks);
+    for (auto& list : perChunk) list.clear();
+    indices.clear();
+}
+
+void KillList::gather() {
+    // Шматки суцільні й ідуть за зростанням, тож конкатенація вже відсортована
+    indices.clear();
+    for (const auto& list : perChunk) {
+        indices.insert(indices.end(), list.begin(), list.end());
+    }
+}
+
+void blackHoleKickDrift(float* posX, float* posY, float* velX, float* velY, std::size_t count,
+                        float holeX, float holeY, float pullMass, float deltaTime, KernelIsa isa, KillList* kill) {
+    if (!kernelIsaSupported(isa)) isa = detectKernelIsa();
+    // Ядро обирається один раз на виклик, а не в кожному шматку
+    const KickDriftKernel kernel = kickDriftKernel(isa, kill != nullptr);
+    const float pullStep = pullMass * deltaTime;
+    const float killRadius2 = kill ? kill->radius * kill->radius : 0.0f;
+    forEachChunk("kick-drift chunk", count, kill, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        kernel(posX, posY, velX, velY, begin, end, holeX, holeY, pullStep, deltaTime, killRadius2, kill ? &kill->perChunk[chunk] : nullptr);
+    });
+}
+
+void blackHoleLeapfrog(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t count,
+                       float holeX, float holeY, float pullMass, float deltaTime, KernelIsa isa, KillList* kill) {
+    if (!kernelIsaSupported(isa)) isa = detectKernelIsa();
+    const LeapfrogKernel kernel = leapfrogKernel(isa, kill != nullptr);
+    const float killRadius2 = kill ? kill->radius * kill->radius : 0.0f;
+    forEachChunk("leapfrog chunk", count, kill, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        kernel(posX, posY, velX, velY, accX, accY, begin, end, holeX, holeY, pullMass, deltaTime, killRadius2, kill ? &kill->perChunk[chunk] : nullptr);
+    });
+}
+
+std::uint64_t blackHoleBlockLeapfrog(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t count,
+                                     float holeX, float holeY, float pullMass, float deltaTime, float accuracy, int maxRung,
+                                     KernelIsa isa, KillList* kill) {
+    if (!kernelIsaSupported(isa)) isa = detectKernelIsa();
+    const LeapfrogKernel kernel = leapfrogKernel(isa, kill != nullptr);
+    const float killRadius2 = kill ? kill->radius * kill->radius : 0.0f;
+    // Підкрок h годиться, якщо h^2 * |a| <= accuracy^2 * r, тобто h^4 * |a|^2 <= accuracy^4 * r^2 (без коренів)
+    const float step2 = deltaTime * deltaTime;
+    const float accuracy2 = accuracy * accuracy;
+    const float scale = step2 * step2 / (accuracy2 * accuracy2);
+    maxRung = std::min(std::max(maxRung, 0), maxBlockRung);
+    std::atomic<std::uint64_t> bodySteps{ 0 };
+    forEachChunk("block leapfrog chunk", count, kill, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::vector<std::uint32_t>* killed = kill ? &kill->perChunk[chunk] : nullptr;
+        std::int32_t fine[rungBlock];
+        std::uint64_t steps = 0;
+
+        for (std::size_t block = begin; block < end; block += rungBlock) {
+            const std::size_t blockEnd = block + rungBlock < end ? block + rungBlock : end;
+            const std::size_t length = blockEnd - block;
+            int refined = 0;
+            for (std::size_t k = 0; k < length; ++k) {
+                float dx = holeX - posX[block + k];
+                float dy = holeY - posY[block + k];
+                float ax = accX[block + k];
+                float ay = accY[block + k];
+                fine[k] = scale * (ax * ax + ay * ay) > dx * dx + dy * dy;
+                refined += fine[k];
+            }
+
+            // Зазвичай увесь блок обходиться одним кроком
+            if (refined == 0) {
+                kernel(posX, posY, velX, velY, accX, accY, block, blockEnd, holeX, holeY, pullMass, deltaTime, killRadius2, killed);
+                steps += length;
+                continue;
+            }
+
+            // Суцільні відрізки тіл, яким вистачає повного кроку, - векторним ядром, решта - власними підкроками
+            std::size_t i = block;
+            while (i < blockEnd) {
+                std::size_t runEnd = i;
+                while (runEnd < blockEnd && !fine[runEnd - block]) ++runEnd;
+                if (runEnd > i) {
+                    kernel(posX, posY, velX, velY, accX, accY, i, runEnd, holeX, holeY, pullMass, deltaTime, killRadius2, killed);
+                    steps += runEnd - i;
+                    i = runEnd;
+                    continue;
+                }
+                steps += subcycleBody(posX, posY, velX, velY, accX, accY, i, holeX, holeY, pullMass, deltaTime, scale, maxRung,
+                                      killRadius2, killed);
+                ++i;
+            }
+        }
+
+        bodySteps.fetch_add(steps, std::memory_order_relaxed);
+    });
+
+    KOSMOS_PROFILE_COUNT("body substeps", bodySteps.load());
+    return bodySteps.load();
+}
+
+void collectKillZone(const float* posX, const float* posY, std::size_t count, float holeX, float holeY, KillList& kill) {
+    const float killRadius2 = kill.radius * kill.radius;
+
+    forEachChunk("kill zone chunk", count, &kill, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::vector<std::uint32_t>& killed = kill.perChunk[chunk];
+        for (std::size_t i = begin; i < end; ++i) {
+            float dx = holeX - posX[i];
+            float dy = holeY - posY[i];
+            if (dx * dx + dy * dy < killRadius2) killed.push_back(static_cast<std::uint32_t>(i));
+        }
+    });
+}
+
+void blackHoleAccelerations(const float* posX, const float* posY, float* accX, float* accY, std::size_t count,
+                            float holeX, float holeY, float pullMass) {
+    forEachChunk("accelerations chunk", count, nullptr, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            float dx = holeX - posX[i];
+            float dy = holeY - posY[i];
+            float distance2 = dx * dx + dy * dy;
+            float scale = pullMass / (distance2 * std::sqrt(distance2));
+            accX[i] = dx * scale;
+            accY[i] = dy * scale;
+        }
+    });
+}
+
+void addPointMassAccelerations(const float* posX, const float* posY, float* accX, float* accY, std::size_t count,
+                               const float* sourceX, const float* sourceY, const float* sourceMass, std::size_t sources,
+                               float gravitationalConstant, float softening) {
+    const float eps2 = softening * softening;
+    forEachChunk("point masses chunk", count, nullptr, [&](std::size_t, std::size_t begin, std::size_t end) {
+        // Джерела зовні, тіла всередині: внутрішній цикл векторизується, шматок тіл лишається в кеші
+        for (std::size_t s = 0; s < sources; ++s) {
+            const float sx = sourceX[s];
+            const float sy = sourceY[s];
+            const float pull = gravitationalConstant * sourceMass[s];
+            for (std::size_t i = begin; i < end; ++i) {
+                float dx = sx - posX[i];
+                float dy = sy - posY[i];
+                float r2 = dx * dx + dy * dy + eps2;
+                float scale = pull / (r2 * std::sqrt(r2));
+                accX[i] += dx * scale;
+                accY[i] += dy * scale;
+            }
+        }
+    });
+}
+
+void kickMatters(float* velX, float* velY, const float* accX, const float* accY, std::size_t count, float deltaTime) {
+    forEachChunk("kick chunk", count, nullptr, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            velX[i] += accX[i] * deltaTime;
+            velY[i] += accY[i] * deltaTime;
+        }
+    });
+}
+
+void driftMatters(float* posX, float* posY, const float* velX, const float* velY, std::size_t count, float deltaTime) {
+    forEachChunk("drift chunk", count, nullptr, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            posX[i] += velX[i] * deltaTime;
+            posY[i] += velY[i] * deltaTime;
+        }
+    });
+}
@@ -0,0 +1,72 @@
+﻿#ifndef GRAVITY_KERNELS_HPP
+#define GRAVITY_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Об'єднане ядро "гравітація чорної діри + поштовх + дрейф" над суцільними масивами float.
+// Має явні шляхи AVX2 та AVX-512 і скалярний запасний; шлях обирається за CPU під час запуску.
+enum class KernelIsa {
+    Reference, // старі два проходи: applyGravityToMatters, потім updateMatters
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// Тіла, що після кроку опинились у зоні знищення чорної діри. Ядра перевіряють їх у тому ж
+// проході, що й гравітацію; кожен шматок масиву пише у свій список, тож збір іде без блокувань.
+struct KillList {
+    float radius = 0.0f;
+    std::vector<std::vector<std::uint32_t>> perChunk;
+    std::vector<std::uint32_t> indices; // зведений список, за зростанням індексу
+
+    void prepare(std::size_t chunks);
+    void gather();
+};
+
+KernelIsa detectKernelIsa();
+bool kernelIsaSupported(KernelIsa isa);
+const char* kernelIsaName(KernelIsa isa);
+bool parseKernelIsa(const char* name, KernelIsa& isa);
+
+// v += a * deltaTime; x += v * deltaTime, де a - притягування маси pullMass у точці (holeX, holeY).
+// Масив ділиться на суцільні шматки, які виконує пул JobSystem.
+// kill (необов'язково) отримує тіла, що опинились ближче kill->radius до дірки.
+void blackHoleKickDrift(float* posX, float* posY, float* velX, float* velY, std::size_t count,
+                        float holeX, float holeY, float pullMass, float deltaTime, KernelIsa isa, KillList* kill = nullptr);
+
+// Leapfrog (kick-drift-kick): v += a * dt/2; x += v * dt; a = a(x); v += a * dt/2.
+// accX/accY тримають прискорення з кінця минулого кроку, тож сила рахується один раз на крок.
+void blackHoleLeapfrog(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t count,
+                       float holeX, float holeY, float pullMass, float deltaTime, KernelIsa isa, KillList* kill = nullptr);
+
+// Leapfrog із блоковими кроками: тіло, чий крок задовгий для його динамічного часу sqrt(r / |a|),
+// іде підкроками deltaTime / 2^rung (rung <= maxRung <= 20), не довшими за accuracy * sqrt(r / |a|).
+// Рівень переобирається на кожній межі підкроку, тож тіло, що падає до дірки, дрібнішає дорогою.
+// Сила залежить лише від власної позиції тіла, тож кожне тіло проходить свої підкроки окремо,
+// а тіла, яким вистачає повного кроку, ідуть векторним ядром, як у blackHoleLeapfrog.
+// Повертає кількість виконаних тіло-підкроків (робота пропорційна тілам, яким потрібна точність).
+std::uint64_t blackHoleBlockLeapfrog(float* posX, float* posY, float* velX, float* velY, float* accX, float* accY, std::size_t count,
+                                     float holeX, float holeY, float pullMass, float deltaTime, float accuracy, int maxRung,
+                                     KernelIsa isa, KillList* kill = nullptr);
+
+// Окремий паралельний пошук тіл у зоні знищення (для шляхів без об'єднаного ядра)
+void collectKillZone(const float* posX, const float* posY, std::size_t count, float holeX, float holeY, KillList& kill);
+
+// Лише прискорення від чорної діри (початок інтегрування або зміна сили)
+void blackHoleAccelerations(const float* posX, const float* posY, float* accX, float* accY, std::size_t count,
+                            float holeX, float holeY, float pullMass);
+
+// Додає до прискорень притягування точкових мас (source*, зі згладжуванням softening, як у дереві)
+void addPointMassAccelerations(const float* posX, const float* posY, float* accX, float* accY, std::size_t count,
+                               const float* sourceX, const float* sourceY, const float* sourceMass, std::size_t sources,
+                               float gravitationalConstant, float softening);
+
+// Поштовх v += a * deltaTime за збереженими прискореннями
+void kickMatters(float* velX, float* velY, const float* accX, const float* accY, std::size_t count, float deltaTime);
+
+// Лише дрейф x += v * deltaTime (чорна діра вимкнена або сили вже додані)
+void driftMatters(float* posX, float* posY, const float* velX, const float* velY, std::size_t count, float deltaTime);
+
+#endif
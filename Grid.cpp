@@ -0,0 +1,105 @@
+﻿#include "Grid.hpp"
+#include "ParallelSort.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+
+void Grid::build(const float* posX, const float* posY, const float* radius, std::size_t bodyCount) {
+    const std::size_t count = bodyCount;
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+
+    activeCellSize = cellSize;
+    if (activeCellSize <= 0.0f) {
+        float maxRadius = jobs.parallelReduce(count, grain, 0.0f, [&](std::size_t begin, std::size_t end, float& partial) {
+            for (std::size_t i = begin; i < end; ++i) partial = std::max(partial, radius[i]);
+        }, [](float& result, float partial) { result = std::max(result, partial); });
+        activeCellSize = std::max(2.0f * maxRadius, 1.0f);
+    }
+    inverseCellSize = 1.0f / activeCellSize;
+
+    // Таблиця щонайменше вдвічі більша за кількість тіл, щоб колізій хешу було мало
+    tableBits = 8;
+    while ((std::size_t(1) << tableBits) < 2 * count && tableBits < 30) ++tableBits;
+    tableMask = (1u << tableBits) - 1u;
+
+    cellKeys.resize(count);
+    sortedIndices.resize(count);
+    jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            cellKeys[i] = hashCell(cellCoordinate(posX[i]), cellCoordinate(posY[i]));
+            sortedIndices[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+
+    radixSortPairs(cellKeys, sortedIndices, tableBits);
+
+    const std::size_t tableSize = static_cast<std::size_t>(tableMask) + 1;
+    cellStart.resize(tableSize);
+    cellEnd.resize(tableSize);
+    jobs.parallelFor(tableSize, jobs.grainFor(tableSize), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::fill(cellStart.begin() + begin, cellStart.begin() + end, emptyCell);
+    });
+
+    jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            std::uint32_t key = cellKeys[k];
+            if (k == 0 || cellKeys[k - 1] != key) {
+                cellStart[key] = static_cast<std::uint32_t>(k);
+            }
+            if (k == count - 1 || cellKeys[k + 1] != key) {
+                cellEnd[key] = static_cast<std::uint32_t>(k + 1);
+            }
+        }
+    });
+}
+
+void Grid::clear() {
+    cellKeys.clear();
+    sortedIndices.clear();
+    std::fill(cellStart.begin(), cellStart.end(), emptyCell);
+}
+
+Grid::CellRange Grid::retrieve(const Vec2& position) const {
+    CellRange range = { nullptr, nullptr };
+    if (cellStart.empty()) return range;
+
+    std::uint32_t bucket = hashCell(cellCoordinate(position.x), cellCoordinate(position.y));
+    std::uint32_t start = cellStart[bucket];
+    if (start == emptyCell) return range;
+
+    range.begin = sortedIndices.data() + start;
+    range.end = sortedIndices.data() + cellEnd[bucket];
+    return range;
+}
+
+void Grid::collectCellsInRect(float left, float top, float right, float bottom, std::vector<CellRange>& out) const {
+    out.clear();
+    if (sortedIndices.empty()) return;
+
+    const long long x0 = cellCoordinate(left);
+    const long long x1 = cellCoordinate(right);
+    const long long y0 = cellCoordinate(top);
+    const long long y1 = cellCoordinate(bottom);
+    const long long cellCount = (x1 - x0 + 1) * (y1 - y0 + 1);
+
+    if (cellCount >= static_cast<long long>(sortedIndices.size())) {
+        CellRange all = { sortedIndices.data(), sortedIndices.data() + sortedIndices.size() };
+        out.push_back(all);
+        return;
+    }
+
+    rectBuckets.clear();
+    for (long long cy = y0; cy <= y1; ++cy) {
+        for (long long cx = x0; cx <= x1; ++cx) {
+            std::uint32_t bucket = hashCell(static_cast<int>(cx), static_cast<int>(cy));
+            if (cellStart[bucket] != emptyCell) rectBuckets.push_back(bucket);
+        }
+    }
+    std::sort(rectBuckets.begin(), rectBuckets.end());
+    rectBuckets.erase(std::unique(rectBuckets.begin(), rectBuckets.end()), rectBuckets.end());
+
+    for (std::uint32_t bucket : rectBuckets) {
+        CellRange range = { sortedIndices.data() + cellStart[bucket], sortedIndices.data() + cellEnd[bucket] };
+        out.push_back(range);
+    }
+}
@@ -1,46 +1,98 @@
-#ifndef GRID_HPP
+﻿#ifndef GRID_HPP
 #define GRID_HPP
 
-#include <unordered_map>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
-#include <utility>
-#include "MatterGenerator.hpp"
-
-//  -  std::pair
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator() (const std::pair<T1, T2>& pair) const {
-        auto hash1 = std::hash<T1>{}(pair.first);
-        auto hash2 = std::hash<T2>{}(pair.second);
-        return hash1 ^ hash2;
-    }
-};
+#include "MatterStore.hpp"
 
+// Рівномірна сітка з хешуванням комірок, відсортована за коміркою (cell-sorted index).
+// Будується паралельно кожен крок: хеш комірки -> радіксне сортування -> таблиця початків комірок.
+// Тіла однієї комірки лежать у пам'яті поруч, сусідні комірки читаються без алокацій.
 class Grid {
 public:
-    Grid(float cellSize) : cellSize(cellSize) {}
+    struct CellRange {
+        const std::uint32_t* begin;
+        const std::uint32_t* end;
+    };
 
-    void insert(Matter* matter) {
-        auto cell = getCell(matter->shape.getPosition());
-        cells[cell].push_back(matter);
-    }
+    // cellSize <= 0: розмір комірки = найбільший діаметр тіла
+    explicit Grid(float cellSize = 0.0f) : cellSize(cellSize) {}
 
-    std::vector<Matter*> retrieve(const sf::Vector2f& position) {
-        auto cell = getCell(position);
-        return cells[cell];
-    }
+    void build(const MatterStore& matters) { build(matters.posX.data(), matters.posY.data(), matters.radius.data(), matters.size()); }
+    // Те саме над окремими масивами (наприклад, знімок для рендера)
+    void build(const float* posX, const float* posY, const float* radius, std::size_t bodyCount);
+    void clear();
+
+    // Тіла в комірці, що містить точку (без копіювання)
+    CellRange retrieve(const Vec2& position) const;
+
+    // Діапазони кошиків, що покривають прямокутник (кожен кошик один раз).
+    // Якщо комірок більше, ніж тіл, повертає один діапазон з усіма тілами.
+    void collectCellsInRect(float left, float top, float right, float bottom, std::vector<CellRange>& out) const;
+
+    // Обходить тіла 3x3 сусідніх комірок; кожен кошик таблиці відвідується один раз
+    template <class Visitor>
+    void forEachNeighbour(float x, float y, Visitor&& visit) const {
+        if (cellStart.empty()) return;
+        int cx = cellCoordinate(x);
+        int cy = cellCoordinate(y);
+        std::uint32_t visited[9];
+        int visitedCount = 0;
+        for (int oy = -1; oy <= 1; ++oy) {
+            for (int ox = -1; ox <= 1; ++ox) {
+                std::uint32_t bucket = hashCell(cx + ox, cy + oy);
+                bool seen = false;
+                for (int v = 0; v < visitedCount; ++v) {
+                    if (visited[v] == bucket) { seen = true; break; }
+                }
+                if (seen) continue;
+                visited[visitedCount++] = bucket;
 
-    void clear() {
-        cells.clear();
+                std::uint32_t start = cellStart[bucket];
+                if (start == emptyCell) continue;
+                for (std::uint32_t k = start; k < cellEnd[bucket]; ++k) {
+                    visit(k, sortedIndices[k]);
+                }
+            }
+        }
     }
 
-private:
+    // Порядок тіл за комірками: sortedIndices[k] - індекс тіла на позиції k
+    const std::vector<std::uint32_t>& order() const { return sortedIndices; }
+    float effectiveCellSize() const { return activeCellSize; }
+
     float cellSize;
-    std::unordered_map<std::pair<int, int>, std::vector<Matter*>, pair_hash> cells;
 
-    std::pair<int, int> getCell(const sf::Vector2f& position) {
-        return std::make_pair(static_cast<int>(position.x / cellSize), static_cast<int>(position.y / cellSize));
+private:
+    static constexpr std::uint32_t emptyCell = 0xFFFFFFFFu;
+
+    int cellCoordinate(float value) const {
+        float cell = std::floor(value * inverseCellSize);
+        // тіла, викинуті дуже далеко, потрапляють у крайні комірки замість переповнення int
+        if (!(cell > -1.0e9f)) cell = -1.0e9f;
+        if (cell > 1.0e9f) cell = 1.0e9f;
+        return static_cast<int>(cell);
     }
+
+    std::uint32_t hashCell(int cx, int cy) const {
+        std::uint32_t h = static_cast<std::uint32_t>(cx) * 0x9E3779B1u + static_cast<std::uint32_t>(cy) * 0x85EBCA77u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        return h & tableMask;
+    }
+
+    float activeCellSize = 1.0f;
+    float inverseCellSize = 1.0f;
+    std::uint32_t tableMask = 0;
+    int tableBits = 0;
+    std::vector<std::uint32_t> cellKeys;
+    std::vector<std::uint32_t> sortedIndices;
+    std::vector<std::uint32_t> cellStart;
+    std::vector<std::uint32_t> cellEnd;
+    mutable std::vector<std::uint32_t> rectBuckets;
 };
 
-#endif 
+#endif
@@ -0,0 +1,636 @@
+﻿#include <omp.h>
+#include "Catalog.hpp" // Початкові умови з CSV або двійкового каталогу
+#include "DomainDecomposition.hpp" // Розподілений режим: процес на домен
+#include "Ensemble.hpp" // Перебір параметрів паралельними прогонами
+#include "MatterGenerator.hpp" // Генератор матерії
+#include "Simulation.hpp" // Ядро симуляції без SFML
+#include "JobSystem.hpp" // Пул потоків для фаз кроку
+#include "Profiler.hpp" // Заміри фаз кроку
+#include "RewindBuffer.hpp" // Історія для перемотування назад
+#include "Snapshot.hpp" // Збереження та продовження прогонів
+#include "VideoRecorder.hpp" // Кадри без дисплея для ffmpeg
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Headless-режим для серверів без дисплея: крокує N тіл K тактів і друкує пропускну здатність.
+// Використання: KOSMOS-Headless [--bodies N] [--ticks K] [--dt секунди] [--threads T]
+//                               [--collisions] [--colonize] [--barnes-hut] [--theta theta]
+//                               [--particle-mesh] [--mesh-size M]
+//                               [--kernel reference|scalar|avx2|avx512]
+//                               [--integrator euler|leapfrog] [--substeps S]
+//                               [--block-steps] [--step-accuracy eta] [--gravity-multiplier k]
+//                               [--reorder-every K]
+//                               [--seed N] [--profile annulus|disk|plummer|rings]
+//                               [--catalog файл] [--export-catalog файл.csv|файл.bin]
+//                               [--load файл] [--save файл] [--checkpoint файл --checkpoint-every K]
+//                               [--trace файл.json|файл.csv]
+//                               [--domains S [--rings R]]
+//                               [--video файл.y4m|файл.ppm|- [--video-size WxH] [--video-every K] [--video-fps F] [--video-zoom z]]
+//                               [--rewind МБ [--rewind-to K]]
+//        KOSMOS-Headless --sweep опис.txt [--sweep-out файл.csv] [--threads T]
+
+static void printUsage() {
+    std::cerr << "Usage: KOSMOS-Headless [--bodies N] [--ticks K] [--dt seconds] [--threads T] "
+                 "[--collisions] [--colonize] [--barnes-hut] [--theta theta] [--particle-mesh] [--mesh-size M] "
+                 "[--kernel reference|scalar|avx2|avx512] [--integrator euler|leapfrog] [--substeps S] "
+                 "[--block-steps] [--step-accuracy eta] [--gravity-multiplier k] [--reorder-every K] "
+                 "[--seed N] [--profile annulus|disk|plummer|rings] "
+                 "[--catalog file] [--export-catalog file.csv|file.bin] "
+                 "[--load file] [--save file] [--checkpoint file --checkpoint-every K] "
+                 "[--trace file.json|file.csv] [--domains S [--rings R]] "
+                 "[--video file.y4m|file.ppm|- [--video-size WxH] [--video-every K] [--video-fps F] [--video-zoom z]] "
+                 "[--rewind MB [--rewind-to K]]\n"
+                 "       KOSMOS-Headless --sweep spec.txt [--sweep-out file.csv] [--threads T]" << std::endl;
+}
+
+static std::string gravityModeName(const GravitySolver& gravity) {
+    switch (gravity.mode) {
+    case GravityMode::BarnesHut:
+        return "barnes-hut";
+    case GravityMode::ParticleMesh:
+        return "particle-mesh " + std::to_string(gravity.mesh.resolution);
+    default:
+        return "black hole";
+    }
+}
+
+// FNV-1a над позиціями й швидкостями: однаковий хеш = побітово однаковий стан
+static std::uint64_t stateHash(const Simulation& simulation) {
+    std::uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void* data, std::size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < bytes; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    const MatterStore& matters = simulation.matters;
+    mix(matters.posX.data(), matters.size() * sizeof(float));
+    mix(matters.posY.data(), matters.size() * sizeof(float));
+    mix(matters.velX.data(), matters.size() * sizeof(float));
+    mix(matters.velY.data(), matters.size() * sizeof(float));
+    const ShipPool& ships = simulation.ships;
+    mix(ships.aimX.data(), ships.size() * sizeof(float));
+    mix(ships.aimY.data(), ships.size() * sizeof(float));
+    mix(ships.arrivalTime.data(), ships.size() * sizeof(double));
+    return hash;
+}
+
+// Координатор доменів: збирає підсумки всіх процесів. Час - найповільнішого домену, хеш - FNV-1a над хешами доменів
+static bool printDomainReports(DomainTransport& transport, const std::vector<int>& children, int bodies, int ticks, int threads, int sectors, int rings) {
+    std::vector<DomainReport> reports(transport.size());
+    bool received = true;
+    for (int domain = 0; domain < transport.size(); ++domain) {
+        if (!receiveReport(transport, domain, reports[domain])) {
+            std::cerr << "Error: Domain " << domain << " did not report." << std::endl;
+            received = false;
+        }
+    }
+    if (!waitDomainProcesses(children) || !received) return false;
+
+    DomainReport total;
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (const DomainReport& report : reports) {
+        total.seconds = std::max(total.seconds, report.seconds);
+        total.bodies += report.bodies;
+        total.ships += report.ships;
+        total.colonies += report.colonies;
+        total.shipArrivals += report.shipArrivals;
+        total.bodySteps += report.bodySteps;
+        total.migrated += report.migrated;
+        total.haloBodies += report.haloBodies;
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (report.stateHash >> (8 * i)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    std::cout << "bodies:          " << bodies << "\n"
+              << "ticks:           " << ticks << "\n"
+              << "domains:         " << transport.size() << " (" << sectors << " sectors x " << rings << " rings, " << threads << " threads each)\n"
+              << "simulation:      " << total.seconds * 1000.0 << " ms\n"
+              << "ticks/s:         " << ticks / total.seconds << "\n"
+              << "body-steps/s:    " << static_cast<double>(bodies) * ticks / total.seconds << "\n"
+              << "body substeps:   " << total.bodySteps << "\n"
+              << "bodies left:     " << total.bodies << "\n"
+              << "ships:           " << total.ships << "\n"
+              << "colonies:        " << total.colonies << "\n"
+              << "ship arrivals:   " << total.shipArrivals << "\n"
+              << "migrated:        " << total.migrated << "\n"
+              << "halo bodies:     " << total.haloBodies << "\n"
+              << "state hash:      " << std::hex << hash << std::dec << "\n";
+    for (int domain = 0; domain < transport.size(); ++domain) {
+        std::cout << "  domain " << domain << ": " << reports[domain].bodies << " bodies, " << reports[domain].seconds * 1000.0 << " ms, "
+                  << reports[domain].migrated << " migrated\n";
+    }
+    std::cout.flush();
+    return true;
+}
+
+// Усі прогони опису на спільному пулі, по одному прогону на потік
+static int runSweep(const std::string& specPath, const std::string& outPath) {
+    EnsembleSweep sweep;
+    if (!readSweep(specPath, sweep)) return -1;
+
+    std::vector<EnsembleResult> results;
+    auto start = std::chrono::steady_clock::now();
+    runEnsemble(sweep, results);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!writeEnsembleCsv(outPath, sweep, results)) {
+        std::cerr << "Error: Could not write sweep results " << outPath << std::endl;
+        return -1;
+    }
+
+    std::uint64_t ticks = 0;
+    for (const EnsembleRun& run : sweep.runs) ticks += static_cast<std::uint64_t>(run.ticks);
+    std::cout << "runs:            " << sweep.runs.size() << "\n"
+              << "threads:         " << JobSystem::instance().threadCount() << "\n"
+              << "wall time:       " << seconds << " s\n"
+              << "ticks/s (total): " << (seconds > 0.0 ? ticks / seconds : 0.0) << "\n"
+              << "results:         " << outPath << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int bodies = 7560;
+    int ticks = 1000;
+    float deltaTime = 1.0f / 60.0f;
+    int threads = omp_get_max_threads();
+    bool collisions = false;
+    bool colonize = false;
+    GravityMode gravityMode = GravityMode::BlackHoleOnly;
+    float theta = 0.5f;
+    int meshSize = 512;
+    KernelIsa kernel = detectKernelIsa();
+    Integrator integrator = Integrator::Leapfrog;
+    int substeps = 1;
+    bool blockSteps = false;
+    float stepAccuracy = 0.05f;
+    float gravityMultiplier = 0.0f; // 0 - як у вікні за замовчуванням
+    int reorderEvery = 32;          // 0 - тіла лишаються в порядку генератора
+    std::uint64_t seed = defaultGeneratorSeed;
+    RadialProfile profile = RadialProfile::Annulus;
+    std::string catalogPath;
+    std::string exportCatalogPath; // початкові тіла до першого кроку
+    std::string loadPath;
+    std::string savePath;
+    std::string checkpointPath;
+    int checkpointEvery = 0;
+    std::string tracePath;
+    int sectors = 1;
+    int rings = 1;
+    std::string videoPath;
+    int videoWidth = 1280;
+    int videoHeight = 720;
+    int videoEvery = 1;
+    int videoFps = 60;
+    float videoZoom = 1.0f; // менше 1 - камера віддаляється, як колесом миші у вікні
+    int rewindMegabytes = 0;
+    long long rewindTo = -1; // після прогону повернутись до такту K і надрукувати його хеш
+    std::string sweepPath;
+    std::string sweepOutPath = "sweep.csv";
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--bodies") == 0 && hasValue) {
+            bodies = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--ticks") == 0 && hasValue) {
+            ticks = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--dt") == 0 && hasValue) {
+            deltaTime = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--collisions") == 0) {
+            collisions = true;
+        }
+        else if (std::strcmp(argv[i], "--colonize") == 0) {
+            colonize = true;
+        }
+        else if (std::strcmp(argv[i], "--barnes-hut") == 0) {
+            gravityMode = GravityMode::BarnesHut;
+        }
+        else if (std::strcmp(argv[i], "--theta") == 0 && hasValue) {
+            theta = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--particle-mesh") == 0) {
+            gravityMode = GravityMode::ParticleMesh;
+        }
+        else if (std::strcmp(argv[i], "--mesh-size") == 0 && hasValue) {
+            meshSize = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--kernel") == 0 && hasValue) {
+            if (!parseKernelIsa(argv[++i], kernel)) {
+                printUsage();
+                return -1;
+            }
+            if (!kernelIsaSupported(kernel)) {
+                std::cerr << "Error: " << kernelIsaName(kernel) << " kernel is not supported by this CPU." << std::endl;
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--integrator") == 0 && hasValue) {
+            ++i;
+            if (std::strcmp(argv[i], "euler") == 0) {
+                integrator = Integrator::Euler;
+            }
+            else if (std::strcmp(argv[i], "leapfrog") == 0) {
+                integrator = Integrator::Leapfrog;
+            }
+            else {
+                printUsage();
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--substeps") == 0 && hasValue) {
+            substeps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--block-steps") == 0) {
+            blockSteps = true;
+        }
+        else if (std::strcmp(argv[i], "--step-accuracy") == 0 && hasValue) {
+            stepAccuracy = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--gravity-multiplier") == 0 && hasValue) {
+            gravityMultiplier = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--reorder-every") == 0 && hasValue) {
+            reorderEvery = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--profile") == 0 && hasValue) {
+            if (!parseRadialProfile(argv[++i], profile)) {
+                printUsage();
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--catalog") == 0 && hasValue) {
+            catalogPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--export-catalog") == 0 && hasValue) {
+            exportCatalogPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--load") == 0 && hasValue) {
+            loadPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--save") == 0 && hasValue) {
+            savePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--checkpoint") == 0 && hasValue) {
+            checkpointPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && hasValue) {
+            checkpointEvery = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+            tracePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--domains") == 0 && hasValue) {
+            sectors = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rings") == 0 && hasValue) {
+            rings = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--video") == 0 && hasValue) {
+            videoPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--video-size") == 0 && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &videoWidth, &videoHeight) != 2) {
+                printUsage();
+                return -1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--video-every") == 0 && hasValue) {
+            videoEvery = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--video-fps") == 0 && hasValue) {
+            videoFps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--video-zoom") == 0 && hasValue) {
+            videoZoom = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--rewind") == 0 && hasValue) {
+            rewindMegabytes = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rewind-to") == 0 && hasValue) {
+            rewindTo = std::atoll(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--sweep") == 0 && hasValue) {
+            sweepPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--sweep-out") == 0 && hasValue) {
+            sweepOutPath = argv[++i];
+        }
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+
+    if (bodies <= 0 || ticks <= 0 || threads <= 0 || substeps <= 0 || stepAccuracy <= 0.0f || gravityMultiplier < 0.0f || reorderEvery < 0 || checkpointEvery < 0
+        || (checkpointEvery > 0 && checkpointPath.empty()) || sectors <= 0 || rings <= 0
+        || videoWidth <= 0 || videoHeight <= 0 || videoEvery <= 0 || videoFps <= 0 || videoZoom <= 0.0f
+        || rewindMegabytes < 0 || (rewindTo >= 0 && rewindMegabytes == 0)) {
+        printUsage();
+        return -1;
+    }
+
+    if (!catalogPath.empty() && !loadPath.empty()) {
+        std::cerr << "Error: --catalog can not be combined with --load." << std::endl;
+        return -1;
+    }
+
+    // Параметри прогонів задає опис, з решти прапорців діє лише --threads
+    if (!sweepPath.empty()) {
+        JobSystem::instance().setThreadCount(threads);
+        return runSweep(sweepPath, sweepOutPath);
+    }
+
+    // Домени стартують з однакового згенерованого стану, тож знімки й траси в них не підтримуються
+    const int domains = sectors * rings;
+    if (domains > 1 && (!loadPath.empty() || !savePath.empty() || checkpointEvery > 0 || !tracePath.empty() || !videoPath.empty() || rewindMegabytes > 0)) {
+        std::cerr << "Error: --domains can not be combined with --load, --save, --checkpoint, --trace, --video or --rewind." << std::endl;
+        return -1;
+    }
+
+    // Розгалуження до першого паралельного циклу: дочірні процеси запускають власний пул потоків
+    UnixSocketTransport transport;
+    int domain = -1;
+    if (domains > 1) {
+        std::vector<int> children;
+        domain = forkDomainProcesses(domains, transport, children);
+        if (domain < 0) return -1;
+        if (domain == transport.coordinator()) {
+            return printDomainReports(transport, children, bodies, ticks, threads, sectors, rings) ? 0 : -1;
+        }
+    }
+
+    JobSystem::instance().setThreadCount(threads);
+
+    // Ті самі параметри, що й у вікні 1800x1600
+    Vec2 blackHolePosition(900.0f, 800.0f);
+    float blackHoleMass = 500.0f;
+    float blackHoleRadius = 50.0f;
+    float additionalDistance = 50.0f;
+
+    Simulation simulation(blackHolePosition, blackHoleMass, blackHoleRadius + additionalDistance);
+    simulation.collisionHandlingActive = collisions;
+    simulation.gravity.mode = gravityMode;
+    simulation.gravity.tree.openingAngle = theta;
+    simulation.gravity.mesh.resolution = meshSize;
+    simulation.gravity.kernel = kernel;
+    simulation.integrator = integrator;
+    simulation.substeps = substeps;
+    simulation.blockTimesteps = blockSteps;
+    simulation.timestepAccuracy = stepAccuracy;
+    simulation.reorderInterval = reorderEvery;
+    if (gravityMultiplier > 0.0f) simulation.gravityMultiplier = gravityMultiplier;
+
+    auto generateStart = std::chrono::steady_clock::now();
+    CatalogStats catalog;
+    if (!catalogPath.empty()) {
+        // Помилку з рядком уже надруковано
+        if (!importCatalog(catalogPath, simulation.matters, &catalog)) return -1;
+    }
+    else if (!loadPath.empty()) {
+        // Усі параметри симуляції й крок беруться з файла, щоб продовження було точним
+        if (!loadSnapshot(loadPath, simulation, &deltaTime)) {
+            std::cerr << "Error: Could not load snapshot " << loadPath << std::endl;
+            return -1;
+        }
+    }
+    else {
+        MatterGenerator generator(blackHolePosition, blackHoleMass, seed);
+        generator.profile = profile;
+        simulation.matters = generator.generateMatter(bodies);
+    }
+    auto generateEnd = std::chrono::steady_clock::now();
+    bodies = static_cast<int>(simulation.matters.size());
+    if (!exportCatalogPath.empty() && domain <= 0 && !exportCatalog(exportCatalogPath, simulation.matters)) {
+        std::cerr << "Error: Could not write catalog " << exportCatalogPath << std::endl;
+        return -1;
+    }
+
+    // Домен лишає свої тіла; перша колонія - у тому, куди потрапило тіло 0
+    DomainLayout layout = balanceDomains(simulation.matters, blackHolePosition, sectors, rings);
+    DomainWorker worker(simulation, layout, transport);
+    std::size_t firstColony = 0;
+    if (domain >= 0) {
+        const bool ownsFirst = layout.domainOf(simulation.matters.posX[0], simulation.matters.posY[0]) == domain;
+        const BodyHandle first = simulation.matters.handleOf(0);
+        worker.keepOwnMatters();
+        firstColony = ownsFirst ? simulation.matters.indexOf(first) : noMatter;
+    }
+
+    if (colonize && loadPath.empty()) {
+        if (catalog.colonies > 0) {
+            // Колонії з каталогу отримують по кораблю замість першої колонії з тіла 0
+            for (std::size_t i = 0; i < simulation.matters.size(); ++i) {
+                if (simulation.matters.isColony[i]) simulation.createShip(i);
+            }
+        }
+        else if (firstColony != noMatter) {
+            simulation.makeColony(firstColony);
+            simulation.createShip(firstColony);
+        }
+        simulation.colonizationActive = true;
+    }
+
+    Checkpointer checkpointer;
+    std::uint64_t skippedCheckpoints = 0;
+
+    // Кожен такт - окремий кадр профайлера
+    Profiler& profiler = Profiler::instance();
+    if (!tracePath.empty()) {
+        profiler.nameThread("main");
+        profiler.setEnabled(true);
+        profiler.startCapture();
+    }
+
+    // Кадр - вікно 1800x1600 навколо діри, розширене під пропорції відео; рендер іде поруч із наступними тактами
+    VideoRecorder recorder(videoWidth, videoHeight);
+    if (!videoPath.empty()) {
+        if (!recorder.open(videoPath, videoFps)) return -1;
+        const float aspect = static_cast<float>(videoWidth) / videoHeight;
+        recorder.view.width = std::max(1800.0f, 1600.0f * aspect) / videoZoom;
+        recorder.view.height = recorder.view.width / aspect;
+        recorder.view.left = blackHolePosition.x - recorder.view.width / 2.0f;
+        recorder.view.top = blackHolePosition.y - recorder.view.height / 2.0f;
+        recorder.blackHoleRadius = blackHoleRadius;
+        recorder.submit(simulation);
+    }
+
+    RewindBuffer history;
+    history.budgetBytes = static_cast<std::size_t>(rewindMegabytes) << 20;
+    history.record(simulation, deltaTime);
+
+    auto stepStart = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        if (domain < 0) {
+            simulation.step(deltaTime);
+        }
+        else if (!worker.step(deltaTime)) {
+            std::cerr << "Error: Domain " << domain << " lost its neighbours at tick " << tick << "." << std::endl;
+            return -1;
+        }
+        history.record(simulation, deltaTime);
+        if (checkpointEvery > 0 && simulation.tick % checkpointEvery == 0) {
+            if (!checkpointer.request(simulation, deltaTime, checkpointPath)) ++skippedCheckpoints;
+        }
+        if (!videoPath.empty() && simulation.tick % videoEvery == 0 && !recorder.submit(simulation)) {
+            std::cerr << "Error: Could not write video frame " << recorder.frames() << " to " << videoPath << std::endl;
+            return -1;
+        }
+        if (profiler.enabled()) profiler.endFrame();
+    }
+    history.wait();
+    auto stepEnd = std::chrono::steady_clock::now();
+    checkpointer.wait();
+    if (!recorder.finish()) {
+        std::cerr << "Error: Could not write video " << videoPath << std::endl;
+        return -1;
+    }
+
+    if (!tracePath.empty()) {
+        profiler.stopCapture();
+        bool csv = tracePath.size() > 4 && tracePath.compare(tracePath.size() - 4, 4, ".csv") == 0;
+        if (!(csv ? profiler.writeCsv(tracePath) : profiler.writeChromeTrace(tracePath))) {
+            std::cerr << "Error: Could not write trace " << tracePath << std::endl;
+            return -1;
+        }
+    }
+
+    if (!savePath.empty() && !saveSnapshot(savePath, simulation, deltaTime)) {
+        std::cerr << "Error: Could not save snapshot " << savePath << std::endl;
+        return -1;
+    }
+
+    double generateSeconds = std::chrono::duration<double>(generateEnd - generateStart).count();
+    double stepSeconds = std::chrono::duration<double>(stepEnd - stepStart).count();
+    double bodySteps = static_cast<double>(bodies) * ticks;
+
+    std::size_t colonies = 0;
+    for (std::uint8_t colony : simulation.matters.isColony) colonies += colony;
+
+    // Домен друкує не сам, а віддає підсумок координатору
+    if (domain >= 0) {
+        DomainReport report;
+        report.seconds = stepSeconds;
+        report.bodies = simulation.matters.size();
+        report.ships = simulation.ships.size();
+        report.colonies = colonies;
+        report.shipArrivals = simulation.shipArrivals;
+        report.bodySteps = simulation.bodySteps;
+        report.migrated = worker.migrated;
+        report.haloBodies = worker.haloBodies;
+        report.stateHash = stateHash(simulation);
+        return sendReport(transport, report) ? 0 : -1;
+    }
+
+    // Відео в stdout: текстовий підсумок іде в stderr, щоб не змішатися з кадрами
+    std::ostream& report = videoPath == "-" ? std::cerr : std::cout;
+    report << "bodies:          " << bodies << "\n";
+    if (!catalogPath.empty()) {
+        const double megabytes = catalog.bytes / (1024.0 * 1024.0);
+        report << "catalog:         " << catalog.bodies << " bodies, " << catalog.colonies << " colonies, "
+               << megabytes << " MB (" << megabytes / catalog.seconds << " MB/s, " << catalog.bodies / catalog.seconds << " bodies/s)\n";
+    }
+    else if (loadPath.empty()) {
+        report << "seed:            " << seed << "\n"
+                  << "profile:         " << radialProfileName(profile) << "\n";
+    }
+    report << "ticks:           " << ticks << "\n"
+              << "threads:         " << threads << "\n"
+              << "gravity:         " << gravityModeName(simulation.gravity) << "\n"
+              << "kernel:          " << kernelIsaName(simulation.gravity.kernel) << "\n"
+              << "integrator:      " << (simulation.integrator == Integrator::Leapfrog ? "leapfrog" : "euler") << " x" << simulation.substeps
+              << (simulation.blockTimesteps ? " + block steps" : "") << "\n"
+              << "morton reorder:  " << (simulation.reorderInterval > 0 ? "every " + std::to_string(simulation.reorderInterval) + " ticks" : std::string("off")) << "\n"
+              << "bytes per body:  " << MatterStore::bytesPerBody() << "\n"
+              << (!catalogPath.empty() ? "import:          " : loadPath.empty() ? "generation:      " : "load:            ") << generateSeconds * 1000.0 << " ms\n"
+              << "simulation:      " << stepSeconds * 1000.0 << " ms\n"
+              << "ticks/s:         " << ticks / stepSeconds << "\n"
+              << "body-steps/s:    " << bodySteps / stepSeconds << "\n"
+              << "body substeps:   " << simulation.bodySteps << "\n"
+              << "bodies left:     " << simulation.matters.size() << "\n"
+              << "ships:           " << simulation.ships.size() << "\n"
+              << "colonies:        " << colonies << "\n"
+              << "ship arrivals:   " << simulation.shipArrivals << "\n"
+              << "tick:            " << simulation.tick << "\n"
+              << "state hash:      " << std::hex << stateHash(simulation) << std::dec << std::endl;
+
+    if (!tracePath.empty()) {
+        report << "trace:           " << profiler.capturedEvents() << " events, " << profiler.droppedEvents() << " dropped\n";
+        for (const ProfilePhase& phase : profiler.phases()) {
+            report << "  " << phase.name << ": " << phase.milliseconds << " ms/tick on " << phase.threads << " threads\n";
+        }
+        for (const ProfileCounter& counter : profiler.counters()) {
+            report << "  " << counter.name << ": " << counter.value << (counter.gauge ? "\n" : " /tick\n");
+        }
+        report.flush();
+    }
+
+    if (!videoPath.empty()) {
+        report << "video frames:    " << recorder.frames() << " (" << videoWidth << "x" << videoHeight << ", every " << videoEvery << " ticks)" << std::endl;
+    }
+
+    if (checkpointEvery > 0) {
+        report << "checkpoints:     " << checkpointer.written() << " written, " << skippedCheckpoints << " skipped" << std::endl;
+    }
+
+    if (rewindMegabytes > 0 && history.empty()) {
+        report << "rewind:          empty (a keyframe is larger than the budget)" << std::endl;
+    }
+    else if (rewindMegabytes > 0) {
+        const std::uint64_t bodyFrames = history.bodyFrames();
+        report << "rewind:          ticks " << history.oldestTick() << ".." << history.newestTick() << ", "
+               << history.keyframes() << " keyframes, " << history.frames() << " frames, " << history.bytes() / 1048576.0 << " MB";
+        if (bodyFrames > 0) report << " (" << static_cast<double>(history.bytes()) / bodyFrames << " bytes per body-frame with keyframes)";
+        report << std::endl;
+    }
+
+    if (rewindTo >= 0) {
+        // Кадр для показу - наближений, стан після seek - точний; різниця між ними - похибка квантування
+        RenderFrame preview;
+        std::uint64_t previewTick = 0;
+        const bool previewed = history.frameAt(static_cast<std::uint64_t>(rewindTo), preview, &previewTick);
+
+        auto rewindStart = std::chrono::steady_clock::now();
+        if (!history.seek(static_cast<std::uint64_t>(rewindTo), simulation)) {
+            std::cerr << "Error: Tick " << rewindTo << " is not in the rewind history (" << history.oldestTick() << ".." << history.newestTick() << ")." << std::endl;
+            return -1;
+        }
+        double rewindSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - rewindStart).count();
+
+        float previewError = 0.0f;
+        if (previewed && previewTick == simulation.tick && preview.posX.size() == simulation.matters.size()) {
+            for (std::size_t i = 0; i < preview.posX.size(); ++i) {
+                previewError = std::max(previewError, std::abs(preview.posX[i] - simulation.matters.posX[i]));
+                previewError = std::max(previewError, std::abs(preview.posY[i] - simulation.matters.posY[i]));
+            }
+        }
+
+        report << "rewound to:      tick " << simulation.tick << " in " << rewindSeconds * 1000.0 << " ms\n";
+        if (previewed) {
+            report << "rewind preview:  tick " << previewTick;
+            if (previewTick == simulation.tick) report << ", max position error " << previewError;
+            report << "\n";
+        }
+        report << "rewound hash:    " << std::hex << stateHash(simulation) << std::dec << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+﻿#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+namespace {
+
+// Номер черги робочого потоку; -1 у зовнішніх потоках
+thread_local long long workerIndex = -1;
+thread_local bool serialScope = false;
+
+// Імена потоків у трасі профайлера мають жити весь час роботи програми
+const char* workerName(std::size_t index) {
+    static std::vector<std::unique_ptr<std::string>> names;
+    static std::mutex namesLock;
+    std::lock_guard<std::mutex> lock(namesLock);
+    while (names.size() <= index) {
+        names.push_back(std::unique_ptr<std::string>(new std::string("job " + std::to_string(names.size() + 1))));
+    }
+    return names[index]->c_str();
+}
+
+}
+
+JobSystem& JobSystem::instance() {
+    static JobSystem jobs;
+    return jobs;
+}
+
+JobSystem::JobSystem() {
+    start(omp_get_max_threads());
+}
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+void JobSystem::setThreadCount(int threads) {
+    threads = std::max(threads, 1);
+    if (threads == threadCount()) return;
+    stop();
+    start(threads);
+}
+
+void JobSystem::start(int threads) {
+    stopping.store(false);
+    queues.clear();
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (int i = 0; i + 1 < threads; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, static_cast<std::size_t>(i));
+    }
+}
+
+void JobSystem::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        stopping.store(true);
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+std::size_t JobSystem::grainFor(std::size_t count, std::size_t minimum) const {
+    const std::size_t parts = static_cast<std::size_t>(threadCount()) * 4;
+    const std::size_t grain = ((count + parts - 1) / parts + 15) & ~static_cast<std::size_t>(15);
+    return std::max(grain, minimum);
+}
+
+bool JobSystem::serialThread() {
+    return serialScope;
+}
+
+SerialJobScope::SerialJobScope() : wasSerial(serialScope) {
+    serialScope = true;
+}
+
+SerialJobScope::~SerialJobScope() {
+    serialScope = wasSerial;
+}
+
+void JobSystem::run(JobGroup& group, std::function<void()> job) {
+    group.remaining.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t shared = queues.size() - 1;
+    const std::size_t index = workerIndex >= 0 ? static_cast<std::size_t>(workerIndex) : shared;
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->lock);
+        queues[index]->jobs.push_back(Job{ std::move(job), &group });
+    }
+    pending.fetch_add(1, std::memory_order_release);
+    if (!workers.empty()) {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        wake.notify_one();
+    }
+}
+
+bool JobSystem::take(std::size_t self, Job& job) {
+    if (pending.load(std::memory_order_acquire) == 0) return false;
+
+    // Своє - з кінця
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Чуже - з початку, починаючи з сусіда, щоб крадії не товпились біля однієї черги
+    const std::size_t total = queues.size();
+    for (std::size_t offset = 1; offset < total; ++offset) {
+        Queue& victim = *queues[(self + offset) % total];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(Job& job) {
+    job.work();
+    job.group->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool JobSystem::takeOwn(JobGroup& group, Job& job) {
+    Queue& shared = *queues.back();
+    std::lock_guard<std::mutex> lock(shared.lock);
+    for (auto it = shared.jobs.rbegin(); it != shared.jobs.rend(); ++it) {
+        if (it->group == &group) {
+            job = std::move(*it);
+            shared.jobs.erase(std::next(it).base());
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::wait(JobGroup& group) {
+    // Зовнішній потік допомагає лише зі своєю групою: рендер не має застрягти в кроці фізики
+    const bool worker = workerIndex >= 0;
+    Job job;
+    while (group.remaining.load(std::memory_order_acquire) > 0) {
+        if (worker ? take(static_cast<std::size_t>(workerIndex), job) : takeOwn(group, job)) {
+            execute(job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(std::size_t index) {
+    workerIndex = static_cast<long long>(index);
+    Profiler::instance().nameThread(workerName(index));
+
+    Job job;
+    while (true) {
+        if (take(index, job)) {
+            execute(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepLock);
+        wake.wait(lock, [this] { return stopping.load() || pending.load(std::memory_order_acquire) > 0; });
+        if (stopping.load()) return;
+    }
+}
+
+TaskGraph::Task TaskGraph::add(const char* name, std::function<void()> work) {
+    Node node;
+    node.name = name;
+    node.work = std::move(work);
+    nodes.push_back(std::move(node));
+    return nodes.size() - 1;
+}
+
+void TaskGraph::precede(Task before, Task after) {
+    nodes[before].successors.push_back(after);
+    ++nodes[after].predecessors;
+}
+
+void TaskGraph::clear() {
+    nodes.clear();
+}
+
+void TaskGraph::run(JobSystem& jobs) {
+    if (waitingSize < nodes.size()) {
+        waiting.reset(new std::atomic<int>[nodes.size()]);
+        waitingSize = nodes.size();
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        waiting[i].store(nodes[i].predecessors, std::memory_order_relaxed);
+    }
+
+    // Перший корінь іде в потоці, що викликав: ланцюжок фаз лишається там, де й OpenMP-команда ядер
+    JobGroup group;
+    Task first = nodes.size();
+    for (Task task = 0; task < nodes.size(); ++task) {
+        if (nodes[task].predecessors != 0) continue;
+        if (first == nodes.size()) {
+            first = task;
+        }
+        else {
+            launch(task, jobs, group);
+        }
+    }
+    if (first != nodes.size()) execute(first, jobs, group);
+    jobs.wait(group);
+}
+
+void TaskGraph::launch(Task task, JobSystem& jobs, JobGroup& group) {
+    // Послідовний потік виконує готове завдання одразу; залежності й так дотримані лічильниками
+    if (JobSystem::serialThread()) {
+        execute(task, jobs, group);
+        return;
+    }
+    jobs.run(group, [this, task, &jobs, &group] { execute(task, jobs, group); });
+}
+
+void TaskGraph::execute(Task task, JobSystem& jobs, JobGroup& group) {
+    while (true) {
+        {
+            KOSMOS_PROFILE_SCOPE(nodes[task].name);
+            nodes[task].work();
+        }
+        // Перший готовий наступник продовжує в цьому ж потоці, решта - у чергу.
+        // Вони ставляться до того, як це завдання зніме себе з групи
+        Task next = nodes.size();
+        for (Task successor : nodes[task].successors) {
+            if (waiting[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+            if (next == nodes.size()) {
+                next = successor;
+            }
+            else {
+                launch(successor, jobs, group);
+            }
+        }
+        if (next == nodes.size()) return;
+        task = next;
+    }
+}
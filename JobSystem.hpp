@@ -0,0 +1,166 @@
+﻿#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоків із крадіжкою роботи для фаз кроку й кадру та простих паралельних циклів.
+// Кожен робочий потік має власну чергу: свої завдання бере з кінця (ще гарячі в кеші),
+// чужі краде з початку (там найбільші шматки). Зовнішні потоки (фізика, рендер) кладуть
+// завдання у спільну чергу. Потік, що чекає на групу, не спить, а виконує інші завдання,
+// тож вкладені parallelFor і графи не блокують пул.
+
+// Лічильник незавершених завдань; wait повертається, коли він дійшов до нуля
+struct JobGroup {
+    std::atomic<std::size_t> remaining{ 0 };
+};
+
+class JobSystem {
+public:
+    static JobSystem& instance();
+
+    // Потоків разом із тим, що чекає (як omp_set_num_threads); лише поки пул не має роботи
+    void setThreadCount(int threads);
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    void run(JobGroup& group, std::function<void()> job);
+    void wait(JobGroup& group);
+
+    // body(chunk, begin, end) для шматків [0, count) по grain елементів. Межі шматків залежать
+    // лише від count і grain, тож дані по шматках (списки kill) не залежать від кількості потоків
+    template <class Body>
+    void parallelFor(std::size_t count, std::size_t grain, Body&& body);
+
+    // Згортка тими самими шматками: body(begin, end, partial) накопичує шматок у partial (спершу identity),
+    // combine(result, partial) зводить шматки по черзі, тож результат не залежить від кількості потоків
+    template <class T, class Body, class Combine>
+    T parallelReduce(std::size_t count, std::size_t grain, const T& identity, Body&& body, Combine&& combine);
+
+    // Шматок так, щоб на кожен потік припадало кілька (для крадіжки), вирівняний на 16 елементів
+    std::size_t grainFor(std::size_t count, std::size_t minimum = 4096) const;
+
+    // true, якщо в цьому потоці діє SerialJobScope
+    static bool serialThread();
+
+private:
+    struct Job {
+        std::function<void()> work;
+        JobGroup* group;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    JobSystem();
+    ~JobSystem();
+    void start(int threads);
+    void stop();
+    void workerLoop(std::size_t index);
+    bool take(std::size_t self, Job& job);
+    bool takeOwn(JobGroup& group, Job& job);
+    void execute(Job& job);
+    template <class Body>
+    void split(JobGroup& group, std::size_t first, std::size_t last, std::size_t count, std::size_t grain, Body& body);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues; // по одній на робочий потік, остання - спільна
+    std::atomic<std::size_t> pending{ 0 };      // завдань у чергах
+    std::atomic<bool> stopping{ false };
+    std::mutex sleepLock;
+    std::condition_variable wake;
+};
+
+// Поки об'єкт живий, parallelFor і графи, запущені з цього потоку, виконуються в ньому ж по черзі.
+// Для незалежних завдань, що самі паралельні між собою
+// (прогони ансамблю): чекаючи на вкладений parallelFor, потік не підхопить цілий чужий прогін
+class SerialJobScope {
+public:
+    SerialJobScope();
+    ~SerialJobScope();
+
+    SerialJobScope(const SerialJobScope&) = delete;
+    SerialJobScope& operator=(const SerialJobScope&) = delete;
+
+private:
+    bool wasSerial;
+};
+
+// Граф залежностей між фазами: завдання запускається, щойно завершились усі попередні.
+// Незалежні фази (колонізація й збір зони знищення, копії знімка) ідуть одночасно,
+// а ланцюжок залежних продовжується в тому ж потоці без передачі через чергу.
+class TaskGraph {
+public:
+    typedef std::size_t Task;
+
+    Task add(const char* name, std::function<void()> work);
+    void precede(Task before, Task after);
+    void run(JobSystem& jobs = JobSystem::instance());
+    void clear();
+
+private:
+    struct Node {
+        const char* name;
+        std::function<void()> work;
+        std::vector<Task> successors;
+        int predecessors = 0;
+    };
+
+    void launch(Task task, JobSystem& jobs, JobGroup& group);
+    void execute(Task task, JobSystem& jobs, JobGroup& group);
+
+    std::vector<Node> nodes;
+    std::unique_ptr<std::atomic<int>[]> waiting;
+    std::size_t waitingSize = 0;
+};
+
+template <class Body>
+void JobSystem::parallelFor(std::size_t count, std::size_t grain, Body&& body) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+    const std::size_t chunks = (count + grain - 1) / grain;
+    if (chunks == 1 || workers.empty() || serialThread()) {
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            const std::size_t begin = chunk * grain;
+            body(chunk, begin, begin + grain < count ? begin + grain : count);
+        }
+        return;
+    }
+    JobGroup group;
+    split(group, 0, chunks, count, grain, body);
+    wait(group);
+}
+
+template <class T, class Body, class Combine>
+T JobSystem::parallelReduce(std::size_t count, std::size_t grain, const T& identity, Body&& body, Combine&& combine) {
+    if (grain == 0) grain = 1;
+    std::vector<T> partials((count + grain - 1) / grain, identity);
+    parallelFor(count, grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        body(begin, end, partials[chunk]);
+    });
+    T result = identity;
+    for (const T& partial : partials) combine(result, partial);
+    return result;
+}
+
+// Діапазон шматків ділиться навпіл: праву половину може вкрасти інший потік, ліву ділимо далі
+template <class Body>
+void JobSystem::split(JobGroup& group, std::size_t first, std::size_t last, std::size_t count, std::size_t grain, Body& body) {
+    while (last - first > 1) {
+        const std::size_t middle = first + (last - first) / 2;
+        run(group, [this, &group, middle, last, count, grain, &body] { split(group, middle, last, count, grain, body); });
+        last = middle;
+    }
+    const std::size_t begin = first * grain;
+    body(first, begin, begin + grain < count ? begin + grain : count);
+}
+
+#endif
@@ -0,0 +1,33 @@
+﻿#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+
+// Файл, відображений у пам'ять лише для читання (mmap на POSIX, file mapping на Windows).
+// Сторінки підтягуються ядром ОС на вимогу, тож відкриття великого файла майже миттєве.
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path);
+    void close();
+
+    const unsigned char* data() const { return bytes; }
+    std::size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+#endif
@@ -1,57 +1,128 @@
 ﻿#include "MatterGenerator.hpp"
+#include "JobSystem.hpp"
 #include <cmath>
+#include <cstring>
+
+namespace {
+
+const float twoPi = 6.28318531f;
+const int maxAttempts = 64;
+
+// Потоки лічильника Philox: числа для радіуса й кута та окремо для відстані
+const std::uint32_t bodyStream = 0;
+const std::uint32_t distanceStream = 1;
 
-MatterGenerator::MatterGenerator(const sf::Vector2f& blackHolePosition, float blackHoleMass)
-    : blackHolePosition(blackHolePosition), blackHoleMass(blackHoleMass) {
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
 }
 
-std::vector<Matter> MatterGenerator::generateMatter(int count) {
-    std::vector<Matter> matters;
-    matters.reserve(count);
-    for (int i = 0; i < count; ++i) {
-        float radius = getRandomRadius();
-        float mass = getMassForRadius(radius);
-        sf::Vector2f position = getRandomPosition();
-        sf::Vector2f velocity = getOrbitalVelocity(position);
-        matters.emplace_back(radius, mass, position, velocity);
+const char* radialProfileName(RadialProfile profile) {
+    switch (profile) {
+    case RadialProfile::Annulus: return "annulus";
+    case RadialProfile::ExponentialDisk: return "disk";
+    case RadialProfile::Plummer: return "plummer";
+    case RadialProfile::Rings: return "rings";
     }
-    return matters;
+    return "?";
 }
 
-float MatterGenerator::getRandomRadius() {
-    int category = std::rand() % 3;
-    switch (category) {
-    case 0: return 20.0f;  
-    case 1: return 40.0f;  
-    case 2: return 60.0f;  
-    default: return 3.0f;
+bool parseRadialProfile(const char* name, RadialProfile& profile) {
+    const RadialProfile all[] = { RadialProfile::Annulus, RadialProfile::ExponentialDisk,
+                                  RadialProfile::Plummer, RadialProfile::Rings };
+    for (RadialProfile candidate : all) {
+        if (std::strcmp(name, radialProfileName(candidate)) == 0) {
+            profile = candidate;
+            return true;
+        }
     }
+    return false;
 }
 
-float MatterGenerator::getMassForRadius(float radius) {
-    if (radius == 3.0f) return 1.0f;   
-    if (radius == 5.0f) return 2.0f;   
-    if (radius == 7.0f) return 3.0f;  
-    return 2.0f;
+MatterGenerator::MatterGenerator(const Vec2& blackHolePosition, float blackHoleMass, std::uint64_t seed)
+    : seed(seed), blackHolePosition(blackHolePosition), blackHoleMass(blackHoleMass), random(seed) {
 }
 
-sf::Vector2f MatterGenerator::getRandomPosition() {
-    float minDistance = 100.0f; // Мінімальна відстань від чорної діри
-    float maxDistance = 17500.0f; //Максимальна відстань від чорної діри
-    float distance = minDistance + static_cast<float>(std::rand()) / RAND_MAX * (maxDistance - minDistance);
-
-    // Генеруємо кут від 0 до 2π
-    float angle = static_cast<float>(std::rand()) / RAND_MAX * 2.0f * 3.14159265f;
-
-    float x = blackHolePosition.x + distance * std::cos(angle);
-    float y = blackHolePosition.y + distance * std::sin(angle);
+MatterStore MatterGenerator::generateMatter(std::size_t count) {
+    random = Philox4x32(seed);
+
+    MatterStore matters;
+    matters.resize(count);
+    const float radii[3] = { 20.0f, 40.0f, 60.0f };
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint64_t index = static_cast<std::uint64_t>(i);
+            Philox4x32::Block bits = random(static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), 0, bodyStream);
+
+            float radius = radii[bits.v[0] % 3];
+            float distance = sampleDistance(index);
+            // Генеруємо кут від 0 до 2π
+            float angle = Philox4x32::uniform(bits.v[1]) * twoPi;
+
+            Vec2 position(blackHolePosition.x + distance * std::cos(angle),
+                          blackHolePosition.y + distance * std::sin(angle));
+            Vec2 velocity = getOrbitalVelocity(position);
+
+            matters.posX[i] = position.x;
+            matters.posY[i] = position.y;
+            matters.velX[i] = velocity.x;
+            matters.velY[i] = velocity.y;
+            matters.accX[i] = 0.0f;
+            matters.accY[i] = 0.0f;
+            matters.mass[i] = massForRadius(radius);
+            matters.radius[i] = radius;
+            matters.isColony[i] = false;
+            matters.hasShip[i] = false;
+            matters.isTargeted[i] = false;
+        }
+    });
+    return matters;
+}
 
-    return sf::Vector2f(x, y);
+// Відстань від чорної діри. Значення поза [innerRadius, outerRadius] відкидаються й
+// генеруються заново з наступного блоку лічильника; після maxAttempts - обрізаються.
+float MatterGenerator::sampleDistance(std::uint64_t index) const {
+    const std::uint32_t lo = static_cast<std::uint32_t>(index);
+    const std::uint32_t hi = static_cast<std::uint32_t>(index >> 32);
+    const float span = outerRadius - innerRadius;
+
+    float distance = innerRadius;
+    for (int attempt = 0; attempt < maxAttempts; ++attempt) {
+        Philox4x32::Block bits = random(lo, hi, static_cast<std::uint32_t>(attempt), distanceStream);
+        switch (profile) {
+        case RadialProfile::Annulus:
+            return innerRadius + Philox4x32::uniform(bits.v[0]) * span;
+        case RadialProfile::ExponentialDisk: {
+            // Для густини exp(-R/h) на площині R розподілена як Gamma(2, h)
+            float u1 = Philox4x32::uniformPositive(bits.v[0]);
+            float u2 = Philox4x32::uniformPositive(bits.v[1]);
+            distance = innerRadius - scaleLength * std::log(u1 * u2);
+            break;
+        }
+        case RadialProfile::Plummer: {
+            // Обернена функція частки маси всередині R: u = R^2 / (R^2 + a^2)
+            float u = Philox4x32::uniform(bits.v[0]);
+            distance = innerRadius + scaleLength * std::sqrt(u / (1.0f - u));
+            break;
+        }
+        case RadialProfile::Rings: {
+            int rings = ringCount > 0 ? ringCount : 1;
+            int ring = static_cast<int>(bits.v[0] % static_cast<std::uint32_t>(rings));
+            float center = innerRadius + (ring + 0.5f) * span / rings;
+            // Бокс - Мюллер
+            float u1 = Philox4x32::uniformPositive(bits.v[1]);
+            float u2 = Philox4x32::uniform(bits.v[2]);
+            distance = center + ringWidth * std::sqrt(-2.0f * std::log(u1)) * std::cos(twoPi * u2);
+            break;
+        }
+        }
+        if (distance >= innerRadius && distance <= outerRadius) {
+            return distance;
+        }
+    }
+    return std::fmin(std::fmax(distance, innerRadius), outerRadius);
 }
 
-sf::Vector2f MatterGenerator::getOrbitalVelocity(const sf::Vector2f& position) {
-    sf::Vector2f direction = position - blackHolePosition;
+Vec2 MatterGenerator::getOrbitalVelocity(const Vec2& position) const {
+    Vec2 direction = position - blackHolePosition;
     float distance = std::sqrt(direction.x * direction.x + direction.y * direction.y);
 
     direction /= distance;
@@ -60,63 +131,9 @@ sf::Vector2f MatterGenerator::getOrbitalVelocity(const sf::Vector2f& position) {
     float G = 1.0f;
     float speed = std::sqrt(G * blackHoleMass / distance);
 
-    float speedMultiplier = 3.0f; 
     speed *= speedMultiplier;
 
-    sf::Vector2f tangent(-direction.y, direction.x); // Перпендикулярный вектор
+    Vec2 tangent(-direction.y, direction.x); // Перпендикулярный вектор
 
     return tangent * speed;
 }
-
-Matter::Matter(float radius, float mass, sf::Vector2f position, sf::Vector2f velocity)
-    : shape(radius), velocity(velocity), mass(mass), isColonized(false) {
-    shape.setOrigin(radius, radius);
-    shape.setPosition(position);
-    shape.setFillColor(sf::Color::White); // Цвет по умолчанию для неколонизированных звёзд
-}
-
-void Matter::applyGravity(const sf::Vector2f& blackHolePosition, float blackHoleMass, float deltaTime) {
-    sf::Vector2f direction = blackHolePosition - shape.getPosition();
-    float distance = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-    direction /= distance; 
-
-    // Вычисляем силу притяжения
-    float G = 1.0f; // Гравитационная постоянная
-    float force = (G * mass * blackHoleMass) / (distance * distance);
-
-    // Вычисляем ускорение
-    sf::Vector2f acceleration = direction * (force / mass);
-
-    velocity += acceleration * deltaTime;
-}
-
-bool Matter::checkCollision(const Matter& other) const {
-    float dx = shape.getPosition().x - other.shape.getPosition().x;
-    float dy = shape.getPosition().y - other.shape.getPosition().y;
-    float distance = std::sqrt(dx * dx + dy * dy);
-    return distance < (shape.getRadius() + other.shape.getRadius());
-}
-
-void Matter::resolveCollision(Matter& other) {
-
-    sf::Vector2f normal = other.shape.getPosition() - shape.getPosition();
-    float distance = std::sqrt(normal.x * normal.x + normal.y * normal.y);
-    normal /= distance;
-
-    sf::Vector2f relativeVelocity = other.velocity - velocity;
-
-    float velocityAlongNormal = relativeVelocity.x * normal.x + relativeVelocity.y * normal.y;
-
-    if (velocityAlongNormal > 0)
-        return;
-
-    float restitution = 1.0f; // 1.0f для повністю пружного зіткнення
-
-    float impulseScalar = -(1 + restitution) * velocityAlongNormal;
-    impulseScalar /= (1 / mass + 1 / other.mass);
-
-    sf::Vector2f impulse = impulseScalar * normal;
-
-    velocity -= (impulse / mass);
-    other.velocity += (impulse / other.mass);
-}
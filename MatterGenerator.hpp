@@ -1,52 +1,53 @@
-#ifndef MATTER_GENERATOR_HPP
+﻿#ifndef MATTER_GENERATOR_HPP
 #define MATTER_GENERATOR_HPP
 
-#include <SFML/Graphics.hpp>
-#include <vector>
-#include <cstdlib>
-#include <ctime>
-#include "Ship.hpp"  
-
-class Matter {
-public:
-    sf::CircleShape shape;
-    sf::Vector2f velocity;
-    float mass;
-    bool isColonized = false;
-    bool isTargeted = false;
-    bool isColony = false;
-    bool hasShip = false;
-
-    Matter(float radius, float mass, sf::Vector2f position, sf::Vector2f velocity);
-
-    void update(float deltaTime) {
-        sf::Vector2f newPosition = shape.getPosition() + velocity * deltaTime;
-        shape.setPosition(newPosition);
-    }
-
-    void applyGravity(const sf::Vector2f& blackHolePosition, float blackHoleMass, float deltaTime);
-    bool checkCollision(const Matter& other) const;
-    void resolveCollision(Matter& other);
-
-    Ship createShip() {
-        hasShip = true;
-        return Ship(5.0f, shape.getPosition(), sf::Vector2f(0.0f, 0.0f), shape.getPosition());
-    }
+#include <cstddef>
+#include <cstdint>
+#include "MatterStore.hpp"
+#include "Philox.hpp"
+
+// Радіальний розподіл тіл навколо чорної діри (відстань від innerRadius до outerRadius)
+enum class RadialProfile {
+    Annulus,         // рівномірно за відстанню (як було раніше)
+    ExponentialDisk, // поверхнева густина ~ exp(-R / scaleLength)
+    Plummer,         // проєкція сфери Пламмера: ~ (1 + R^2 / a^2)^-2, a = scaleLength
+    Rings            // ringCount кілець з гаусовою шириною ringWidth
 };
 
+const char* radialProfileName(RadialProfile profile);
+bool parseRadialProfile(const char* name, RadialProfile& profile);
+
+const std::uint64_t defaultGeneratorSeed = 20240501;
+
+// Генератор початкових умов. Кожне тіло - чиста функція (seed, індекс) через Philox,
+// тож тіла генеруються паралельно, а результат однаковий за будь-якої кількості потоків.
 class MatterGenerator {
 public:
-    MatterGenerator(const sf::Vector2f& blackHolePosition, float blackHoleMass);
-    std::vector<Matter> generateMatter(int count);
+    MatterGenerator(const Vec2& blackHolePosition, float blackHoleMass, std::uint64_t seed = defaultGeneratorSeed);
+
+    MatterStore generateMatter(std::size_t count);
+
+    // Маса пропорційна площі диска тіла; для радіуса 40 дає колишню масу 2
+    static float massForRadius(float radius) { return surfaceDensity * radius * radius; }
+
+    std::uint64_t seed;
+    RadialProfile profile = RadialProfile::Annulus;
+    float innerRadius = 100.0f;   // Мінімальна відстань від чорної діри
+    float outerRadius = 17500.0f; // Максимальна відстань від чорної діри
+    float scaleLength = 4000.0f;
+    int ringCount = 5;
+    float ringWidth = 300.0f;
+    float speedMultiplier = 3.0f;
 
 private:
-    float getRandomRadius();
-    float getMassForRadius(float radius);
-    sf::Vector2f getRandomPosition();
-    sf::Vector2f getOrbitalVelocity(const sf::Vector2f& position);
+    static constexpr float surfaceDensity = 2.0f / (40.0f * 40.0f);
+
+    float sampleDistance(std::uint64_t index) const;
+    Vec2 getOrbitalVelocity(const Vec2& position) const;
 
-    sf::Vector2f blackHolePosition;
+    Vec2 blackHolePosition;
     float blackHoleMass;
+    Philox4x32 random;
 };
 
-#endif 
+#endif
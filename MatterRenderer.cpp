@@ -0,0 +1,263 @@
+﻿#include "MatterRenderer.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const unsigned circleTextureSize = 64;
+const std::size_t vertexChunk = 4096;
+
+// Колірна шкала густини: темно-синій -> фіолетовий -> помаранчевий -> майже білий
+const float densityRamp[4][3] = {
+    { 30.0f, 40.0f, 110.0f },
+    { 130.0f, 60.0f, 170.0f },
+    { 240.0f, 140.0f, 60.0f },
+    { 255.0f, 250.0f, 230.0f }
+};
+const float colonyColor[3] = { 60.0f, 230.0f, 90.0f };
+
+void writeQuad(sf::Vertex* quad, float left, float top, float size, sf::Color color) {
+    const float texture = static_cast<float>(circleTextureSize);
+    quad[0] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(0.0f, 0.0f));
+    quad[1] = sf::Vertex(sf::Vector2f(left + size, top), color, sf::Vector2f(texture, 0.0f));
+    quad[2] = sf::Vertex(sf::Vector2f(left + size, top + size), color, sf::Vector2f(texture, texture));
+    quad[3] = sf::Vertex(sf::Vector2f(left, top + size), color, sf::Vector2f(0.0f, texture));
+}
+
+}
+
+MatterRenderer::MatterRenderer()
+    : cullGrid(512.0f), matterVertices(sf::Quads), shipVertices(sf::Quads) {
+    buildCircleTexture();
+}
+
+void MatterRenderer::buildCircleTexture() {
+    // Біле коло з м'яким краєм; колір задається вершинами
+    sf::Image image;
+    image.create(circleTextureSize, circleTextureSize, sf::Color::Transparent);
+    const float center = circleTextureSize / 2.0f;
+    for (unsigned y = 0; y < circleTextureSize; ++y) {
+        for (unsigned x = 0; x < circleTextureSize; ++x) {
+            float dx = x + 0.5f - center;
+            float dy = y + 0.5f - center;
+            float edge = center - std::sqrt(dx * dx + dy * dy);
+            float alpha = std::min(std::max(edge, 0.0f), 1.0f);
+            image.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(alpha * 255.0f)));
+        }
+    }
+    circleTexture.loadFromImage(image);
+    circleTexture.setSmooth(true);
+    circleTexture.generateMipmap();
+}
+
+void MatterRenderer::buildMatterVertices(const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea) {
+    JobSystem& jobs = JobSystem::instance();
+    const float maxRadius = jobs.parallelReduce(snapshot.size(), jobs.grainFor(snapshot.size()), 0.0f,
+                                                [&](std::size_t begin, std::size_t end, float& partial) {
+        for (std::size_t i = begin; i < end; ++i) partial = std::max(partial, snapshot.radius[i]);
+    }, [](float& result, float partial) { result = std::max(result, partial); });
+
+    cullGrid.build(snapshot.posX.data(), snapshot.posY.data(), snapshot.radius.data(), snapshot.size());
+    cullGrid.collectCellsInRect(visibleArea.left - maxRadius, visibleArea.top - maxRadius,
+                                visibleArea.left + visibleArea.width + maxRadius,
+                                visibleArea.top + visibleArea.height + maxRadius, visibleCells);
+
+    candidates.clear();
+    for (const auto& cell : visibleCells) {
+        candidates.insert(candidates.end(), cell.begin, cell.end);
+    }
+
+    const std::size_t total = candidates.size();
+    const std::size_t chunks = (total + vertexChunk - 1) / vertexChunk;
+    visible.resize(total);
+    chunkOffsets.assign(chunks + 1, 0);
+
+    const float left = visibleArea.left;
+    const float top = visibleArea.top;
+    const float right = visibleArea.left + visibleArea.width;
+    const float bottom = visibleArea.top + visibleArea.height;
+
+    // Перший прохід рахує видимі тіла в кожному шматку, другий пише вершини за зсувами
+    jobs.parallelFor(total, vertexChunk, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::size_t found = 0;
+        for (std::size_t k = begin; k < end; ++k) {
+            const std::uint32_t i = candidates[k];
+            const float radius = snapshot.radius[i];
+            bool inside = snapshot.posX[i] + radius >= left && snapshot.posX[i] - radius <= right
+                && snapshot.posY[i] + radius >= top && snapshot.posY[i] - radius <= bottom;
+            visible[k] = inside;
+            found += inside;
+        }
+        chunkOffsets[chunk + 1] = found;
+    });
+
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+    }
+    visibleCount = chunkOffsets[chunks];
+
+    matterVertices.resize(visibleCount * 4);
+    if (visibleCount == 0) return;
+    sf::Vertex* vertices = &matterVertices[0];
+
+    jobs.parallelFor(total, vertexChunk, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        sf::Vertex* quad = vertices + chunkOffsets[chunk] * 4;
+        for (std::size_t k = begin; k < end; ++k) {
+            if (!visible[k]) continue;
+            const std::uint32_t i = candidates[k];
+            const float radius = snapshot.radius[i];
+            writeQuad(quad, snapshot.posX[i] - radius, snapshot.posY[i] - radius, 2.0f * radius,
+                      snapshot.isColony[i] ? sf::Color::Green : sf::Color::White);
+            quad += 4;
+        }
+    });
+}
+
+void MatterRenderer::buildDensityTexture(const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea, const sf::Vector2u& targetSize) {
+    const unsigned cellPixels = std::max(densityCellPixels, 1u);
+    const unsigned columns = std::max((targetSize.x + cellPixels - 1) / cellPixels, 1u);
+    const unsigned rows = std::max((targetSize.y + cellPixels - 1) / cellPixels, 1u);
+    const std::size_t cells = static_cast<std::size_t>(columns) * rows;
+    const float cellWidth = visibleArea.width / columns;
+    const float cellHeight = visibleArea.height / rows;
+
+    if (columns != densityColumns || rows != densityRows) {
+        densityTexture.create(columns, rows);
+        densityTexture.setSmooth(true);
+        densitySprite.setTexture(densityTexture, true);
+        densityPixels.resize(cells * 4);
+        densityColumns = columns;
+        densityRows = rows;
+    }
+
+    // Тіла діляться на стільки шматків, скільки потоків у пулі; кожен шматок рахує свою гістограму
+    // (пари кількість/колонії поруч) без атомарних операцій і обнуляє її сам. Підготовка - прохід по всіх
+    // тілах плюс гістограми шматків; від пікселів екрана, а не від кількості тіл, залежать лише
+    // завантаження текстури й малювання
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t count = snapshot.size();
+    const std::size_t slices = static_cast<std::size_t>(jobs.threadCount());
+    const std::size_t grain = std::max<std::size_t>((count + slices - 1) / slices, 1);
+    const std::size_t team = (count + grain - 1) / grain;
+    threadBins.resize(std::max<std::size_t>(team, 1) * cells * 2);
+    const float left = visibleArea.left;
+    const float top = visibleArea.top;
+    const float inverseWidth = 1.0f / cellWidth;
+    const float inverseHeight = 1.0f / cellHeight;
+    const float* posX = snapshot.posX.data();
+    const float* posY = snapshot.posY.data();
+    const std::uint8_t* isColony = snapshot.isColony.data();
+
+    jobs.parallelFor(count, grain, [&](std::size_t slice, std::size_t begin, std::size_t end) {
+        std::uint32_t* bins = threadBins.data() + slice * cells * 2;
+        std::fill(bins, bins + cells * 2, 0u);
+        for (std::size_t i = begin; i < end; ++i) {
+            float column = (posX[i] - left) * inverseWidth;
+            float row = (posY[i] - top) * inverseHeight;
+            if (column < 0.0f || row < 0.0f || column >= columns || row >= rows) continue;
+            std::size_t cell = static_cast<std::size_t>(static_cast<unsigned>(row)) * columns + static_cast<unsigned>(column);
+            bins[2 * cell] += 1;
+            bins[2 * cell + 1] += isColony[i];
+        }
+    });
+
+    // Зведення в гістограму першого шматка, заодно найбільша густина для нормування
+    const std::size_t cellGrain = jobs.grainFor(cells);
+    const std::uint32_t maxCount = jobs.parallelReduce(cells, cellGrain, 0u, [&](std::size_t begin, std::size_t end, std::uint32_t& partial) {
+        for (std::size_t cell = begin; cell < end; ++cell) {
+            std::uint32_t bodies = 0;
+            std::uint32_t colonies = 0;
+            for (std::size_t t = 0; t < team; ++t) {
+                const std::size_t offset = t * cells * 2 + 2 * cell;
+                bodies += threadBins[offset];
+                colonies += threadBins[offset + 1];
+            }
+            threadBins[2 * cell] = bodies;
+            threadBins[2 * cell + 1] = colonies;
+            partial = std::max(partial, bodies);
+        }
+    }, [](std::uint32_t& result, std::uint32_t partial) { result = std::max(result, partial); });
+
+    // Логарифмічна шкала: поодинокі тіла на краях диска лишаються помітними поруч із щільним центром
+    const float scale = maxCount > 0 ? 1.0f / std::log(1.0f + maxCount) : 0.0f;
+    sf::Uint8* pixels = densityPixels.data();
+    jobs.parallelFor(cells, cellGrain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t cell = begin; cell < end; ++cell) {
+            sf::Uint8* pixel = pixels + 4 * cell;
+            const std::uint32_t bodies = threadBins[2 * cell];
+            if (bodies == 0) {
+                pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                continue;
+            }
+            const float level = std::log(1.0f + bodies) * scale;
+            const float position = std::min(level, 1.0f) * 2.999f;
+            const int segment = static_cast<int>(position);
+            const float blend = position - segment;
+            const float colony = static_cast<float>(threadBins[2 * cell + 1]) / bodies;
+            for (int channel = 0; channel < 3; ++channel) {
+                float value = densityRamp[segment][channel] + (densityRamp[segment + 1][channel] - densityRamp[segment][channel]) * blend;
+                value += (colonyColor[channel] - value) * colony;
+                pixel[channel] = static_cast<sf::Uint8>(value);
+            }
+            pixel[3] = static_cast<sf::Uint8>(140.0f + 115.0f * level);
+        }
+    });
+
+    densityTexture.update(pixels);
+    densitySprite.setPosition(left, top);
+    densitySprite.setScale(cellWidth, cellHeight);
+    visibleCount = count;
+}
+
+void MatterRenderer::buildShipVertices(const std::vector<Vec2>& ships, float radius, const sf::FloatRect& visibleArea) {
+    shipVertices.clear();
+    const float size = 2.0f * radius;
+    for (const Vec2& ship : ships) {
+        // Корабель малюється від лівого верхнього кута, як sf::CircleShape без origin
+        sf::FloatRect bounds(ship.x, ship.y, size, size);
+        if (!visibleArea.intersects(bounds)) continue;
+        sf::Vertex quad[4];
+        writeQuad(quad, ship.x, ship.y, size, sf::Color::Blue);
+        for (const auto& vertex : quad) shipVertices.append(vertex);
+    }
+}
+
+void MatterRenderer::draw(sf::RenderTarget& target, const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea) {
+    // Одиниць світу на піксель: коли тіла стають меншими за кілька пікселів, малюємо густину
+    const sf::Vector2u targetSize = target.getSize();
+    densityMode = levelOfDetail && targetSize.x > 0 && visibleArea.width / targetSize.x > densityThreshold;
+
+    {
+        KOSMOS_PROFILE_SCOPE("render build");
+        // Кораблі будуються на пулі, поки цей потік готує тіла (текстура густини - лише тут, бо GL)
+        JobGroup ships;
+        JobSystem::instance().run(ships, [&] {
+            KOSMOS_PROFILE_SCOPE("render ships");
+            buildShipVertices(snapshot.ships, snapshot.shipRadius, visibleArea);
+        });
+        if (densityMode) {
+            buildDensityTexture(snapshot, visibleArea, targetSize);
+        }
+        else {
+            buildMatterVertices(snapshot, visibleArea);
+        }
+        JobSystem::instance().wait(ships);
+    }
+
+    lastDrawCalls = 0;
+    if (densityMode) {
+        target.draw(densitySprite);
+        ++lastDrawCalls;
+    }
+    else if (matterVertices.getVertexCount() > 0) {
+        target.draw(matterVertices, &circleTexture);
+        ++lastDrawCalls;
+    }
+    if (shipVertices.getVertexCount() > 0) {
+        target.draw(shipVertices, &circleTexture);
+        ++lastDrawCalls;
+    }
+    KOSMOS_PROFILE_COUNT("draw calls", lastDrawCalls);
+}
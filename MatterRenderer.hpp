@@ -0,0 +1,57 @@
+﻿#ifndef MATTER_RENDERER_HPP
+#define MATTER_RENDERER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Grid.hpp"
+#include "PhysicsThread.hpp"
+
+// Пакетний рендер: усі видимі тіла пишуться в один sf::VertexArray (квадрати з текстурою кола)
+// і малюються одним викликом. Відсікання йде через сітку, вершини генеруються паралельно.
+// Коли камера віддалена (більше densityThreshold одиниць світу на піксель), тіла замість цього
+// розкладаються в сітку густини розміром з екран і малюються однією текстурою з колірною шкалою:
+// яскравість - кількість тіл у комірці, зелений відтінок - частка колоній.
+class MatterRenderer {
+public:
+    MatterRenderer();
+
+    void draw(sf::RenderTarget& target, const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea);
+
+    std::size_t visibleMatters() const { return visibleCount; }
+    std::size_t drawCalls() const { return lastDrawCalls; }
+    bool drawsDensity() const { return densityMode; }
+
+    float densityThreshold = 10.0f; // одиниць світу на піксель екрана
+    unsigned densityCellPixels = 2; // сторона комірки густини в пікселях
+    bool levelOfDetail = true;
+
+private:
+    void buildCircleTexture();
+    void buildMatterVertices(const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea);
+    void buildShipVertices(const std::vector<Vec2>& ships, float radius, const sf::FloatRect& visibleArea);
+    void buildDensityTexture(const SimulationSnapshot& snapshot, const sf::FloatRect& visibleArea, const sf::Vector2u& targetSize);
+
+    Grid cullGrid;
+    sf::Texture circleTexture;
+    sf::VertexArray matterVertices;
+    sf::VertexArray shipVertices;
+    std::vector<Grid::CellRange> visibleCells;
+    std::vector<std::uint32_t> candidates;
+    std::vector<std::uint8_t> visible;
+    std::vector<std::size_t> chunkOffsets;
+    std::size_t visibleCount = 0;
+    std::size_t lastDrawCalls = 0;
+
+    // Режим густини: гістограма на потік (кількість, колонії), потім зведення в пікселі
+    std::vector<std::uint32_t> threadBins;
+    std::vector<sf::Uint8> densityPixels;
+    sf::Texture densityTexture;
+    sf::Sprite densitySprite;
+    unsigned densityColumns = 0;
+    unsigned densityRows = 0;
+    bool densityMode = false;
+};
+
+#endif
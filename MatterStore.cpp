@@ -0,0 +1,168 @@
+﻿#include "MatterStore.hpp"
+#include "JobSystem.hpp"
+#include <utility>
+
+namespace {
+
+// values[k] = values[order[k]] через буфер scratch; після обміну в scratch лишається старий масив
+// того ж розміру, тож наступне поле того ж типу перевикористовує його без алокації
+template <class T>
+void gatherInto(std::vector<T>& values, const std::vector<std::uint32_t>& order, std::vector<T>& scratch) {
+    scratch.resize(values.size());
+    const T* source = values.data();
+    T* destination = scratch.data();
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(order.size(), jobs.grainFor(order.size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            destination[k] = source[order[k]];
+        }
+    });
+    values.swap(scratch);
+}
+
+}
+
+void MatterStore::reserve(std::size_t count) {
+    posX.reserve(count);
+    posY.reserve(count);
+    velX.reserve(count);
+    velY.reserve(count);
+    accX.reserve(count);
+    accY.reserve(count);
+    mass.reserve(count);
+    radius.reserve(count);
+    isColony.reserve(count);
+    hasShip.reserve(count);
+    isTargeted.reserve(count);
+    bodySlot.reserve(count);
+}
+
+void MatterStore::resize(std::size_t count) {
+    const std::size_t oldSize = size();
+    for (std::size_t i = count; i < oldSize; ++i) {
+        releaseSlot(bodySlot[i]);
+    }
+    truncate(count);
+    for (std::size_t i = oldSize; i < count; ++i) {
+        bodySlot[i] = acquireSlot(i);
+    }
+}
+
+void MatterStore::truncate(std::size_t count) {
+    posX.resize(count);
+    posY.resize(count);
+    velX.resize(count);
+    velY.resize(count);
+    accX.resize(count);
+    accY.resize(count);
+    mass.resize(count);
+    radius.resize(count);
+    isColony.resize(count);
+    hasShip.resize(count);
+    isTargeted.resize(count);
+    bodySlot.resize(count);
+}
+
+void MatterStore::clear() {
+    resize(0);
+}
+
+std::size_t MatterStore::add(float r, float m, const Vec2& position, const Vec2& velocity) {
+    posX.push_back(position.x);
+    posY.push_back(position.y);
+    velX.push_back(velocity.x);
+    velY.push_back(velocity.y);
+    accX.push_back(0.0f);
+    accY.push_back(0.0f);
+    mass.push_back(m);
+    radius.push_back(r);
+    isColony.push_back(0);
+    hasShip.push_back(0);
+    isTargeted.push_back(0);
+    bodySlot.push_back(acquireSlot(size() - 1));
+    return size() - 1;
+}
+
+std::uint32_t MatterStore::acquireSlot(std::size_t index) {
+    std::uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = static_cast<std::uint32_t>(slotIndex.size());
+        slotIndex.push_back(0);
+        slotGeneration.push_back(0);
+    }
+    slotIndex[slot] = static_cast<std::uint32_t>(index);
+    return slot;
+}
+
+void MatterStore::releaseSlot(std::uint32_t slot) {
+    // Нове покоління робить усі видані дескриптори цього слота застарілими
+    ++slotGeneration[slot];
+    freeSlots.push_back(slot);
+}
+
+void MatterStore::restoreSlots(std::vector<std::uint32_t> indices, std::vector<std::uint32_t> generations, std::vector<std::uint32_t> freeList) {
+    slotIndex = std::move(indices);
+    slotGeneration = std::move(generations);
+    freeSlots = std::move(freeList);
+}
+
+void MatterStore::moveBody(std::size_t from, std::size_t to) {
+    posX[to] = posX[from];
+    posY[to] = posY[from];
+    velX[to] = velX[from];
+    velY[to] = velY[from];
+    accX[to] = accX[from];
+    accY[to] = accY[from];
+    mass[to] = mass[from];
+    radius[to] = radius[from];
+    isColony[to] = isColony[from];
+    hasShip[to] = hasShip[from];
+    isTargeted[to] = isTargeted[from];
+    bodySlot[to] = bodySlot[from];
+    slotIndex[bodySlot[to]] = static_cast<std::uint32_t>(to);
+}
+
+std::size_t MatterStore::removeSwap(const std::vector<std::uint32_t>& indices, std::vector<BodyMove>* moves) {
+    if (moves) moves->clear();
+
+    // Від більших індексів до менших: останнє тіло ніколи не є ще не видаленим кандидатом
+    std::size_t end = size();
+    for (std::size_t k = indices.size(); k-- > 0;) {
+        const std::uint32_t removed = indices[k];
+        const std::uint32_t last = static_cast<std::uint32_t>(end - 1);
+        releaseSlot(bodySlot[removed]);
+        if (removed != last) moveBody(last, removed);
+        if (moves) moves->push_back(BodyMove{ removed, last });
+        --end;
+    }
+
+    truncate(end);
+    return indices.size();
+}
+
+void MatterStore::permute(const std::vector<std::uint32_t>& order) {
+    std::vector<float> floats;
+    gatherInto(posX, order, floats);
+    gatherInto(posY, order, floats);
+    gatherInto(velX, order, floats);
+    gatherInto(velY, order, floats);
+    gatherInto(accX, order, floats);
+    gatherInto(accY, order, floats);
+    gatherInto(mass, order, floats);
+    gatherInto(radius, order, floats);
+
+    std::vector<std::uint8_t> flags;
+    gatherInto(isColony, order, flags);
+    gatherInto(hasShip, order, flags);
+    gatherInto(isTargeted, order, flags);
+
+    std::vector<std::uint32_t> slots;
+    gatherInto(bodySlot, order, slots);
+    for (std::size_t k = 0; k < bodySlot.size(); ++k) {
+        slotIndex[bodySlot[k]] = static_cast<std::uint32_t>(k);
+    }
+}
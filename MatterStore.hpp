@@ -0,0 +1,102 @@
+﻿#ifndef MATTER_STORE_HPP
+#define MATTER_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vec2.hpp"
+
+// Позначка "тіла немає" для індексів
+const std::size_t noMatter = static_cast<std::size_t>(-1);
+
+// Стабільне посилання на тіло: слот + покоління. Індекс тіла змінюється при видаленнях,
+// а дескриптор лишається дійсним, доки тіло живе; після видалення він просто "застаріває".
+struct BodyHandle {
+    std::uint32_t slot = 0xFFFFFFFFu;
+    std::uint32_t generation = 0;
+
+    bool valid() const { return slot != 0xFFFFFFFFu; }
+    bool operator==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+};
+
+const BodyHandle noBody = BodyHandle();
+
+// Одне видалення swap-and-pop: тіло removed зникло, на його індекс переїхало тіло movedFrom
+// (movedFrom == removed, якщо видалене тіло було останнім)
+struct BodyMove {
+    std::uint32_t removed;
+    std::uint32_t movedFrom;
+};
+
+// Матерія у вигляді паралельних масивів (structure-of-arrays).
+// Кожне тіло займає ~47 байт замість sf::CircleShape на сотні байт,
+// а ядра симуляції читають лише ті поля, які їм потрібні.
+class MatterStore {
+public:
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> velX;
+    std::vector<float> velY;
+    std::vector<float> accX; // прискорення з кінця минулого кроку (для leapfrog)
+    std::vector<float> accY;
+    std::vector<float> mass;
+    std::vector<float> radius;
+    std::vector<std::uint8_t> isColony;
+    std::vector<std::uint8_t> hasShip;
+    std::vector<std::uint8_t> isTargeted;
+    std::vector<std::uint32_t> bodySlot; // слот дескриптора, що веде на це тіло
+
+    std::size_t size() const { return posX.size(); }
+    bool empty() const { return posX.empty(); }
+
+    void reserve(std::size_t count);
+    void resize(std::size_t count);
+    void clear();
+    std::size_t add(float radius, float mass, const Vec2& position, const Vec2& velocity);
+
+    Vec2 position(std::size_t i) const { return Vec2(posX[i], posY[i]); }
+    Vec2 velocity(std::size_t i) const { return Vec2(velX[i], velY[i]); }
+    void setPosition(std::size_t i, const Vec2& p) { posX[i] = p.x; posY[i] = p.y; }
+    void setVelocity(std::size_t i, const Vec2& v) { velX[i] = v.x; velY[i] = v.y; }
+
+    BodyHandle handleOf(std::size_t i) const { return BodyHandle{ bodySlot[i], slotGeneration[bodySlot[i]] }; }
+    // Поточний індекс тіла або noMatter, якщо тіло вже видалене
+    std::size_t indexOf(const BodyHandle& handle) const {
+        if (handle.slot >= slotGeneration.size() || slotGeneration[handle.slot] != handle.generation) return noMatter;
+        return slotIndex[handle.slot];
+    }
+    bool alive(const BodyHandle& handle) const { return indexOf(handle) != noMatter; }
+
+    // Видаляє тіла за індексами (унікальні, за зростанням) методом swap-and-pop:
+    // O(видалених) переміщень, порядок решти тіл не зберігається.
+    // moves (необов'язково) отримує кожне переміщення в порядку виконання.
+    std::size_t removeSwap(const std::vector<std::uint32_t>& indices, std::vector<BodyMove>* moves = nullptr);
+
+    // Переставляє тіла: нове тіло k - колишнє order[k] (перестановка всіх індексів).
+    // Таблиця слотів оновлюється, тож дескриптори кораблів і колоній лишаються дійсними
+    void permute(const std::vector<std::uint32_t>& order);
+
+    // Таблиця слотів як є (для знімків; відновлення зберігає дескриптори кораблів дійсними)
+    const std::vector<std::uint32_t>& slotIndices() const { return slotIndex; }
+    const std::vector<std::uint32_t>& slotGenerations() const { return slotGeneration; }
+    const std::vector<std::uint32_t>& freeSlotList() const { return freeSlots; }
+    void restoreSlots(std::vector<std::uint32_t> indices, std::vector<std::uint32_t> generations, std::vector<std::uint32_t> freeList);
+
+    static constexpr std::size_t bytesPerBody() {
+        // + слот тіла і запис у таблиці слотів (індекс, покоління)
+        return 8 * sizeof(float) + 3 * sizeof(std::uint32_t) + 3 * sizeof(std::uint8_t);
+    }
+
+private:
+    void truncate(std::size_t count);
+    void moveBody(std::size_t from, std::size_t to);
+    std::uint32_t acquireSlot(std::size_t index);
+    void releaseSlot(std::uint32_t slot);
+
+    std::vector<std::uint32_t> slotIndex;      // слот -> індекс тіла
+    std::vector<std::uint32_t> slotGeneration; // зростає, коли слот звільняється
+    std::vector<std::uint32_t> freeSlots;
+};
+
+#endif
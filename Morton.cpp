@@ -0,0 +1,54 @@
+#include "Morton.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+
+float computeMortonKeys(const float* posX, const float* posY, std::size_t bodyCount, std::vector<std::uint32_t>& keys, std::vector<std::uint32_t>& order) {
+    keys.resize(bodyCount);
+    order.resize(bodyCount);
+    if (bodyCount == 0) return 1.0f;
+
+    typedef std::array<float, 4> Bounds; // min x, min y, max x, max y
+    const Bounds empty = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(bodyCount);
+    const Bounds bounds = jobs.parallelReduce(bodyCount, grain, empty, [&](std::size_t begin, std::size_t end, Bounds& partial) {
+        for (std::size_t i = begin; i < end; ++i) {
+            partial[0] = std::min(partial[0], posX[i]);
+            partial[1] = std::min(partial[1], posY[i]);
+            partial[2] = std::max(partial[2], posX[i]);
+            partial[3] = std::max(partial[3], posY[i]);
+        }
+    }, [](Bounds& result, const Bounds& partial) {
+        result = { std::min(result[0], partial[0]), std::min(result[1], partial[1]),
+                   std::max(result[2], partial[2]), std::max(result[3], partial[3]) };
+    });
+    const float minX = bounds[0];
+    const float minY = bounds[1];
+    const float maxX = bounds[2];
+    const float maxY = bounds[3];
+
+    const float size = std::max(maxX - minX, maxY - minY) * 1.0001f + 1.0f;
+    const float scale = 65536.0f / size;
+
+    jobs.parallelFor(bodyCount, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::uint32_t qx = std::min<std::uint32_t>(static_cast<std::uint32_t>((posX[i] - minX) * scale), 65535u);
+            std::uint32_t qy = std::min<std::uint32_t>(static_cast<std::uint32_t>((posY[i] - minY) * scale), 65535u);
+            keys[i] = mortonKey(qx, qy);
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+    return size;
+}
+
+std::size_t countMortonDescents(const std::vector<std::uint32_t>& keys) {
+    JobSystem& jobs = JobSystem::instance();
+    return jobs.parallelReduce(keys.size(), jobs.grainFor(keys.size()), std::size_t(0), [&](std::size_t begin, std::size_t end, std::size_t& partial) {
+        for (std::size_t k = std::max<std::size_t>(begin, 1); k < end; ++k) {
+            if (keys[k] < keys[k - 1]) ++partial;
+        }
+    }, [](std::size_t& result, std::size_t partial) { result += partial; });
+}
@@ -0,0 +1,31 @@
+﻿#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Z-порядок (коди Мортона): біти 16-бітних координат x і y чергуються,
+// тож точки, близькі в просторі, здебільшого мають близькі ключі.
+inline std::uint32_t spreadMortonBits(std::uint32_t v) {
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+inline std::uint32_t mortonKey(std::uint32_t qx, std::uint32_t qy) {
+    return spreadMortonBits(qx) | (spreadMortonBits(qy) << 1);
+}
+
+// Ключі точок у квадраті, що вміщує їх усі (65536 x 65536 комірок), і тотожний порядок order.
+// Повертає сторону квадрата. Дерево Барнса–Хата й упорядкування сховища беруть ті самі ключі,
+// тож дерево, побудоване одразу після упорядкування, бачить уже відсортований масив.
+float computeMortonKeys(const float* posX, const float* posY, std::size_t count, std::vector<std::uint32_t>& keys, std::vector<std::uint32_t>& order);
+
+// Кількість місць, де ключ менший за попередній (0 - масив уже відсортований)
+std::size_t countMortonDescents(const std::vector<std::uint32_t>& keys);
+
+#endif
@@ -0,0 +1,54 @@
+﻿#ifndef PARALLEL_SORT_HPP
+#define PARALLEL_SORT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "JobSystem.hpp"
+
+// Стабільне паралельне LSD-радіксне сортування пар (ключ, значення) по 8 біт за прохід на пулі JobSystem.
+// Кожен шматок має власну гістограму; сортування стабільне, тож результат не залежить від кількості потоків.
+inline void radixSortPairs(std::vector<std::uint32_t>& keys, std::vector<std::uint32_t>& values, int keyBits = 32) {
+    const std::size_t count = keys.size();
+    std::vector<std::uint32_t> keysTmp(count);
+    std::vector<std::uint32_t> valuesTmp(count);
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    std::vector<std::size_t> histograms(chunks * 256);
+
+    for (int shift = 0; shift < keyBits; shift += 8) {
+        jobs.parallelFor(count, grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::size_t* histogram = histograms.data() + chunk * 256;
+            std::fill(histogram, histogram + 256, 0);
+            for (std::size_t i = begin; i < end; ++i) {
+                ++histogram[(keys[i] >> shift) & 0xFF];
+            }
+        });
+
+        std::size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+                std::size_t& slot = histograms[chunk * 256 + digit];
+                std::size_t bucket = slot;
+                slot = offset;
+                offset += bucket;
+            }
+        }
+
+        jobs.parallelFor(count, grain, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::size_t* histogram = histograms.data() + chunk * 256;
+            for (std::size_t i = begin; i < end; ++i) {
+                std::size_t destination = histogram[(keys[i] >> shift) & 0xFF]++;
+                keysTmp[destination] = keys[i];
+                valuesTmp[destination] = values[i];
+            }
+        });
+
+        keys.swap(keysTmp);
+        values.swap(valuesTmp);
+    }
+}
+
+#endif
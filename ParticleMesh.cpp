@@ -0,0 +1,354 @@
+﻿#include "ParticleMesh.hpp"
+#include "JobSystem.hpp"
+#include "ParallelSort.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+typedef std::complex<float> Complex;
+
+// Стовпці перетворюються групами: рядок групи - одна кеш-лінія
+const int columnGroup = 8;
+
+// Рядків сітки на шматок пулу
+const std::size_t rowGrain = 8;
+
+// Множення без перевірок NaN/Inf, які std::complex робить через __mulsc3
+inline Complex multiply(const Complex& a, const Complex& b) {
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+// Ітеративне FFT за основою 2 на місці; inverse - без нормування (воно вже в спектрі ядра)
+void fft(Complex* line, int n, const Complex* twiddles, const std::uint32_t* reverse, bool inverse) {
+    for (int i = 0; i < n; ++i) {
+        int j = static_cast<int>(reverse[i]);
+        if (i < j) std::swap(line[i], line[j]);
+    }
+    for (int half = 1; half < n; half <<= 1) {
+        const int stride = n / (2 * half);
+        for (int start = 0; start < n; start += 2 * half) {
+            for (int k = 0; k < half; ++k) {
+                Complex w = twiddles[k * stride];
+                if (inverse) w = std::conj(w);
+                Complex u = line[start + k];
+                Complex v = multiply(line[start + k + half], w);
+                line[start + k] = u + v;
+                line[start + k + half] = u - v;
+            }
+        }
+    }
+}
+
+}
+
+ParticleMesh::ParticleMesh(int resolution, float softening)
+    : resolution(resolution), softening(softening) {
+}
+
+void ParticleMesh::prepareTransform(int n) {
+    if (static_cast<int>(bitReverse.size()) == n) return;
+    int bits = 0;
+    while ((1 << bits) < n) ++bits;
+    bitReverse.resize(n);
+    for (int i = 0; i < n; ++i) {
+        std::uint32_t r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1u << (bits - 1 - b);
+        }
+        bitReverse[i] = r;
+    }
+    twiddles.resize(n / 2);
+    for (int k = 0; k < n / 2; ++k) {
+        double angle = -2.0 * 3.14159265358979323846 * k / n;
+        twiddles[k] = Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+}
+
+void ParticleMesh::build(const MatterStore& matters) {
+    const std::size_t count = matters.size();
+    if (count == 0) {
+        size = 0;
+        return;
+    }
+
+    int n = 16;
+    while (n < resolution && n < 2048) n <<= 1;
+    size = n;
+    padded = 2 * n;
+    prepareTransform(padded);
+
+    const float* posX = matters.posX.data();
+    const float* posY = matters.posY.data();
+
+    typedef std::array<float, 4> Bounds; // min x, min y, max x, max y
+    const Bounds empty = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+    const Bounds bounds = jobs.parallelReduce(count, grain, empty, [&](std::size_t begin, std::size_t end, Bounds& partial) {
+        for (std::size_t i = begin; i < end; ++i) {
+            partial[0] = std::min(partial[0], posX[i]);
+            partial[1] = std::min(partial[1], posY[i]);
+            partial[2] = std::max(partial[2], posX[i]);
+            partial[3] = std::max(partial[3], posY[i]);
+        }
+    }, [](Bounds& result, const Bounds& partial) {
+        result = { std::min(result[0], partial[0]), std::min(result[1], partial[1]),
+                   std::max(result[2], partial[2]), std::max(result[3], partial[3]) };
+    });
+    const float minX = bounds[0];
+    const float minY = bounds[1];
+    const float maxX = bounds[2];
+    const float maxY = bounds[3];
+
+    // Комірка округлюється вгору до кроку 2^(1/8), щоб спектр ядра не перераховувався щокроку,
+    // а поле по краях лишало запас у півтори комірки для інтерполяції
+    const float extent = std::max(std::max(maxX - minX, maxY - minY), 1.0f);
+    cell = std::exp2(std::ceil(8.0f * std::log2(extent / (n - 3))) / 8.0f);
+    originX = 0.5f * (minX + maxX) - 0.5f * cell * (n - 1);
+    originY = 0.5f * (minY + maxY) - 0.5f * cell * (n - 1);
+    const float inverseCell = 1.0f / cell;
+
+    // Тіла сортуються радіксом за ключем комірки (пам'ять і робота - O(N + M^2), а не на кожен потік).
+    // Сортування стабільне: усередині комірки тіла йдуть у порядку індексів, тож результат не залежить від потоків
+    const std::size_t cells = static_cast<std::size_t>(n) * n;
+    int keyBits = 0;
+    while ((std::size_t(1) << keyBits) < cells) ++keyBits;
+    keys.resize(count);
+    order.resize(count);
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedMass.resize(count);
+    cellStart.resize(cells + 1);
+
+    jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            int column = std::min(std::max(static_cast<int>((posX[i] - originX) * inverseCell), 0), n - 2);
+            int row = std::min(std::max(static_cast<int>((posY[i] - originY) * inverseCell), 0), n - 2);
+            keys[i] = static_cast<std::uint32_t>(row) * n + static_cast<std::uint32_t>(column);
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+    radixSortPairs(keys, order, keyBits);
+
+    // Початок комірки - перше тіло з ключем не меншим за неї: кожна комірка пишеться рівно одним тілом
+    const float* mass = matters.mass.data();
+    jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint32_t first = i == 0 ? 0 : keys[i - 1] + 1;
+            for (std::uint32_t c = first; c <= keys[i]; ++c) cellStart[c] = static_cast<std::uint32_t>(i);
+            const std::uint32_t body = order[i];
+            sortedX[i] = posX[body];
+            sortedY[i] = posY[body];
+            sortedMass[i] = mass[body];
+        }
+    });
+    std::fill(cellStart.begin() + keys[count - 1] + 1, cellStart.end(), static_cast<std::uint32_t>(count));
+
+    prepareKernel();
+    deposit();
+    transformRows(n, false);
+    transformColumns(false);
+
+    jobs.parallelFor(work.size(), jobs.grainFor(work.size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            work[k] *= kernelSpectrum[k];
+        }
+    });
+
+    transformColumns(true);
+    transformRows(n, true);
+    differentiate();
+}
+
+void ParticleMesh::prepareKernel() {
+    const float eps = std::max(softening, cell);
+    if (kernelSize == size && kernelCell == cell && kernelSoftening == eps && kernelConstant == gravitationalConstant) return;
+
+    // Потенціал точкової маси -G / sqrt(r^2 + eps^2) з відстанями "по колу" подвоєної сітки:
+    // маса займає лише першу чверть, тож образи не дістають до неї
+    const int m = padded;
+    const float eps2 = eps * eps;
+    const float scale = -gravitationalConstant / (static_cast<float>(m) * m);
+    work.assign(static_cast<std::size_t>(m) * m, Complex());
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(m, rowGrain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (int j = static_cast<int>(begin); j < static_cast<int>(end); ++j) {
+            const float dy = (j <= size ? j : j - m) * cell;
+            for (int i = 0; i < m; ++i) {
+                const float dx = (i <= size ? i : i - m) * cell;
+                work[static_cast<std::size_t>(j) * m + i] = Complex(scale / std::sqrt(dx * dx + dy * dy + eps2), 0.0f);
+            }
+        }
+    });
+    transformRows(m, false);
+    transformColumns(false);
+
+    kernelSpectrum.resize(work.size());
+    jobs.parallelFor(work.size(), jobs.grainFor(work.size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            kernelSpectrum[k] = work[k].real();
+        }
+    });
+
+    kernelSize = size;
+    kernelCell = cell;
+    kernelSoftening = eps;
+    kernelConstant = gravitationalConstant;
+}
+
+void ParticleMesh::deposit() {
+    // Вузол (i, j) збирає тіла з чотирьох комірок, що його торкаються: кожне тіло
+    // розкладає масу на 4 вузли з білінійними вагами (cloud-in-cell)
+    const int n = size;
+    const int m = padded;
+    const float inverseCell = 1.0f / cell;
+    work.resize(static_cast<std::size_t>(m) * m);
+
+    JobSystem::instance().parallelFor(m, rowGrain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (int j = static_cast<int>(begin); j < static_cast<int>(end); ++j) {
+            Complex* row = work.data() + static_cast<std::size_t>(j) * m;
+            std::fill(row, row + m, Complex());
+            if (j >= n) continue;
+            for (int i = 0; i < n; ++i) {
+                float mass = 0.0f;
+                for (int cj = std::max(j - 1, 0); cj <= std::min(j, n - 2); ++cj) {
+                    for (int ci = std::max(i - 1, 0); ci <= std::min(i, n - 2); ++ci) {
+                        const std::size_t c = static_cast<std::size_t>(cj) * n + ci;
+                        for (std::uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+                            float tx = std::min(std::max((sortedX[k] - originX) * inverseCell - ci, 0.0f), 1.0f);
+                            float ty = std::min(std::max((sortedY[k] - originY) * inverseCell - cj, 0.0f), 1.0f);
+                            float wx = ci == i ? 1.0f - tx : tx;
+                            float wy = cj == j ? 1.0f - ty : ty;
+                            mass += sortedMass[k] * wx * wy;
+                        }
+                    }
+                }
+                row[i] = Complex(mass, 0.0f);
+            }
+        }
+    });
+}
+
+void ParticleMesh::transformRows(int rows, bool inverse) {
+    const int m = padded;
+    JobSystem::instance().parallelFor(rows, rowGrain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t j = begin; j < end; ++j) {
+            fft(work.data() + j * m, m, twiddles.data(), bitReverse.data(), inverse);
+        }
+    });
+}
+
+void ParticleMesh::transformColumns(bool inverse) {
+    const int m = padded;
+    const int groups = m / columnGroup;
+    // Буфер групи - на шматок, а не на кожну групу
+    JobSystem::instance().parallelFor(groups, 4, [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::vector<Complex> lines(static_cast<std::size_t>(columnGroup) * m);
+        for (std::size_t group = begin; group < end; ++group) {
+            const std::size_t first = group * columnGroup;
+            for (int j = 0; j < m; ++j) {
+                const Complex* source = work.data() + static_cast<std::size_t>(j) * m + first;
+                for (int c = 0; c < columnGroup; ++c) lines[static_cast<std::size_t>(c) * m + j] = source[c];
+            }
+            for (int c = 0; c < columnGroup; ++c) {
+                fft(lines.data() + static_cast<std::size_t>(c) * m, m, twiddles.data(), bitReverse.data(), inverse);
+            }
+            for (int j = 0; j < m; ++j) {
+                Complex* target = work.data() + static_cast<std::size_t>(j) * m + first;
+                for (int c = 0; c < columnGroup; ++c) target[c] = lines[static_cast<std::size_t>(c) * m + j];
+            }
+        }
+    });
+}
+
+void ParticleMesh::differentiate() {
+    // a = -grad(phi): центральні різниці, на краях - односторонні
+    const int n = size;
+    const int m = padded;
+    const float inverseCell = 1.0f / cell;
+    fieldX.resize(static_cast<std::size_t>(n) * n);
+    fieldY.resize(static_cast<std::size_t>(n) * n);
+    auto potential = [&](int i, int j) { return work[static_cast<std::size_t>(j) * m + i].real(); };
+
+    JobSystem::instance().parallelFor(n, rowGrain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (int j = static_cast<int>(begin); j < static_cast<int>(end); ++j) {
+            const int down = std::max(j - 1, 0);
+            const int up = std::min(j + 1, n - 1);
+            for (int i = 0; i < n; ++i) {
+                const int left = std::max(i - 1, 0);
+                const int right = std::min(i + 1, n - 1);
+                fieldX[static_cast<std::size_t>(j) * n + i] = -(potential(right, j) - potential(left, j)) * inverseCell / (right - left);
+                fieldY[static_cast<std::size_t>(j) * n + i] = -(potential(i, up) - potential(i, down)) * inverseCell / (up - down);
+            }
+        }
+    });
+}
+
+Vec2 ParticleMesh::accelerationAt(float x, float y) const {
+    if (size == 0) return Vec2();
+    const float fx = (x - originX) / cell;
+    const float fy = (y - originY) / cell;
+    if (fx < 0.0f || fy < 0.0f || fx > size - 1 || fy > size - 1) return Vec2();
+    const int i = std::min(static_cast<int>(fx), size - 2);
+    const int j = std::min(static_cast<int>(fy), size - 2);
+    const float tx = fx - i;
+    const float ty = fy - j;
+    const std::size_t c = static_cast<std::size_t>(j) * size + i;
+    const float w00 = (1.0f - tx) * (1.0f - ty);
+    const float w10 = tx * (1.0f - ty);
+    const float w01 = (1.0f - tx) * ty;
+    const float w11 = tx * ty;
+    return Vec2(w00 * fieldX[c] + w10 * fieldX[c + 1] + w01 * fieldX[c + size] + w11 * fieldX[c + size + 1],
+                w00 * fieldY[c] + w10 * fieldY[c + 1] + w01 * fieldY[c + size] + w11 * fieldY[c + size + 1]);
+}
+
+template <class Visitor>
+void ParticleMesh::forEachAcceleration(const MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, Visitor&& visit) const {
+    const std::size_t count = size > 0 ? matters.size() : 0;
+    const float* posX = matters.posX.data();
+    const float* posY = matters.posY.data();
+
+    // Поле (кілька МБ) лежить у кеші, тож тіла йдуть у своєму порядку, а запис - послідовний
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const float x = posX[i];
+            const float y = posY[i];
+            Vec2 acceleration = accelerationAt(x, y);
+
+            // Чорна діра як важке тіло: її внесок рахується точно, сітка його не згладжує
+            if (blackHoleMass > 0.0f) {
+                float dx = blackHolePosition.x - x;
+                float dy = blackHolePosition.y - y;
+                float distance = std::sqrt(dx * dx + dy * dy);
+                float pull = blackHoleMass / (distance * distance * distance);
+                acceleration.x += dx * pull;
+                acceleration.y += dy * pull;
+            }
+
+            visit(i, acceleration);
+        }
+    });
+}
+
+void ParticleMesh::applyToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float deltaTime) const {
+    float* velX = matters.velX.data();
+    float* velY = matters.velY.data();
+    forEachAcceleration(matters, blackHolePosition, blackHoleMass, [&](std::size_t i, const Vec2& acceleration) {
+        velX[i] += acceleration.x * deltaTime;
+        velY[i] += acceleration.y * deltaTime;
+    });
+}
+
+void ParticleMesh::storeAccelerations(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass) const {
+    float* accX = matters.accX.data();
+    float* accY = matters.accY.data();
+    forEachAcceleration(matters, blackHolePosition, blackHoleMass, [&](std::size_t i, const Vec2& acceleration) {
+        accX[i] = acceleration.x;
+        accY[i] = acceleration.y;
+    });
+}
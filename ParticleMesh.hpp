@@ -0,0 +1,75 @@
+﻿#ifndef PARTICLE_MESH_HPP
+#define PARTICLE_MESH_HPP
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MatterStore.hpp"
+
+// Гравітація частинки-сітка (PM) для мільйонів тіл: маса розкладається на сітку (cloud-in-cell),
+// потенціал - згортка з тим самим законом 1/r^2, що й у дереві, через FFT на подвоєній сітці
+// (без періодичних образів), сили - різниці потенціалу, інтерпольовані назад до тіл.
+// Вартість - O(N) + O(M^2 log M) замість O(N log N) дерева; точність обмежена коміркою,
+// тож близькі зустрічі згладжені, а крупна динаміка диска зберігається.
+class ParticleMesh {
+public:
+    int resolution;     // вузлів сітки на бік, степінь двійки до 2048 (FFT іде на 2 * resolution)
+    float softening;    // згладжування; фактично не менше за розмір комірки
+    float gravitationalConstant = 1.0f;
+
+    explicit ParticleMesh(int resolution = 512, float softening = 10.0f);
+
+    void build(const MatterStore& matters);
+
+    // Прискорення від сітки в довільній точці (нуль поза сіткою)
+    Vec2 accelerationAt(float x, float y) const;
+
+    // Той самий інтерфейс, що й у BarnesHutTree: чорна діра додається точно, як важке тіло
+    void applyToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float deltaTime) const;
+    void storeAccelerations(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass) const;
+
+    float cellSize() const { return cell; }
+    int gridSize() const { return size; }
+
+private:
+    typedef std::complex<float> Complex;
+
+    void prepareTransform(int padded);
+    void prepareKernel();
+    void deposit();
+    void transformRows(int rows, bool inverse);
+    void transformColumns(bool inverse);
+    void differentiate();
+    template <class Visitor>
+    void forEachAcceleration(const MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, Visitor&& visit) const;
+
+    int size = 0;       // поточна сторона сітки
+    int padded = 0;     // 2 * size
+    float cell = 1.0f;
+    float originX = 0.0f;
+    float originY = 0.0f;
+
+    // Спектр функції Гріна перераховується, лише коли змінюються комірка, згладжування чи G
+    float kernelCell = 0.0f;
+    float kernelSoftening = 0.0f;
+    float kernelConstant = 0.0f;
+    int kernelSize = 0;
+    std::vector<float> kernelSpectrum; // дійсний: ядро парне
+
+    std::vector<Complex> twiddles;
+    std::vector<std::uint32_t> bitReverse;
+    std::vector<Complex> work;         // padded x padded
+    std::vector<float> fieldX;         // size x size, прискорення у вузлах
+    std::vector<float> fieldY;
+
+    // Тіла, відсортовані за коміркою: внесок у вузол збирається без гонок і не залежить від потоків
+    std::vector<std::uint32_t> keys;
+    std::vector<std::uint32_t> cellStart;
+    std::vector<std::uint32_t> order;
+    std::vector<float> sortedX;
+    std::vector<float> sortedY;
+    std::vector<float> sortedMass;
+};
+
+#endif
@@ -0,0 +1,51 @@
+﻿#ifndef PHILOX_HPP
+#define PHILOX_HPP
+
+#include <cstdint>
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", 2011).
+// Лічильниковий генератор: випадкові числа - чиста функція (ключ, лічильник), без стану,
+// тож кожне тіло отримує свої числа за індексом незалежно від потоку й порядку обходу.
+class Philox4x32 {
+public:
+    struct Block {
+        std::uint32_t v[4];
+    };
+
+    explicit Philox4x32(std::uint64_t seed)
+        : key0(static_cast<std::uint32_t>(seed)), key1(static_cast<std::uint32_t>(seed >> 32)) {
+    }
+
+    Block operator()(std::uint32_t c0, std::uint32_t c1, std::uint32_t c2, std::uint32_t c3) const {
+        Block counter = { { c0, c1, c2, c3 } };
+        std::uint32_t k0 = key0;
+        std::uint32_t k1 = key1;
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            std::uint64_t product0 = static_cast<std::uint64_t>(0xD2511F53u) * counter.v[0];
+            std::uint64_t product1 = static_cast<std::uint64_t>(0xCD9E8D57u) * counter.v[2];
+            Block next = { {
+                static_cast<std::uint32_t>(product1 >> 32) ^ counter.v[1] ^ k0,
+                static_cast<std::uint32_t>(product1),
+                static_cast<std::uint32_t>(product0 >> 32) ^ counter.v[3] ^ k1,
+                static_cast<std::uint32_t>(product0)
+            } };
+            counter = next;
+        }
+        return counter;
+    }
+
+    // [0, 1) з 24 старших бітів
+    static float uniform(std::uint32_t bits) { return (bits >> 8) * (1.0f / 16777216.0f); }
+    // (0, 1] - безпечно для логарифма
+    static float uniformPositive(std::uint32_t bits) { return ((bits >> 8) + 1) * (1.0f / 16777216.0f); }
+
+private:
+    std::uint32_t key0;
+    std::uint32_t key1;
+};
+
+#endif
@@ -0,0 +1,179 @@
+﻿#include "PhysicsThread.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+
+PhysicsThread::PhysicsThread(Simulation& simulation, float fixedStep)
+    : fixedStep(fixedStep), simulation(simulation) {
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start() {
+    if (running.load()) return;
+    publish(); // рендер має що малювати ще до першого кроку
+    rewind.record(simulation, fixedStep);
+    running.store(true);
+    worker = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+    running.store(false);
+    if (worker.joinable()) worker.join();
+}
+
+void PhysicsThread::post(std::function<void(Simulation&)> command) {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    commands.push_back(std::move(command));
+}
+
+bool PhysicsThread::runCommands() {
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        runningCommands.swap(commands);
+    }
+    if (runningCommands.empty()) return false;
+    for (auto& command : runningCommands) {
+        command(simulation);
+    }
+    runningCommands.clear();
+    return true;
+}
+
+void PhysicsThread::run() {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point last = Clock::now();
+    double accumulator = 0.0;
+    Profiler::instance().nameThread("physics");
+
+    while (running.load()) {
+        bool changed = runCommands();
+        if (changed) rewind.markKeyframe();
+
+        Clock::time_point now = Clock::now();
+        const float scale = timeScaleValue.load();
+        accumulator += std::chrono::duration<double>(now - last).count() * std::max(scale, 0.0f);
+        last = now;
+
+        int steps = 0;
+        while (accumulator >= fixedStep && steps < maxStepsPerUpdate) {
+            simulation.step(fixedStep);
+            rewind.record(simulation, fixedStep);
+            accumulator -= fixedStep;
+            simulatedTime += fixedStep;
+            ++steps;
+        }
+        // Фізика не встигає за timeScale: відкидаємо борг, щоб не накопичувати його без кінця
+        if (steps == maxStepsPerUpdate && accumulator >= fixedStep) accumulator = 0.0;
+
+        if (steps > 0) {
+            tickCount.fetch_add(static_cast<std::uint64_t>(steps));
+        }
+        if (steps > 0 || changed) {
+            KOSMOS_PROFILE_SCOPE("publish");
+            publish();
+        }
+        else {
+            double wait = scale > 0.0f ? (fixedStep - accumulator) / scale : 0.001;
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::min(std::max(wait, 0.0), 0.01)));
+        }
+    }
+}
+
+std::shared_ptr<SimulationSnapshot> PhysicsThread::acquireBuffer() {
+    // Буфер вільний, коли на нього посилається лише пул
+    for (auto& buffer : buffers) {
+        if (buffer.use_count() == 1) return buffer;
+    }
+    buffers.push_back(std::make_shared<SimulationSnapshot>());
+    return buffers.back();
+}
+
+void PhysicsThread::publish() {
+    std::shared_ptr<SimulationSnapshot> snapshot = acquireBuffer();
+    const MatterStore& matters = simulation.matters;
+    SimulationSnapshot& out = *snapshot;
+
+    // Масиви незалежні, тож копіюються паралельно на пулі JobSystem
+    publishGraph.clear();
+    publishGraph.add("publish positions x", [&] { out.posX.assign(matters.posX.begin(), matters.posX.end()); });
+    publishGraph.add("publish positions y", [&] { out.posY.assign(matters.posY.begin(), matters.posY.end()); });
+    publishGraph.add("publish radius", [&] {
+        out.radius.assign(matters.radius.begin(), matters.radius.end());
+        out.isColony.assign(matters.isColony.begin(), matters.isColony.end());
+    });
+    // Кораблі зберігають лише старт і прибуття: положення рахуються тут, для рендера
+    publishGraph.add("publish ships", [&] { simulation.ships.positionsAt(simulation.time, out.ships); });
+    publishGraph.run();
+
+    snapshot->shipRadius = simulation.ships.radius;
+    snapshot->blackHoleActive = simulation.blackHoleActive;
+    snapshot->tick = tickCount.load();
+    snapshot->simulatedTime = simulatedTime;
+    snapshot->layoutVersion = simulation.layoutVersion;
+    snapshot->publishedAt = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    previous = current;
+    current = snapshot;
+}
+
+void PhysicsThread::interpolate(SimulationSnapshot& out) const {
+    std::shared_ptr<const SimulationSnapshot> from;
+    std::shared_ptr<const SimulationSnapshot> to;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        from = previous;
+        to = current;
+    }
+    if (!to) {
+        out = SimulationSnapshot();
+        return;
+    }
+
+    // Показуємо стан на один інтервал публікації позаду: alpha = 0 щойно вийшов новий знімок
+    float alpha = 1.0f;
+    bool blend = from && from->layoutVersion == to->layoutVersion && from->size() == to->size();
+    if (blend) {
+        double interval = std::chrono::duration<double>(to->publishedAt - from->publishedAt).count();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - to->publishedAt).count();
+        alpha = interval > 0.0 ? static_cast<float>(std::min(std::max(elapsed / interval, 0.0), 1.0)) : 1.0f;
+    }
+
+    out.radius.assign(to->radius.begin(), to->radius.end());
+    out.isColony.assign(to->isColony.begin(), to->isColony.end());
+    out.shipRadius = to->shipRadius;
+    out.blackHoleActive = to->blackHoleActive;
+    out.tick = to->tick;
+    out.layoutVersion = to->layoutVersion;
+    out.publishedAt = to->publishedAt;
+
+    if (!blend || alpha >= 1.0f) {
+        out.posX.assign(to->posX.begin(), to->posX.end());
+        out.posY.assign(to->posY.begin(), to->posY.end());
+        out.ships = to->ships;
+        out.simulatedTime = to->simulatedTime;
+        return;
+    }
+
+    const std::size_t count = to->size();
+    out.posX.resize(count);
+    out.posY.resize(count);
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            out.posX[i] = from->posX[i] + (to->posX[i] - from->posX[i]) * alpha;
+            out.posY[i] = from->posY[i] + (to->posY[i] - from->posY[i]) * alpha;
+        }
+    });
+
+    out.ships = to->ships;
+    if (from->ships.size() == to->ships.size()) {
+        for (std::size_t s = 0; s < out.ships.size(); ++s) {
+            out.ships[s] = from->ships[s] + (to->ships[s] - from->ships[s]) * alpha;
+        }
+    }
+    out.simulatedTime = from->simulatedTime + (to->simulatedTime - from->simulatedTime) * alpha;
+}
@@ -0,0 +1,89 @@
+﻿#ifndef PHYSICS_THREAD_HPP
+#define PHYSICS_THREAD_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RewindBuffer.hpp"
+#include "Simulation.hpp"
+
+// Стан, потрібний для малювання одного кадру
+struct SimulationSnapshot {
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> radius;
+    std::vector<std::uint8_t> isColony;
+    std::vector<Vec2> ships; // положення кораблів (лівий верхній кут, як у sf::CircleShape)
+    float shipRadius = 5.0f;
+    bool blackHoleActive = true;
+
+    std::uint64_t tick = 0;
+    double simulatedTime = 0.0;
+    std::uint64_t layoutVersion = 0; // знімки з різною версією не можна змішувати потілесно
+    std::chrono::steady_clock::time_point publishedAt;
+
+    std::size_t size() const { return posX.size(); }
+};
+
+// Фізика з фіксованим кроком у власному потоці.
+// Крок завжди fixedStep (поділений на simulation.substeps); timeScale означає більше кроків
+// за секунду, а не більший крок. Після кожної пачки кроків публікується знімок, а рендер
+// інтерполює між двома останніми, тож не чекає на фізику і не гальмує її.
+class PhysicsThread {
+public:
+    explicit PhysicsThread(Simulation& simulation, float fixedStep = 1.0f / 120.0f);
+    ~PhysicsThread();
+
+    void start();
+    void stop();
+
+    // Команда виконується в потоці фізики між кроками (клавіші, колонізація тощо)
+    void post(std::function<void(Simulation&)> command);
+
+    void setTimeScale(float scale) { timeScaleValue.store(scale); }
+    float timeScale() const { return timeScaleValue.load(); }
+
+    // Знімок між двома останніми опублікованими станами на поточний момент
+    void interpolate(SimulationSnapshot& out) const;
+
+    std::uint64_t ticks() const { return tickCount.load(); }
+
+    float fixedStep;
+    int maxStepsPerUpdate = 16; // якщо фізика не встигає, зайвий час відкидається
+
+    // Історія кроків (budgetBytes задається до start); після команд пишеться ключовий кадр,
+    // тож перемотування повторює лише кроки без втручань
+    RewindBuffer rewind;
+
+private:
+    void run();
+    bool runCommands();
+    void publish();
+    std::shared_ptr<SimulationSnapshot> acquireBuffer();
+
+    Simulation& simulation;
+    std::thread worker;
+    std::atomic<bool> running{ false };
+    std::atomic<float> timeScaleValue{ 1.0f };
+    std::atomic<std::uint64_t> tickCount{ 0 };
+    double simulatedTime = 0.0;
+
+    std::mutex commandMutex;
+    std::vector<std::function<void(Simulation&)>> commands;
+    std::vector<std::function<void(Simulation&)>> runningCommands;
+
+    // Два останні знімки; буфери повторно використовуються, коли рендер їх відпустив
+    mutable std::mutex snapshotMutex;
+    std::shared_ptr<const SimulationSnapshot> previous;
+    std::shared_ptr<const SimulationSnapshot> current;
+    std::vector<std::shared_ptr<SimulationSnapshot>> buffers;
+    TaskGraph publishGraph;
+};
+
+#endif
@@ -0,0 +1,262 @@
+﻿#include "Profiler.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+const std::size_t ringCapacity = 1 << 14; // подій на потік між двома endFrame
+const double smoothing = 0.1;             // вага нового кадру в середніх для оверлея
+
+const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+
+// Імена в JSON: лапки й керівні символи не пишемо як є
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\' << *c;
+        else if (static_cast<unsigned char>(*c) >= 0x20) out << *c;
+    }
+    out << '"';
+}
+
+}
+
+// Кільце одного потоку: пише лише власник, читає лише endFrame
+struct Profiler::ThreadBuffer {
+    std::vector<ProfileEvent> ring = std::vector<ProfileEvent>(ringCapacity);
+    std::atomic<std::uint64_t> head{ 0 };
+    std::atomic<std::uint64_t> tail{ 0 };
+    std::atomic<std::uint64_t> dropped{ 0 };
+    std::uint32_t id = 0;
+    std::string name;
+};
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() {
+}
+
+Profiler::~Profiler() {
+}
+
+std::uint64_t Profiler::now() {
+    // +1: нуль у ProfileScope означає "профайлер був вимкнений"
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - profilerEpoch).count()) + 1;
+}
+
+Profiler::ThreadBuffer& Profiler::local() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(threadsLock);
+        threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = threads.back().get();
+        buffer->id = static_cast<std::uint32_t>(threads.size() - 1);
+        buffer->name = "thread " + std::to_string(buffer->id);
+    }
+    return *buffer;
+}
+
+void Profiler::nameThread(const char* name) {
+    ThreadBuffer& buffer = local();
+    std::lock_guard<std::mutex> lock(threadsLock);
+    buffer.name = name;
+}
+
+void Profiler::push(const ProfileEvent& event) {
+    ThreadBuffer& buffer = local();
+    const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= ringCapacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.ring[head & (ringCapacity - 1)] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::record(const char* name, std::uint64_t start, std::uint64_t end) {
+    ProfileEvent event = { name, start, end - start, 0, ProfileEventKind::Scope };
+    push(event);
+}
+
+void Profiler::count(const char* name, std::int64_t delta) {
+    ProfileEvent event = { name, now(), 0, delta, ProfileEventKind::Count };
+    push(event);
+}
+
+void Profiler::value(const char* name, std::int64_t value) {
+    ProfileEvent event = { name, now(), 0, value, ProfileEventKind::Value };
+    push(event);
+}
+
+void Profiler::endFrame() {
+    const std::uint64_t frameEnd = now();
+    if (lastFrame != 0) {
+        double milliseconds = (frameEnd - lastFrame) * 1e-6;
+        frameTime = frameTime == 0.0 ? milliseconds : frameTime + smoothing * (milliseconds - frameTime);
+    }
+    lastFrame = frameEnd;
+
+    // Забираємо події з кілець усіх потоків
+    harvested.clear();
+    std::size_t threadCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(threadsLock);
+        threadCount = threads.size();
+        threadNames.resize(threadCount);
+        for (const auto& buffer : threads) {
+            const std::uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+            for (std::uint64_t i = tail; i < head; ++i) {
+                ProfileTraceEvent traced = { buffer->ring[i & (ringCapacity - 1)], buffer->id };
+                harvested.push_back(traced);
+            }
+            buffer->tail.store(head, std::memory_order_release);
+            dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+            threadNames[buffer->id] = buffer->name;
+        }
+    }
+
+    // Статистика кадру: фази за іменем (у порядку першої появи), час кожного потоку окремо
+    for (ProfilePhase& phase : phaseStats) phase.calls = 0;
+    frameTotals.assign(phaseStats.size(), 0.0);
+    frameCounters.assign(counterStats.size(), 0.0);
+    counterSeen.assign(counterStats.size(), 0);
+    threadTimes.assign(phaseStats.size() * threadCount, 0.0);
+
+    for (const ProfileTraceEvent& traced : harvested) {
+        const ProfileEvent& event = traced.event;
+        if (event.kind == ProfileEventKind::Scope) {
+            std::size_t p = 0;
+            while (p < phaseStats.size() && std::strcmp(phaseStats[p].name, event.name) != 0) ++p;
+            if (p == phaseStats.size()) {
+                ProfilePhase phase;
+                phase.name = event.name;
+                phaseStats.push_back(phase);
+                frameTotals.push_back(0.0);
+                threadTimes.resize(phaseStats.size() * threadCount, 0.0);
+            }
+            double milliseconds = event.duration * 1e-6;
+            frameTotals[p] += milliseconds;
+            threadTimes[p * threadCount + traced.thread] += milliseconds;
+            ++phaseStats[p].calls;
+        }
+        else {
+            std::size_t c = 0;
+            while (c < counterStats.size() && std::strcmp(counterStats[c].name, event.name) != 0) ++c;
+            if (c == counterStats.size()) {
+                ProfileCounter counter;
+                counter.name = event.name;
+                counter.gauge = event.kind == ProfileEventKind::Value;
+                counterStats.push_back(counter);
+                frameCounters.push_back(0.0);
+                counterSeen.push_back(0);
+            }
+            if (counterStats[c].gauge) frameCounters[c] = static_cast<double>(event.value);
+            else frameCounters[c] += static_cast<double>(event.value);
+            counterSeen[c] = 1;
+        }
+    }
+
+    for (std::size_t p = 0; p < phaseStats.size(); ++p) {
+        ProfilePhase& phase = phaseStats[p];
+        double maxThread = 0.0;
+        int busyThreads = 0;
+        for (std::size_t t = 0; t < threadCount; ++t) {
+            double milliseconds = threadTimes[p * threadCount + t];
+            if (milliseconds > 0.0) ++busyThreads;
+            if (milliseconds > maxThread) maxThread = milliseconds;
+        }
+        phase.threads = busyThreads;
+        phase.milliseconds += smoothing * (frameTotals[p] - phase.milliseconds);
+        phase.maxThreadMilliseconds += smoothing * (maxThread - phase.maxThreadMilliseconds);
+    }
+    for (std::size_t c = 0; c < counterStats.size(); ++c) {
+        ProfileCounter& counter = counterStats[c];
+        // Показник без нових значень тримає останнє, лічильник за кадр згладжується як фази
+        if (counter.gauge) {
+            if (counterSeen[c]) counter.value = frameCounters[c];
+        }
+        else {
+            counter.value += smoothing * (frameCounters[c] - counter.value);
+        }
+    }
+
+    if (recording) {
+        for (const ProfileTraceEvent& traced : harvested) {
+            if (trace.size() >= captureLimit) {
+                ++dropped;
+                continue;
+            }
+            trace.push_back(traced);
+        }
+    }
+}
+
+void Profiler::startCapture(std::size_t maxEvents) {
+    trace.clear();
+    dropped = 0;
+    captureLimit = maxEvents;
+    recording = true;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (std::size_t t = 0; t < threadNames.size(); ++t) {
+        file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":";
+        writeJsonString(file, threadNames[t].c_str());
+        file << "}}";
+        first = false;
+    }
+    // Лічильники за кадр у трасі - накопичена сума, показники - значення як є
+    std::vector<std::pair<const char*, double>> totals;
+    for (const ProfileTraceEvent& traced : trace) {
+        const ProfileEvent& event = traced.event;
+        file << (first ? "" : ",") << "\n{\"name\":";
+        writeJsonString(file, event.name);
+        if (event.kind == ProfileEventKind::Scope) {
+            file << ",\"ph\":\"X\",\"ts\":" << event.start * 1e-3 << ",\"dur\":" << event.duration * 1e-3;
+        }
+        else {
+            double value = static_cast<double>(event.value);
+            if (event.kind == ProfileEventKind::Count) {
+                std::size_t c = 0;
+                while (c < totals.size() && std::strcmp(totals[c].first, event.name) != 0) ++c;
+                if (c == totals.size()) totals.push_back(std::make_pair(event.name, 0.0));
+                totals[c].second += value;
+                value = totals[c].second;
+            }
+            file << ",\"ph\":\"C\",\"ts\":" << event.start * 1e-3 << ",\"args\":{\"value\":" << value << "}";
+        }
+        file << ",\"pid\":1,\"tid\":" << traced.thread << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+bool Profiler::writeCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << std::fixed << std::setprecision(3);
+    file << "kind,name,thread,start_us,duration_us,value\n";
+    const char* kinds[] = { "scope", "count", "value" };
+    for (const ProfileTraceEvent& traced : trace) {
+        const ProfileEvent& event = traced.event;
+        const std::string& thread = traced.thread < threadNames.size() ? threadNames[traced.thread] : std::string();
+        file << kinds[static_cast<int>(event.kind)] << "," << event.name << "," << thread << ","
+             << event.start * 1e-3 << "," << event.duration * 1e-3 << "," << event.value << "\n";
+    }
+    return static_cast<bool>(file);
+}
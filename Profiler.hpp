@@ -0,0 +1,149 @@
+﻿#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Профайлер фаз кадру. Замір - ProfileScope у блоці (KOSMOS_PROFILE_SCOPE), лічильники -
+// KOSMOS_PROFILE_COUNT (сума за кадр) і KOSMOS_PROFILE_VALUE (останнє значення).
+// Кожен потік пише у власне кільце без блокувань; endFrame раз на кадр збирає всі кільця,
+// оновлює статистику для оверлея і, якщо йде запис, складає події в трасу.
+// З KOSMOS_PROFILE=0 макроси зникають повністю, у ввімкненій збірці вимкнений профайлер
+// коштує одне читання атомарного прапорця на замір.
+
+#ifndef KOSMOS_PROFILE
+#define KOSMOS_PROFILE 1
+#endif
+
+enum class ProfileEventKind : std::uint8_t {
+    Scope,
+    Count,
+    Value
+};
+
+struct ProfileEvent {
+    const char* name;       // рядковий літерал: подія зберігає лише вказівник
+    std::uint64_t start;    // нс від запуску профайлера
+    std::uint64_t duration; // нс (для Scope)
+    std::int64_t value;     // для Count/Value
+    ProfileEventKind kind;
+};
+
+struct ProfileTraceEvent {
+    ProfileEvent event;
+    std::uint32_t thread;
+};
+
+// Фаза, усереднена за кадрами (експоненційне згладжування)
+struct ProfilePhase {
+    const char* name;
+    double milliseconds = 0.0;          // сума за кадр по всіх потоках
+    double maxThreadMilliseconds = 0.0; // найзавантаженіший потік: разом із threads показує дисбаланс
+    int threads = 0;                    // потоків, що виконували фазу в останньому кадрі
+    std::uint64_t calls = 0;            // викликів в останньому кадрі
+};
+
+struct ProfileCounter {
+    const char* name;
+    double value = 0.0;
+    bool gauge = false; // Value: останнє значення, Count: сума за кадр (згладжена)
+};
+
+class Profiler {
+public:
+    static Profiler& instance();
+
+    void setEnabled(bool enabled) { active.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Ім'я потоку в трасі (main, physics ...), решта - "thread N"
+    void nameThread(const char* name);
+
+    void record(const char* name, std::uint64_t start, std::uint64_t end);
+    void count(const char* name, std::int64_t delta);
+    void value(const char* name, std::int64_t value);
+
+    void endFrame();
+
+    const std::vector<ProfilePhase>& phases() const { return phaseStats; }
+    const std::vector<ProfileCounter>& counters() const { return counterStats; }
+    double frameMilliseconds() const { return frameTime; }
+
+    // Запис траси: події всіх потоків від startCapture до stopCapture (не більше maxEvents)
+    void startCapture(std::size_t maxEvents = 1 << 22);
+    void stopCapture() { recording = false; }
+    bool capturing() const { return recording; }
+    std::size_t capturedEvents() const { return trace.size(); }
+    std::uint64_t droppedEvents() const { return dropped; }
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto) або CSV
+    bool writeChromeTrace(const std::string& path) const;
+    bool writeCsv(const std::string& path) const;
+
+    static std::uint64_t now();
+
+private:
+    struct ThreadBuffer;
+
+    Profiler();
+    ~Profiler();
+    ThreadBuffer& local();
+    void push(const ProfileEvent& event);
+
+    std::atomic<bool> active{ false };
+    std::mutex threadsLock;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+    // Далі - лише потік, що викликає endFrame
+    std::vector<ProfileTraceEvent> harvested;
+    std::vector<ProfilePhase> phaseStats;
+    std::vector<ProfileCounter> counterStats;
+    std::vector<double> frameTotals;
+    std::vector<double> frameCounters;
+    std::vector<std::uint8_t> counterSeen;
+    std::vector<double> threadTimes; // фаза x потік для поточного кадру
+    double frameTime = 0.0;
+    std::uint64_t lastFrame = 0;
+    bool recording = false;
+    std::size_t captureLimit = 0;
+    std::vector<ProfileTraceEvent> trace;
+    std::vector<std::string> threadNames;
+    std::uint64_t dropped = 0;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name(name), start(Profiler::instance().enabled() ? Profiler::now() : 0) {}
+    ~ProfileScope() {
+        if (start != 0) Profiler::instance().record(name, start, Profiler::now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    std::uint64_t start;
+};
+
+#define KOSMOS_PROFILE_CONCAT_INNER(a, b) a##b
+#define KOSMOS_PROFILE_CONCAT(a, b) KOSMOS_PROFILE_CONCAT_INNER(a, b)
+
+#if KOSMOS_PROFILE
+#define KOSMOS_PROFILE_SCOPE(name) ProfileScope KOSMOS_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define KOSMOS_PROFILE_COUNT(name, delta) \
+    do { if (Profiler::instance().enabled()) Profiler::instance().count(name, static_cast<std::int64_t>(delta)); } while (0)
+#define KOSMOS_PROFILE_VALUE(name, v) \
+    do { if (Profiler::instance().enabled()) Profiler::instance().value(name, static_cast<std::int64_t>(v)); } while (0)
+#else
+#define KOSMOS_PROFILE_SCOPE(name) ((void)sizeof(name))
+#define KOSMOS_PROFILE_COUNT(name, delta) ((void)sizeof(delta))
+#define KOSMOS_PROFILE_VALUE(name, v) ((void)sizeof(v))
+#endif
+
+#endif
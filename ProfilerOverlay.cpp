@@ -0,0 +1,100 @@
+#include "ProfilerOverlay.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const float panelLeft = 10.0f;
+const float panelTop = 10.0f;
+const float labelWidth = 330.0f;
+const float barWidth = 220.0f;
+const float rowHeight = 16.0f;
+const unsigned characterSize = 12;
+const double frameBudget = 1000.0 / 60.0;
+
+const char* fontPaths[] = {
+    "C:/Windows/Fonts/consola.ttf",
+    "C:/Windows/Fonts/arial.ttf",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+    "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+    "/Library/Fonts/Arial.ttf"
+};
+
+const sf::Color palette[] = {
+    sf::Color(230, 90, 70), sf::Color(240, 170, 60), sf::Color(120, 200, 90), sf::Color(70, 170, 230),
+    sf::Color(170, 110, 230), sf::Color(230, 110, 180), sf::Color(90, 210, 190), sf::Color(200, 200, 90)
+};
+
+}
+
+ProfilerOverlay::ProfilerOverlay() : bars(sf::Quads) {
+    for (const char* path : fontPaths) {
+        if (font.loadFromFile(path)) {
+            hasFont = true;
+            break;
+        }
+    }
+    text.setFont(font);
+    text.setCharacterSize(characterSize);
+    text.setFillColor(sf::Color::White);
+    text.setPosition(panelLeft + 6.0f, panelTop + 2.0f);
+}
+
+void ProfilerOverlay::addRectangle(float left, float top, float width, float height, sf::Color color) {
+    bars.append(sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f()));
+    bars.append(sf::Vertex(sf::Vector2f(left + width, top), color, sf::Vector2f()));
+    bars.append(sf::Vertex(sf::Vector2f(left + width, top + height), color, sf::Vector2f()));
+    bars.append(sf::Vertex(sf::Vector2f(left, top + height), color, sf::Vector2f()));
+}
+
+void ProfilerOverlay::draw(sf::RenderTarget& target, const Profiler& profiler) {
+    if (!visible) return;
+
+    const std::vector<ProfilePhase>& phases = profiler.phases();
+    const std::vector<ProfileCounter>& counters = profiler.counters();
+    const std::size_t rows = 1 + phases.size() + counters.size();
+    char line[160];
+
+    bars.clear();
+    label.clear();
+    addRectangle(panelLeft, panelTop, labelWidth + barWidth + 16.0f, rows * rowHeight + 8.0f, sf::Color(0, 0, 0, 180));
+
+    double frame = profiler.frameMilliseconds();
+    std::snprintf(line, sizeof(line), "frame %.2f ms (%.0f FPS)", frame, frame > 0.0 ? 1000.0 / frame : 0.0);
+    label += line;
+    if (profiler.capturing()) {
+        std::snprintf(line, sizeof(line), "   REC %zu events", profiler.capturedEvents());
+        label += line;
+    }
+    label += "\n";
+
+    float top = panelTop + 4.0f + rowHeight;
+    const float barLeft = panelLeft + labelWidth;
+    for (std::size_t p = 0; p < phases.size(); ++p) {
+        const ProfilePhase& phase = phases[p];
+        std::snprintf(line, sizeof(line), "%-22s %7.3f ms  x%d  max %.3f\n",
+                      phase.name, phase.milliseconds, phase.threads, phase.maxThreadMilliseconds);
+        label += line;
+
+        sf::Color color = palette[p % (sizeof(palette) / sizeof(palette[0]))];
+        float total = static_cast<float>(std::min(phase.milliseconds / frameBudget, 1.0)) * barWidth;
+        float busiest = static_cast<float>(std::min(phase.maxThreadMilliseconds / frameBudget, 1.0)) * barWidth;
+        addRectangle(barLeft, top + 3.0f, total, rowHeight - 6.0f, sf::Color(color.r, color.g, color.b, 140));
+        addRectangle(barLeft, top + 3.0f, busiest, rowHeight - 6.0f, color);
+        top += rowHeight;
+    }
+
+    for (const ProfileCounter& counter : counters) {
+        std::snprintf(line, sizeof(line), "%-22s %12.0f%s\n", counter.name, counter.value, counter.gauge ? "" : " /frame");
+        label += line;
+    }
+
+    sf::View previous = target.getView();
+    target.setView(target.getDefaultView());
+    target.draw(bars);
+    if (hasFont) {
+        text.setString(label);
+        target.draw(text);
+    }
+    target.setView(previous);
+}
@@ -0,0 +1,29 @@
+﻿#ifndef PROFILER_OVERLAY_HPP
+#define PROFILER_OVERLAY_HPP
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include "Profiler.hpp"
+
+// Оверлей профайлера поверх кадру: смуга на фазу (довжина - частка кадру 60 FPS,
+// світліша частина - найзавантаженіший потік) і лічильники. Підписи - якщо знайдено
+// системний шрифт, інакше лише смуги.
+class ProfilerOverlay {
+public:
+    ProfilerOverlay();
+
+    void draw(sf::RenderTarget& target, const Profiler& profiler);
+
+    bool visible = false;
+
+private:
+    void addRectangle(float left, float top, float width, float height, sf::Color color);
+
+    sf::Font font;
+    bool hasFont = false;
+    sf::Text text;
+    sf::VertexArray bars;
+    std::string label;
+};
+
+#endif
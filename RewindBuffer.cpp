@@ -0,0 +1,518 @@
+﻿#include "RewindBuffer.hpp"
+#include "Profiler.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Тіл у шматку кодування; межі шматків однакові в кодера й декодера, тож шматки незалежні
+const std::size_t rewindChunk = 16384;
+
+// Найбільше байтів одного тіла в шматку: номер слота й дві координати по 10 байтів varint
+const std::size_t maxBodyBytes = 30;
+
+inline std::int32_t quantize(float value, float inverseStep) {
+    const float scaled = value * inverseStep;
+    if (scaled != scaled) return 0;
+    // Тіла, що відлетіли надто далеко, притискаються до краю: кадр лише для показу
+    const float limit = 1.0e9f;
+    const float clamped = std::min(std::max(scaled, -limit), limit);
+    return static_cast<std::int32_t>(std::floor(clamped + 0.5f));
+}
+
+// Запис у заздалегідь виділений буфер: без перевірки місця на кожен байт
+inline unsigned char* writeUnsigned(unsigned char* out, std::uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<unsigned char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(value);
+    return out;
+}
+
+inline unsigned char* writeSigned(unsigned char* out, std::int64_t value) {
+    return writeUnsigned(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+void putUnsigned(std::vector<unsigned char>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// zigzag: малі за модулем відхилення обох знаків - малі числа
+void putSigned(std::vector<unsigned char>& out, std::int64_t value) {
+    putUnsigned(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+class VarintReader {
+public:
+    VarintReader(const unsigned char* begin, const unsigned char* end) : cursor(begin), end(end) {}
+
+    std::uint64_t u() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cursor == end) break;
+            const unsigned char byte = *cursor++;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        ok = false;
+        return 0;
+    }
+    std::int64_t s() {
+        const std::uint64_t value = u();
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+    const unsigned char* position() const { return cursor; }
+
+    bool ok = true;
+
+private:
+    const unsigned char* cursor;
+    const unsigned char* end;
+};
+
+// Прогноз - рух з тією ж швидкістю, що між двома попередніми кадрами
+inline std::int64_t predict(std::int32_t current, std::int32_t last) {
+    return 2 * static_cast<std::int64_t>(current) - last;
+}
+
+}
+
+void RewindBuffer::DeltaState::reset(const float* posX, const float* posY, const std::uint32_t* bodySlot, const std::uint8_t* isColony,
+                                     std::size_t count, const std::vector<Vec2>& ships, float positionStep) {
+    step = positionStep;
+    std::size_t slotCount = 0;
+    for (std::size_t i = 0; i < count; ++i) slotCount = std::max<std::size_t>(slotCount, bodySlot[i] + 1);
+    x.assign(slotCount, 0);
+    y.assign(slotCount, 0);
+    lastX.assign(slotCount, 0);
+    lastY.assign(slotCount, 0);
+    colony.assign(slotCount, 0);
+    slots.assign(bodySlot, bodySlot + count);
+
+    const float inverse = 1.0f / step;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::uint32_t slot = bodySlot[i];
+        x[slot] = lastX[slot] = quantize(posX[i], inverse);
+        y[slot] = lastY[slot] = quantize(posY[i], inverse);
+        colony[slot] = isColony[i];
+    }
+    shipX.resize(ships.size());
+    shipY.resize(ships.size());
+    for (std::size_t s = 0; s < ships.size(); ++s) {
+        shipX[s] = quantize(ships[s].x, inverse);
+        shipY[s] = quantize(ships[s].y, inverse);
+    }
+}
+
+void RewindBuffer::DeltaState::reserveSlots(std::size_t count) {
+    if (count <= x.size()) return;
+    x.resize(count, 0);
+    y.resize(count, 0);
+    lastX.resize(count, 0);
+    lastY.resize(count, 0);
+    colony.resize(count, 0);
+}
+
+void RewindBuffer::DeltaState::encode(const Capture& capture, std::vector<unsigned char>& out) {
+    const std::size_t bodies = capture.posX.size();
+    const std::size_t chunkCount = (bodies + rewindChunk - 1) / rewindChunk;
+    reserveSlots(capture.slotCount);
+    slots.resize(bodies, 0);
+    if (chunks.size() < chunkCount) chunks.resize(chunkCount);
+    const float inverse = 1.0f / step;
+
+    // Слоти тіл у кадрі різні, тож шматки оновлюють різні записи таблиць
+    JobSystem::instance().parallelFor(bodies, rewindChunk, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        // Колонії змінюються рідко: вони йдуть після тіл, номерами в шматку
+        std::size_t changed = 0;
+        for (std::size_t i = begin; i < end; ++i) changed += capture.isColony[i] != colony[capture.bodySlot[i]];
+
+        std::vector<unsigned char>& bytes = chunks[chunk];
+        bytes.resize((end - begin + 1) * maxBodyBytes + changed * 10);
+        unsigned char* out = bytes.data();
+
+        // Слоти змінюються лише після видалень і перестановок: інакше шматок їх не пише
+        const bool moved = !std::equal(capture.bodySlot.begin() + begin, capture.bodySlot.begin() + end, slots.begin() + begin);
+        *out++ = moved ? 1 : 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint32_t slot = capture.bodySlot[i];
+            if (moved) out = writeSigned(out, static_cast<std::int64_t>(slot) - slots[i]);
+            slots[i] = slot;
+
+            const std::int32_t qx = quantize(capture.posX[i], inverse);
+            const std::int32_t qy = quantize(capture.posY[i], inverse);
+            out = writeSigned(out, qx - predict(x[slot], lastX[slot]));
+            out = writeSigned(out, qy - predict(y[slot], lastY[slot]));
+            lastX[slot] = x[slot];
+            lastY[slot] = y[slot];
+            x[slot] = qx;
+            y[slot] = qy;
+        }
+
+        out = writeUnsigned(out, changed);
+        for (std::size_t i = begin; changed > 0 && i < end; ++i) {
+            const std::uint32_t slot = capture.bodySlot[i];
+            if (capture.isColony[i] == colony[slot]) continue;
+            out = writeUnsigned(out, i - begin);
+            colony[slot] = capture.isColony[i];
+            --changed;
+        }
+        bytes.resize(static_cast<std::size_t>(out - bytes.data()));
+    });
+
+    out.clear();
+    putUnsigned(out, x.size());
+    putUnsigned(out, chunkCount);
+    for (std::size_t c = 0; c < chunkCount; ++c) putUnsigned(out, chunks[c].size());
+    for (std::size_t c = 0; c < chunkCount; ++c) out.insert(out.end(), chunks[c].begin(), chunks[c].end());
+
+    // Кораблі лише додаються, тож корабель s - той самий у всіх кадрах секції
+    const std::size_t shipCount = capture.ships.size();
+    putUnsigned(out, shipCount);
+    shipX.resize(shipCount, 0);
+    shipY.resize(shipCount, 0);
+    for (std::size_t s = 0; s < shipCount; ++s) {
+        const std::int32_t qx = quantize(capture.ships[s].x, inverse);
+        const std::int32_t qy = quantize(capture.ships[s].y, inverse);
+        putSigned(out, static_cast<std::int64_t>(qx) - shipX[s]);
+        putSigned(out, static_cast<std::int64_t>(qy) - shipY[s]);
+        shipX[s] = qx;
+        shipY[s] = qy;
+    }
+}
+
+bool RewindBuffer::DeltaState::decode(const std::vector<unsigned char>& in, std::size_t bodies) {
+    const unsigned char* end = in.data() + in.size();
+    VarintReader header(in.data(), end);
+    const std::uint64_t slotCount = header.u();
+    const std::uint64_t chunkCount = header.u();
+    if (!header.ok || slotCount > 0xFFFFFFFFull || chunkCount != (bodies + rewindChunk - 1) / rewindChunk) return false;
+
+    std::vector<std::size_t> offsets(static_cast<std::size_t>(chunkCount) + 1, 0);
+    for (std::size_t c = 0; c < chunkCount; ++c) {
+        const std::uint64_t length = header.u();
+        if (length > in.size()) return false;
+        offsets[c + 1] = offsets[c] + static_cast<std::size_t>(length);
+    }
+    const unsigned char* payload = header.position();
+    if (!header.ok || offsets.back() > static_cast<std::size_t>(end - payload)) return false;
+
+    reserveSlots(static_cast<std::size_t>(slotCount));
+    slots.resize(bodies, 0);
+
+    std::atomic<bool> valid{ true };
+    JobSystem::instance().parallelFor(bodies, rewindChunk, [&](std::size_t chunk, std::size_t begin, std::size_t stop) {
+        VarintReader reader(payload + offsets[chunk], payload + offsets[chunk + 1]);
+        const bool moved = reader.u() != 0;
+        for (std::size_t i = begin; i < stop; ++i) {
+            const std::int64_t slot = static_cast<std::int64_t>(slots[i]) + (moved ? reader.s() : 0);
+            if (!reader.ok || slot < 0 || static_cast<std::uint64_t>(slot) >= x.size()) {
+                valid.store(false);
+                return;
+            }
+            const std::size_t s = static_cast<std::size_t>(slot);
+            slots[i] = static_cast<std::uint32_t>(s);
+
+            const std::int32_t qx = static_cast<std::int32_t>(predict(x[s], lastX[s]) + reader.s());
+            const std::int32_t qy = static_cast<std::int32_t>(predict(y[s], lastY[s]) + reader.s());
+            lastX[s] = x[s];
+            lastY[s] = y[s];
+            x[s] = qx;
+            y[s] = qy;
+        }
+
+        const std::uint64_t changed = reader.u();
+        for (std::uint64_t c = 0; c < changed && reader.ok; ++c) {
+            const std::uint64_t offset = reader.u();
+            if (offset >= stop - begin) {
+                valid.store(false);
+                return;
+            }
+            const std::uint32_t slot = slots[begin + static_cast<std::size_t>(offset)];
+            colony[slot] = colony[slot] ? 0 : 1;
+        }
+        if (!reader.ok) valid.store(false);
+    });
+
+    VarintReader tail(payload + offsets.back(), end);
+    const std::uint64_t shipCount = tail.u();
+    if (!tail.ok || shipCount > in.size()) return false;
+    shipX.resize(static_cast<std::size_t>(shipCount), 0);
+    shipY.resize(static_cast<std::size_t>(shipCount), 0);
+    for (std::size_t s = 0; s < shipCount; ++s) {
+        shipX[s] = static_cast<std::int32_t>(shipX[s] + tail.s());
+        shipY[s] = static_cast<std::int32_t>(shipY[s] + tail.s());
+    }
+    return valid.load() && tail.ok;
+}
+
+void RewindBuffer::record(const Simulation& simulation, float fixedStep) {
+    if (budgetBytes == 0) return;
+
+    // Такт не продовжує записаний (завантажено інший стан): попередня історія з іншої гілки
+    const std::uint64_t tick = simulation.tick;
+    if (started && tick != recordedTick.load() + 1) clear();
+
+    const bool keyframe = !started || keyframeDue || (keyframeInterval > 0 && tick >= lastKeyframe + static_cast<std::uint64_t>(keyframeInterval));
+    started = true;
+    recordedTick.store(tick);
+    if (!keyframe && (frameInterval <= 0 || tick % static_cast<std::uint64_t>(frameInterval) != 0)) return;
+
+    KOSMOS_PROFILE_SCOPE("rewind capture");
+    JobSystem& jobs = JobSystem::instance();
+    jobs.wait(pending);
+
+    const MatterStore& matters = simulation.matters;
+    capture.tick = tick;
+    capture.keyframe = keyframe;
+    capture.positionStep = positionStep;
+    capture.slotCount = matters.slotIndices().size();
+    capture.blackHoleActive = simulation.blackHoleActive;
+    capture.posX.assign(matters.posX.begin(), matters.posX.end());
+    capture.posY.assign(matters.posY.begin(), matters.posY.end());
+    capture.bodySlot.assign(matters.bodySlot.begin(), matters.bodySlot.end());
+    capture.isColony.assign(matters.isColony.begin(), matters.isColony.end());
+    simulation.ships.positionsAt(simulation.time, capture.ships);
+    if (keyframe) {
+        writeSnapshot(simulation, fixedStep, capture.snapshot);
+        keyframeDue = false;
+        lastKeyframe = tick;
+    }
+
+    jobs.run(pending, [this] {
+        KOSMOS_PROFILE_SCOPE("rewind encode");
+        encode();
+    });
+}
+
+void RewindBuffer::encode() {
+    if (capture.keyframe) {
+        Segment segment;
+        segment.tick = capture.tick;
+        segment.positionStep = capture.positionStep;
+        segment.keyframe.assign(capture.snapshot.begin(), capture.snapshot.end());
+        segment.bytes = sizeof(Segment) + segment.keyframe.size();
+        encoder.reset(capture.posX.data(), capture.posY.data(), capture.bodySlot.data(), capture.isColony.data(),
+                      capture.posX.size(), capture.ships, capture.positionStep);
+        store(std::move(segment));
+        return;
+    }
+    // Ключовий кадр секції не вмістився в бюджет: проміжним кадрам нема від чого відлічувати
+    if (!segmentOpen) return;
+
+    encoder.encode(capture, encoded);
+    Frame frame;
+    frame.tick = capture.tick;
+    frame.blackHoleActive = capture.blackHoleActive;
+    frame.bodies = capture.posX.size();
+    frame.bytes.assign(encoded.begin(), encoded.end());
+    store(std::move(frame));
+}
+
+void RewindBuffer::store(Segment segment) {
+    std::lock_guard<std::mutex> guard(lock);
+    totalBytes += segment.bytes;
+    segments.push_back(std::move(segment));
+    segmentOpen = true;
+    trim();
+}
+
+void RewindBuffer::store(Frame frame) {
+    std::lock_guard<std::mutex> guard(lock);
+    const std::size_t bytes = sizeof(Frame) + frame.bytes.size();
+    Segment& segment = segments.back();
+    segment.frames.push_back(std::move(frame));
+    segment.bytes += bytes;
+    totalBytes += bytes;
+    trim();
+}
+
+void RewindBuffer::trim() {
+    while (totalBytes > budgetBytes && segments.size() > 1) {
+        totalBytes -= segments.front().bytes;
+        segments.pop_front();
+    }
+    if (totalBytes <= budgetBytes || segments.empty()) return;
+
+    // Остання секція сама більша за бюджет: кадр, що не вмістився, відкидається, а наступні
+    // проміжні чекають на новий ключовий кадр (ланцюжок відхилень не має розривів)
+    Segment& last = segments.back();
+    if (last.frames.empty()) {
+        totalBytes -= last.bytes;
+        segments.pop_back();
+    }
+    else {
+        const std::size_t bytes = sizeof(Frame) + last.frames.back().bytes.size();
+        last.frames.pop_back();
+        last.bytes -= bytes;
+        totalBytes -= bytes;
+    }
+    segmentOpen = false;
+}
+
+void RewindBuffer::wait() {
+    JobSystem::instance().wait(pending);
+}
+
+void RewindBuffer::clear() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        segments.clear();
+        totalBytes = 0;
+        decoderValid = false;
+    }
+    segmentOpen = false;
+    started = false;
+    keyframeDue = true;
+    recordedTick.store(0);
+}
+
+bool RewindBuffer::seek(std::uint64_t tick, Simulation& simulation, float* fixedStep) {
+    wait();
+    KOSMOS_PROFILE_SCOPE("rewind seek");
+
+    float step = 0.0f;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (segments.empty() || tick < segments.front().tick || tick > recordedTick.load()) return false;
+        auto found = std::upper_bound(segments.begin(), segments.end(), tick,
+                                      [](std::uint64_t t, const Segment& segment) { return t < segment.tick; }) - 1;
+        if (!readSnapshot(found->keyframe.data(), found->keyframe.size(), simulation, &step)) return false;
+
+        // Гілка після tick вже не настане: далі запис іде з нього
+        while (segments.end() - found > 1) {
+            totalBytes -= segments.back().bytes;
+            segments.pop_back();
+        }
+        Segment& segment = segments.back();
+        while (!segment.frames.empty() && segment.frames.back().tick > tick) {
+            const std::size_t bytes = sizeof(Frame) + segment.frames.back().bytes.size();
+            segment.frames.pop_back();
+            segment.bytes -= bytes;
+            totalBytes -= bytes;
+        }
+        decoderValid = false;
+    }
+
+    while (simulation.tick < tick) {
+        simulation.step(step);
+    }
+    segmentOpen = false;
+    keyframeDue = true;
+    started = true;
+    recordedTick.store(tick);
+    if (fixedStep) *fixedStep = step;
+    return true;
+}
+
+bool RewindBuffer::decodeKeyframe(const Segment& segment) {
+    if (!scratch) scratch.reset(new Simulation(Vec2(), 0.0f, 0.0f));
+    if (!readSnapshot(segment.keyframe.data(), segment.keyframe.size(), *scratch)) return false;
+
+    const MatterStore& matters = scratch->matters;
+    std::vector<Vec2> ships;
+    scratch->ships.positionsAt(scratch->time, ships);
+    decoder.reset(matters.posX.data(), matters.posY.data(), matters.bodySlot.data(), matters.isColony.data(), matters.size(),
+                  ships, segment.positionStep);
+    decodedRadius.assign(decoder.x.size(), 0.0f);
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        decodedRadius[matters.bodySlot[i]] = matters.radius[i];
+    }
+    decodedBlackHole = scratch->blackHoleActive;
+    return true;
+}
+
+bool RewindBuffer::frameAt(std::uint64_t tick, RenderFrame& out, std::uint64_t* frameTick) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (segments.empty() || tick < segments.front().tick) return false;
+    KOSMOS_PROFILE_SCOPE("rewind decode");
+
+    const Segment& segment = *(std::upper_bound(segments.begin(), segments.end(), tick,
+                                                [](std::uint64_t t, const Segment& s) { return t < s.tick; }) - 1);
+    const std::size_t count = std::upper_bound(segment.frames.begin(), segment.frames.end(), tick,
+                                               [](std::uint64_t t, const Frame& frame) { return t < frame.tick; }) - segment.frames.begin();
+
+    // Відхилення лічаться від попереднього кадру, тож назад - лише від ключового
+    if (!decoderValid || decodedSegment != segment.tick || decodedFrames > count) {
+        decoderValid = false;
+        if (!decodeKeyframe(segment)) return false;
+        decoderValid = true;
+        decodedSegment = segment.tick;
+        decodedFrames = 0;
+    }
+    for (; decodedFrames < count; ++decodedFrames) {
+        const Frame& frame = segment.frames[decodedFrames];
+        if (!decoder.decode(frame.bytes, frame.bodies)) {
+            decoderValid = false;
+            return false;
+        }
+        decodedBlackHole = frame.blackHoleActive;
+    }
+
+    const std::size_t bodies = decoder.slots.size();
+    const float step = decoder.step;
+    out.posX.resize(bodies);
+    out.posY.resize(bodies);
+    out.radius.resize(bodies);
+    out.isColony.resize(bodies);
+    for (std::size_t i = 0; i < bodies; ++i) {
+        const std::uint32_t slot = decoder.slots[i];
+        out.posX[i] = decoder.x[slot] * step;
+        out.posY[i] = decoder.y[slot] * step;
+        out.radius[i] = slot < decodedRadius.size() ? decodedRadius[slot] : 0.0f;
+        out.isColony[i] = decoder.colony[slot];
+    }
+    out.ships.resize(decoder.shipX.size());
+    for (std::size_t s = 0; s < out.ships.size(); ++s) {
+        out.ships[s] = Vec2(decoder.shipX[s] * step, decoder.shipY[s] * step);
+    }
+    out.shipRadius = scratch->ships.radius;
+    out.blackHolePosition = scratch->blackHolePosition;
+    out.blackHoleActive = decodedBlackHole;
+
+    if (frameTick) *frameTick = count > 0 ? segment.frames[count - 1].tick : segment.tick;
+    return true;
+}
+
+bool RewindBuffer::empty() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return segments.empty();
+}
+
+std::uint64_t RewindBuffer::oldestTick() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return segments.empty() ? 0 : segments.front().tick;
+}
+
+std::size_t RewindBuffer::bytes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return totalBytes;
+}
+
+std::size_t RewindBuffer::keyframes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return segments.size();
+}
+
+std::size_t RewindBuffer::frames() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::size_t count = 0;
+    for (const Segment& segment : segments) count += segment.frames.size();
+    return count;
+}
+
+std::uint64_t RewindBuffer::bodyFrames() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::uint64_t count = 0;
+    for (const Segment& segment : segments) {
+        for (const Frame& frame : segment.frames) count += frame.bodies;
+    }
+    return count;
+}
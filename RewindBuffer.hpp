@@ -0,0 +1,139 @@
+﻿#ifndef REWIND_BUFFER_HPP
+#define REWIND_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "JobSystem.hpp"
+#include "Simulation.hpp"
+#include "SoftwareRenderer.hpp"
+
+// Історія прогону в пам'яті для перемотування назад.
+// Кожні keyframeInterval тактів - ключовий кадр: повний знімок (як Snapshot), з якого стан
+// відновлюється точно. Між ними кожні frameInterval тактів - проміжний кадр лише для показу:
+// позиції тіл і кораблів, квантовані з кроком positionStep, записані як відхилення від
+// прогнозу за двома попередніми кадрами того ж тіла (zigzag varint), плюс зміни колоній.
+// Кадр копіюється в потоці симуляції, а кодується завданням JobSystem, поки йдуть наступні такти.
+// Ключовий кадр з його проміжними - секція; коли історія перевищує budgetBytes,
+// найстаріші секції відкидаються. Точний стан на будь-якому такті - найближчий ключовий кадр
+// і повторні кроки від нього, тож команди, що змінюють стан між кроками, мають викликати markKeyframe.
+class RewindBuffer {
+public:
+    RewindBuffer() {}
+    ~RewindBuffer() { wait(); }
+
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    std::size_t budgetBytes = 0;         // 0 - історія не пишеться
+    int keyframeInterval = 240;          // тактів між ключовими кадрами (і найбільше повторних кроків)
+    int frameInterval = 4;               // тактів між проміжними кадрами
+    float positionStep = 1.0f / 16.0f;   // крок квантування позицій у проміжних кадрах
+
+    // Після кроку (і один раз до першого): ключовий кадр, проміжний або нічого
+    void record(const Simulation& simulation, float fixedStep);
+    // Стан змінено поза кроком: наступний запис - ключовий кадр
+    void markKeyframe() { keyframeDue = true; }
+    // Дочікується кодування останнього кадру
+    void wait();
+    void clear();
+
+    // Точний стан на такті tick (від oldestTick до newestTick): ключовий кадр і повторні кроки.
+    // Історія після tick відкидається, запис продовжується з нього
+    bool seek(std::uint64_t tick, Simulation& simulation, float* fixedStep = nullptr);
+    // Наближений кадр (квантовані позиції) - останній записаний не пізніше tick;
+    // frameTick отримує його такт. blackHoleRadius у out не змінюється
+    bool frameAt(std::uint64_t tick, RenderFrame& out, std::uint64_t* frameTick = nullptr);
+
+    bool empty() const;
+    std::uint64_t oldestTick() const;
+    std::uint64_t newestTick() const { return recordedTick.load(); }
+    std::size_t bytes() const;
+    std::size_t keyframes() const;
+    std::size_t frames() const;
+    // Тіло-кадрів у проміжних кадрах історії (для байтів на тіло)
+    std::uint64_t bodyFrames() const;
+
+private:
+    struct Frame {
+        std::uint64_t tick;
+        bool blackHoleActive;
+        std::size_t bodies;
+        std::vector<unsigned char> bytes;
+    };
+    struct Segment {
+        std::uint64_t tick;
+        float positionStep;
+        std::vector<unsigned char> keyframe; // знімок writeSnapshot
+        std::vector<Frame> frames;
+        std::size_t bytes = 0;
+    };
+    // Копія стану для кодування у фоні
+    struct Capture {
+        std::uint64_t tick = 0;
+        bool keyframe = false;
+        float positionStep = 1.0f;
+        std::size_t slotCount = 0;
+        bool blackHoleActive = true;
+        std::vector<float> posX;
+        std::vector<float> posY;
+        std::vector<std::uint32_t> bodySlot;
+        std::vector<std::uint8_t> isColony;
+        std::vector<Vec2> ships;
+        std::vector<unsigned char> snapshot;
+    };
+    // Квантовані позиції за слотами з двох останніх кадрів; однаковий у кодера й декодера
+    struct DeltaState {
+        float step = 1.0f;
+        std::vector<std::int32_t> x;
+        std::vector<std::int32_t> y;
+        std::vector<std::int32_t> lastX;
+        std::vector<std::int32_t> lastY;
+        std::vector<std::uint8_t> colony;
+        std::vector<std::uint32_t> slots;   // слот кожного тіла в попередньому кадрі
+        std::vector<std::int32_t> shipX;
+        std::vector<std::int32_t> shipY;
+        std::vector<std::vector<unsigned char>> chunks;
+
+        void reset(const float* posX, const float* posY, const std::uint32_t* bodySlot, const std::uint8_t* isColony,
+                   std::size_t count, const std::vector<Vec2>& ships, float positionStep);
+        void reserveSlots(std::size_t count);
+        void encode(const Capture& capture, std::vector<unsigned char>& out);
+        bool decode(const std::vector<unsigned char>& in, std::size_t bodies);
+    };
+
+    void encode();
+    void store(Segment segment);
+    void store(Frame frame);
+    void trim();
+    bool decodeKeyframe(const Segment& segment);
+
+    Capture capture;
+    JobGroup pending;
+    bool started = false;
+    bool keyframeDue = true;
+    std::uint64_t lastKeyframe = 0;
+    std::atomic<std::uint64_t> recordedTick{ 0 };
+
+    // Кодер живе в завданні; секції й декодер - під lock
+    DeltaState encoder;
+    std::vector<unsigned char> encoded;
+    bool segmentOpen = false;
+    mutable std::mutex lock;
+    std::deque<Segment> segments;
+    std::size_t totalBytes = 0;
+
+    DeltaState decoder;
+    std::vector<float> decodedRadius; // за слотами, з ключового кадру
+    std::unique_ptr<Simulation> scratch;
+    bool decoderValid = false;
+    std::uint64_t decodedSegment = 0;
+    std::size_t decodedFrames = 0;
+    bool decodedBlackHole = true;
+};
+
+#endif
@@ -0,0 +1,159 @@
+﻿#include "ShipPool.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Перший перетин шукається грубим проходом по відрізку [0, tmax], потім бісекцією
+const int interceptSamples = 32;
+const int interceptIterations = 40;
+
+// Прогноз положення тіла через t секунд
+struct Prediction {
+    double x;
+    double y;
+    double velocityX;
+    double velocityY;
+    double centerX;
+    double centerY;
+    double omega;
+    bool orbit;
+
+    void at(double t, double& outX, double& outY) const {
+        if (orbit) {
+            double angle = omega * t;
+            double c = std::cos(angle);
+            double s = std::sin(angle);
+            outX = centerX + x * c - y * s;
+            outY = centerY + x * s + y * c;
+        }
+        else {
+            outX = x + velocityX * t;
+            outY = y + velocityY * t;
+        }
+    }
+};
+
+}
+
+void ShipPool::clear() {
+    resize(0);
+}
+
+void ShipPool::resize(std::size_t count) {
+    originX.resize(count);
+    originY.resize(count);
+    launchTime.resize(count);
+    aimX.resize(count);
+    aimY.resize(count);
+    arrivalTime.resize(count);
+    target.resize(count);
+    home.resize(count);
+    homeX.resize(count);
+    homeY.resize(count);
+}
+
+std::uint32_t ShipPool::add(const Vec2& position, BodyHandle colony, double now) {
+    const std::uint32_t ship = static_cast<std::uint32_t>(size());
+    resize(size() + 1);
+    home[ship] = colony;
+    homeX[ship] = position.x;
+    homeY[ship] = position.y;
+    park(ship, position, now);
+    return ship;
+}
+
+void ShipPool::launch(std::uint32_t ship, const Vec2& from, const Vec2& aim, double now, double flightTime) {
+    originX[ship] = from.x;
+    originY[ship] = from.y;
+    launchTime[ship] = now;
+    aimX[ship] = aim.x;
+    aimY[ship] = aim.y;
+    arrivalTime[ship] = now + flightTime;
+}
+
+void ShipPool::park(std::uint32_t ship, const Vec2& position, double now) {
+    target[ship] = noBody;
+    launch(ship, position, position, now, 0.0);
+}
+
+Vec2 ShipPool::positionAt(std::uint32_t ship, double time) const {
+    const double flight = arrivalTime[ship] - launchTime[ship];
+    if (!(flight > 0.0) || time >= arrivalTime[ship]) return Vec2(aimX[ship], aimY[ship]);
+    const float t = static_cast<float>(std::max(time - launchTime[ship], 0.0) / flight);
+    return Vec2(originX[ship] + (aimX[ship] - originX[ship]) * t, originY[ship] + (aimY[ship] - originY[ship]) * t);
+}
+
+void ShipPool::positionsAt(double time, std::vector<Vec2>& out) const {
+    out.resize(size());
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(size(), jobs.grainFor(size()), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t s = begin; s < end; ++s) {
+            out[s] = positionAt(static_cast<std::uint32_t>(s), time);
+        }
+    });
+}
+
+std::size_t ShipPool::bytesPerShip() {
+    return 6 * sizeof(float) + 2 * sizeof(double) + 2 * sizeof(BodyHandle);
+}
+
+double interceptTime(const Vec2& from, float speed, const Vec2& position, const Vec2& velocity,
+                     const Vec2& center, bool orbit, Vec2& aim) {
+    aim = position;
+    const double distance = length(position - from);
+    if (distance == 0.0) return 0.0;
+    if (!(speed > 0.0f)) return std::numeric_limits<double>::infinity();
+
+    Prediction prediction = { position.x, position.y, velocity.x, velocity.y, center.x, center.y, 0.0, false };
+    double limit;
+    const double relativeX = position.x - center.x;
+    const double relativeY = position.y - center.y;
+    const double orbitRadius = std::sqrt(relativeX * relativeX + relativeY * relativeY);
+    if (orbit && orbitRadius > 0.0) {
+        // Коло радіуса orbitRadius ціле досяжне за (orbitRadius + |from - center|) / speed
+        prediction.x = relativeX;
+        prediction.y = relativeY;
+        prediction.omega = (relativeX * velocity.y - relativeY * velocity.x) / (orbitRadius * orbitRadius);
+        prediction.orbit = true;
+        limit = (orbitRadius + length(from - center)) / speed;
+    }
+    else {
+        const double targetSpeed = length(velocity);
+        // Тіло швидше за корабель: летимо туди, де воно зараз, далі виправить перевірка при прибутті
+        if (targetSpeed >= speed) return distance / speed;
+        limit = distance / (speed - targetSpeed);
+    }
+
+    // gap(t) = відстань від старту до тіла мінус шлях корабля; gap(0) > 0, gap(limit) <= 0
+    auto gap = [&](double t) {
+        double x;
+        double y;
+        prediction.at(t, x, y);
+        return std::sqrt((x - from.x) * (x - from.x) + (y - from.y) * (y - from.y)) - speed * t;
+    };
+
+    double low = 0.0;
+    double high = limit;
+    for (int k = 1; k <= interceptSamples; ++k) {
+        double t = limit * k / interceptSamples;
+        if (gap(t) <= 0.0) {
+            high = t;
+            break;
+        }
+        low = t;
+    }
+    for (int i = 0; i < interceptIterations; ++i) {
+        double middle = 0.5 * (low + high);
+        if (gap(middle) <= 0.0) high = middle;
+        else low = middle;
+    }
+
+    double x;
+    double y;
+    prediction.at(high, x, y);
+    aim = Vec2(static_cast<float>(x), static_cast<float>(y));
+    return high;
+}
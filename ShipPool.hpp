@@ -0,0 +1,65 @@
+﻿#ifndef SHIP_POOL_HPP
+#define SHIP_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MatterStore.hpp"
+
+// Кораблі колонізації у вигляді паралельних масивів. Політ - відрізок від точки старту до
+// точки перехоплення з постійною швидкістю, тож положення корабля в будь-який момент
+// виводиться з часу старту й прибуття, і кроки симуляції кораблів не торкаються:
+// робота є лише тоді, коли корабель прибуває (подія в черзі Simulation).
+class ShipPool {
+public:
+    std::vector<float> originX;       // звідки й коли вилетів
+    std::vector<float> originY;
+    std::vector<double> launchTime;
+    std::vector<float> aimX;          // куди й коли прилетить
+    std::vector<float> aimY;
+    std::vector<double> arrivalTime;
+    std::vector<BodyHandle> target;   // noBody - корабель стоїть і чекає на вільну ціль
+    std::vector<BodyHandle> home;     // колонія, що випустила корабель
+    std::vector<float> homeX;         // куди повертатись, якщо колонію знищено
+    std::vector<float> homeY;
+
+    float speed = 10.0f;
+    float radius = 5.0f;
+
+    std::size_t size() const { return target.size(); }
+    bool empty() const { return target.empty(); }
+    void clear();
+    void resize(std::size_t count);
+
+    // Новий корабель стоїть у колонії без цілі
+    std::uint32_t add(const Vec2& position, BodyHandle colony, double now);
+    void launch(std::uint32_t ship, const Vec2& from, const Vec2& aim, double now, double flightTime);
+    void park(std::uint32_t ship, const Vec2& position, double now);
+
+    Vec2 positionAt(std::uint32_t ship, double time) const;
+    void positionsAt(double time, std::vector<Vec2>& out) const;
+
+    static std::size_t bytesPerShip();
+};
+
+// Подія черги колонізації: корабель ship прибуває в момент time
+struct ShipEvent {
+    double time;
+    std::uint32_t ship;
+};
+
+// Для std::priority_queue: найраніша подія нагорі, рівні - за номером корабля (детерміновано)
+struct ShipEventLater {
+    bool operator()(const ShipEvent& a, const ShipEvent& b) const {
+        return a.time > b.time || (a.time == b.time && a.ship > b.ship);
+    }
+};
+
+// Час, за який корабель зі швидкістю speed із точки from наздожене тіло, що зараз у position
+// з швидкістю velocity. orbit = true - тіло кружляє навколо center з поточною кутовою
+// швидкістю, інакше летить по прямій. aim - точка зустрічі. Прогноз наближений:
+// у момент прибуття Simulation перевіряє, чи тіло справді там.
+double interceptTime(const Vec2& from, float speed, const Vec2& position, const Vec2& velocity,
+                     const Vec2& center, bool orbit, Vec2& aim);
+
+#endif
@@ -0,0 +1,656 @@
+﻿#include "Simulation.hpp"
+#include "Morton.hpp"
+#include "JobSystem.hpp"
+#include "ParallelSort.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void applyGravityToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime) {
+    const float pullMass = blackHoleMass * gravityMultiplier;
+    const std::size_t count = matters.size();
+    float* posX = matters.posX.data();
+    float* posY = matters.posY.data();
+    float* velX = matters.velX.data();
+    float* velY = matters.velY.data();
+    const float* mass = matters.mass.data();
+
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            float dx = blackHolePosition.x - posX[i];
+            float dy = blackHolePosition.y - posY[i];
+            float distance = std::sqrt(dx * dx + dy * dy);
+            dx /= distance;
+            dy /= distance;
+
+            // Вычисляем силу притяжения
+            float G = 1.0f; // Гравитационная постоянная
+            float force = (G * mass[i] * pullMass) / (distance * distance);
+
+            // Вычисляем ускорение
+            float acceleration = force / mass[i];
+            velX[i] += dx * acceleration * deltaTime;
+            velY[i] += dy * acceleration * deltaTime;
+        }
+    });
+}
+
+void applyGravityToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime, GravitySolver& solver) {
+    if (solver.mode == GravityMode::BlackHoleOnly) {
+        applyGravityToMatters(matters, blackHolePosition, blackHoleMass, gravityMultiplier, deltaTime);
+        return;
+    }
+
+    const bool mesh = solver.mode == GravityMode::ParticleMesh;
+    if (mesh) {
+        solver.mesh.build(matters);
+        solver.mesh.applyToMatters(matters, blackHolePosition, blackHoleMass * gravityMultiplier, deltaTime);
+    }
+    else {
+        solver.tree.build(matters);
+        solver.tree.applyToMatters(matters, blackHolePosition, blackHoleMass * gravityMultiplier, deltaTime);
+    }
+
+    // Зведені маси інших доменів; Ейлер не зберігає прискорень, тож accX/accY тут лише тимчасові
+    if (!solver.externalMass.empty()) {
+        std::fill(matters.accX.begin(), matters.accX.end(), 0.0f);
+        std::fill(matters.accY.begin(), matters.accY.end(), 0.0f);
+        addPointMassAccelerations(matters.posX.data(), matters.posY.data(), matters.accX.data(), matters.accY.data(), matters.size(),
+                                  solver.externalX.data(), solver.externalY.data(), solver.externalMass.data(), solver.externalMass.size(),
+                                  mesh ? solver.mesh.gravitationalConstant : solver.tree.gravitationalConstant,
+                                  mesh ? solver.mesh.softening : solver.tree.softening);
+        kickMatters(matters.velX.data(), matters.velY.data(), matters.accX.data(), matters.accY.data(), matters.size(), deltaTime);
+    }
+}
+
+void updateMatters(MatterStore& matters, float deltaTime) {
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        matters.posX[i] += matters.velX[i] * deltaTime;
+        matters.posY[i] += matters.velY[i] * deltaTime;
+    }
+}
+
+std::size_t handleCollisions(MatterStore& matters, CollisionSolver& solver) {
+    KOSMOS_PROFILE_SCOPE("collisions");
+    solver.grid.build(matters);
+
+    const float* posX = matters.posX.data();
+    const float* posY = matters.posY.data();
+    const float* velX = matters.velX.data();
+    const float* velY = matters.velY.data();
+    const float* mass = matters.mass.data();
+    const float* radius = matters.radius.data();
+    const float restitution = solver.restitution;
+
+    // Широка фаза: шматки фіксованого розміру в порядку сховища - після упорядкування за Мортоном
+    // сусідні тіла шматка читають ті самі комірки. Кожна пара знаходиться один раз (тілом з меншим
+    // індексом), тож результат не залежить від кількості потоків.
+    const std::size_t bodyCount = matters.size();
+    const std::size_t chunkSize = 2048;
+    JobSystem& jobs = JobSystem::instance();
+    solver.chunkContacts.resize((bodyCount + chunkSize - 1) / chunkSize);
+
+    jobs.parallelFor(bodyCount, chunkSize, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        KOSMOS_PROFILE_SCOPE("collisions chunk");
+        std::uint64_t tested = 0;
+        std::vector<CollisionContact>& found = solver.chunkContacts[chunk];
+        found.clear();
+
+        for (std::size_t body = begin; body < end; ++body) {
+            const std::uint32_t i = static_cast<std::uint32_t>(body);
+            solver.grid.forEachNeighbour(posX[i], posY[i], [&](std::uint32_t, std::uint32_t j) {
+                if (j <= i) return;
+                ++tested;
+
+                float dx = posX[i] - posX[j];
+                float dy = posY[i] - posY[j];
+                float distance2 = dx * dx + dy * dy;
+                float minDistance = radius[i] + radius[j];
+                if (distance2 >= minDistance * minDistance || distance2 == 0.0f) return;
+
+                // Вузька фаза: імпульс як у Matter::resolveCollision, зі справжніми масами
+                float distance = std::sqrt(distance2);
+                float normalX = dx / distance;
+                float normalY = dy / distance;
+                float velocityAlongNormal = (velX[i] - velX[j]) * normalX + (velY[i] - velY[j]) * normalY;
+                if (velocityAlongNormal > 0) return;
+
+                float impulseScalar = -(1.0f + restitution) * velocityAlongNormal;
+                impulseScalar /= 1.0f / mass[i] + 1.0f / mass[j];
+
+                CollisionContact contact = { i, j, impulseScalar * normalX, impulseScalar * normalY };
+                found.push_back(contact);
+            });
+        }
+        KOSMOS_PROFILE_COUNT("collision pairs tested", tested);
+    });
+
+    solver.contacts.clear();
+    for (const auto& found : solver.chunkContacts) {
+        solver.contacts.insert(solver.contacts.end(), found.begin(), found.end());
+    }
+
+    // Кожне тіло підсумовує свої імпульси в порядку контактів, тож підсумок детермінований
+    const std::size_t contactCount = solver.contacts.size();
+    KOSMOS_PROFILE_COUNT("collision contacts", contactCount);
+    if (contactCount == 0) return 0;
+
+    solver.entryBodies.resize(2 * contactCount);
+    solver.entryIds.resize(2 * contactCount);
+    jobs.parallelFor(contactCount, jobs.grainFor(contactCount), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            solver.entryBodies[2 * c] = solver.contacts[c].first;
+            solver.entryBodies[2 * c + 1] = solver.contacts[c].second;
+            solver.entryIds[2 * c] = static_cast<std::uint32_t>(2 * c);
+            solver.entryIds[2 * c + 1] = static_cast<std::uint32_t>(2 * c + 1);
+        }
+    });
+
+    int bodyBits = 8;
+    while ((1ULL << bodyBits) < matters.size() && bodyBits < 32) bodyBits += 8;
+    radixSortPairs(solver.entryBodies, solver.entryIds, bodyBits);
+
+    const std::size_t entryCount = 2 * contactCount;
+    float* outVelX = matters.velX.data();
+    float* outVelY = matters.velY.data();
+    jobs.parallelFor(entryCount, jobs.grainFor(entryCount), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t e = begin; e < end; ++e) {
+            if (e > 0 && solver.entryBodies[e - 1] == solver.entryBodies[e]) continue;
+
+            const std::uint32_t body = solver.entryBodies[e];
+            float deltaX = 0.0f;
+            float deltaY = 0.0f;
+            for (std::size_t g = e; g < entryCount && solver.entryBodies[g] == body; ++g) {
+                const std::uint32_t id = solver.entryIds[g];
+                const CollisionContact& contact = solver.contacts[id / 2];
+                float sign = (id & 1u) ? -1.0f : 1.0f;
+                deltaX += sign * contact.impulseX;
+                deltaY += sign * contact.impulseY;
+            }
+            outVelX[body] += deltaX / mass[body];
+            outVelY[body] += deltaY / mass[body];
+        }
+    });
+
+    return static_cast<std::size_t>(contactCount);
+}
+
+std::size_t findNearestMatter(const Vec2& position, const MatterStore& matters) {
+    std::size_t nearestMatter = noMatter;
+    float minDistance = std::numeric_limits<float>::max();
+
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        if (matters.isColony[i]) continue;
+
+        float dx = matters.posX[i] - position.x;
+        float dy = matters.posY[i] - position.y;
+        float distance = std::sqrt(dx * dx + dy * dy);
+
+        if (distance < minDistance) {
+            minDistance = distance;
+            nearestMatter = i;
+        }
+    }
+
+    return nearestMatter;
+}
+
+std::size_t findNearestMatter(const Vec2& position, const MatterStore& matters, const TargetIndex& targets) {
+    return targets.nearest(position, matters, false);
+}
+
+void collectMattersInKillZone(const MatterStore& matters, const Vec2& blackHolePosition, float deletionRadius, KillList& kill) {
+    kill.radius = deletionRadius;
+    collectKillZone(matters.posX.data(), matters.posY.data(), matters.size(), blackHolePosition.x, blackHolePosition.y, kill);
+}
+
+Simulation::Simulation(const Vec2& blackHolePosition, float blackHoleMass, float deletionRadius)
+    : blackHolePosition(blackHolePosition), blackHoleMass(blackHoleMass), deletionRadius(deletionRadius) {
+}
+
+void Simulation::makeColony(std::size_t index) {
+    matters.isColony[index] = 1;
+    matters.isTargeted[index] = 0;
+    targets.remove(index);
+}
+
+void Simulation::createShip(std::size_t index) {
+    matters.hasShip[index] = 1;
+    idleShips.push_back(ships.add(shipViewPosition(index), matters.handleOf(index), time));
+    retryIdleShips = true;
+}
+
+template <std::size_t... Keys>
+const Simulation::StepFunction* Simulation::stepTable(std::index_sequence<Keys...>) {
+    static const StepFunction table[] = {
+        &Simulation::stepWith<StepPolicy<(Keys & 8) ? Integrator::Leapfrog : Integrator::Euler, (Keys & 4) != 0, (Keys & 2) != 0, (Keys & 1) != 0>>...
+    };
+    return table;
+}
+
+void Simulation::step(float deltaTime) {
+    KOSMOS_PROFILE_SCOPE("step");
+    KOSMOS_PROFILE_VALUE("bodies", matters.size());
+    KOSMOS_PROFILE_VALUE("ships", ships.size());
+
+    if (specializedSteps) {
+        // Інстанціація переобирається лише тоді, коли змінився якийсь перемикач (клавіша, знімок)
+        const bool pulls = blackHoleActive && !blackHolePaused;
+        const int key = (integrator == Integrator::Leapfrog ? 8 : 0) | (pulls ? 4 : 0) | (collisionHandlingActive ? 2 : 0) | (colonizationActive ? 1 : 0);
+        if (key != stepKey) {
+            stepKey = key;
+            stepFunction = stepTable(std::make_index_sequence<16>())[key];
+        }
+        // Час кінця кроку: за ним колонізація, що йде разом із гравітацією, перевіряє прибуття
+        time += deltaTime;
+        (this->*stepFunction)(deltaTime);
+    }
+    else {
+        time += deltaTime;
+        stepGeneric(deltaTime);
+    }
+    ++tick;
+}
+
+template <class Policy>
+void Simulation::stepWith(float deltaTime) {
+    if constexpr (!Policy::colonize) {
+        // Без колонізації кожна фаза чекає на попередню, тож вони йдуть підряд у цьому потоці
+        if (reorderDue(Policy::collide)) reorderBodies();
+        if constexpr (Policy::collide) handleCollisions(matters, collisions);
+        bool killsCollected;
+        {
+            KOSMOS_PROFILE_SCOPE("gravity");
+            killsCollected = integrateSubsteps<Policy::integrator, Policy::pull>(deltaTime);
+        }
+        if (!killsCollected) {
+            KOSMOS_PROFILE_SCOPE("kill zone");
+            collectMattersInKillZone(matters, blackHolePosition, deletionRadius, killList);
+        }
+        KOSMOS_PROFILE_SCOPE("kill zone erase");
+        removeMatters(killList.indices);
+    }
+    else {
+        // Колонізація йде разом із гравітацією, збір зони знищення - після неї (див. stepGeneric)
+        bool killsCollected = false;
+        stepGraph.clear();
+        TaskGraph::Task reorder = stepGraph.add("morton reorder", [&] {
+            if (reorderDue(Policy::collide)) reorderBodies();
+        });
+        TaskGraph::Task frame = stepGraph.add("ship frame", [&] { captureShipFrame(); });
+        TaskGraph::Task pull = stepGraph.add("gravity", [&] {
+            if constexpr (Policy::collide) handleCollisions(matters, collisions);
+            killsCollected = integrateSubsteps<Policy::integrator, Policy::pull>(deltaTime);
+        });
+        TaskGraph::Task colonize = stepGraph.add("colonization", [&] { updateShips(); });
+        TaskGraph::Task killZone = stepGraph.add("kill zone", [&] {
+            if (!killsCollected) collectMattersInKillZone(matters, blackHolePosition, deletionRadius, killList);
+        });
+        TaskGraph::Task erase = stepGraph.add("kill zone erase", [&] {
+            removeMatters(killList.indices);
+            retargetLostShips();
+        });
+
+        stepGraph.precede(reorder, frame);
+        stepGraph.precede(frame, pull);
+        stepGraph.precede(frame, colonize);
+        stepGraph.precede(pull, killZone);
+        stepGraph.precede(colonize, erase);
+        stepGraph.precede(killZone, erase);
+        stepGraph.run();
+    }
+}
+
+void Simulation::stepGeneric(float deltaTime) {
+    // Фази кроку - граф на пулі JobSystem. Колонізація читає копію позицій і швидкостей з початку
+    // кроку, а пише лише прапорці тіл, кораблі й індекс цілей, яких зіткнення, гравітація й зона знищення
+    // не чіпають, тож вона йде паралельно з ними; видалення чекає на всіх, бо зсуває індекси
+    bool killsCollected = false;
+    stepGraph.clear();
+
+    // Упорядкування зсуває всі індекси, тож іде першим, поки ніхто їх не тримає
+    TaskGraph::Task reorder = stepGraph.add("morton reorder", [&] {
+        if (reorderDue(collisionHandlingActive)) reorderBodies();
+    });
+
+    TaskGraph::Task frame = stepGraph.add("ship frame", [&] {
+        if (colonizationActive) captureShipFrame();
+    });
+
+    // Зіткнення розв'язуються до гравітації, щоб поштовх і дрейф пройшли одним проходом
+    TaskGraph::Task collide = stepGraph.add("collisions", [&] {
+        if (collisionHandlingActive) handleCollisions(matters, collisions);
+    });
+
+    // Зона знищення перевіряється в останньому підкроці, у тому ж проході, що й гравітація
+    TaskGraph::Task pull = stepGraph.add("gravity", [&] {
+        const bool pulls = blackHoleActive && !blackHolePaused;
+        if (integrator == Integrator::Leapfrog) {
+            killsCollected = pulls ? integrateSubsteps<Integrator::Leapfrog, true>(deltaTime) : integrateSubsteps<Integrator::Leapfrog, false>(deltaTime);
+        }
+        else {
+            killsCollected = pulls ? integrateSubsteps<Integrator::Euler, true>(deltaTime) : integrateSubsteps<Integrator::Euler, false>(deltaTime);
+        }
+    });
+
+    TaskGraph::Task colonize = stepGraph.add("colonization", [&] {
+        if (colonizationActive) updateShips();
+    });
+
+    TaskGraph::Task killZone = stepGraph.add("kill zone", [&] {
+        if (!killsCollected) collectMattersInKillZone(matters, blackHolePosition, deletionRadius, killList);
+    });
+
+    // Кіл зона дірки
+    TaskGraph::Task erase = stepGraph.add("kill zone erase", [&] {
+        removeMatters(killList.indices);
+        retargetLostShips();
+    });
+
+    stepGraph.precede(reorder, frame);
+    stepGraph.precede(frame, collide);
+    stepGraph.precede(frame, colonize);
+    stepGraph.precede(collide, pull);
+    stepGraph.precede(pull, killZone);
+    stepGraph.precede(colonize, erase);
+    stepGraph.precede(killZone, erase);
+    stepGraph.run();
+}
+
+bool Simulation::reorderDue(bool collide) const {
+    // Ядра самої чорної діри читають масиви підряд, тож лише зіткнення й взаємна гравітація
+    // (вибірки сусідів) окупають перестановку
+    const bool gathers = collide || gravity.mode != GravityMode::BlackHoleOnly;
+    return gathers && reorderInterval > 0 && tick % static_cast<std::uint64_t>(reorderInterval) == 0;
+}
+
+void Simulation::removeMatters(const std::vector<std::uint32_t>& indices) {
+    if (indices.empty()) return;
+    KOSMOS_PROFILE_COUNT("bodies erased", indices.size());
+
+    // Кораблі тримають дескриптори, тож про зниклу ціль корабель дізнається, коли прилетить
+    matters.removeSwap(indices, &bodyMoves);
+    targets.applyRemovals(bodyMoves);
+    ++layoutVersion;
+}
+
+bool Simulation::reorderBodies() {
+    KOSMOS_PROFILE_SCOPE("morton reorder");
+    if (matters.size() < 2) return false;
+
+    // Тіла лише трохи зсуваються між упорядкуваннями, тож кількість "спадів" ключа показує,
+    // наскільки порядок розсипався (у профайлері видно, як часто його варто відновлювати)
+    computeMortonKeys(matters.posX.data(), matters.posY.data(), matters.size(), reorderKeys, reorderOrder);
+    const std::size_t descents = countMortonDescents(reorderKeys);
+    KOSMOS_PROFILE_VALUE("morton descents", descents);
+    if (descents == 0) return false;
+
+    radixSortPairs(reorderKeys, reorderOrder);
+    matters.permute(reorderOrder);
+
+    // Кораблі тримають дескриптори, а індекс цілей - індекси, тож його треба перебудувати
+    targetsDirty = true;
+    ++layoutVersion;
+    return true;
+}
+
+template <Integrator Method, bool Pull>
+bool Simulation::integrateSubsteps(float deltaTime) {
+    // Сила діри однакова для всіх підкроків
+    const float pullMass = Pull ? blackHoleMass * gravityMultiplier : 0.0f;
+    const int count = std::max(substeps, 1);
+    const float substep = deltaTime / count;
+    killList.radius = deletionRadius;
+    bool killsCollected = false;
+    for (int i = 0; i < count; ++i) {
+        killsCollected = integrate<Method, Pull>(substep, pullMass, i == count - 1 ? &killList : nullptr);
+    }
+    return killsCollected;
+}
+
+template <Integrator Method, bool Pull>
+bool Simulation::integrate(float deltaTime, float pullMass, KillList* kill) {
+    bodySteps += matters.size();
+
+    if constexpr (Method == Integrator::Euler) {
+        accelerationsValid = false;
+        if (gravity.mode != GravityMode::BlackHoleOnly) {
+            // Взаємна гравітація діє й тоді, коли чорна діра вимкнена
+            applyGravityToMatters(matters, blackHolePosition, Pull ? blackHoleMass : 0.0f, gravityMultiplier, deltaTime, gravity);
+            driftMatters(matters.posX.data(), matters.posY.data(), matters.velX.data(), matters.velY.data(), matters.size(), deltaTime);
+        }
+        else if constexpr (!Pull) {
+            driftMatters(matters.posX.data(), matters.posY.data(), matters.velX.data(), matters.velY.data(), matters.size(), deltaTime);
+        }
+        else if (gravity.kernel == KernelIsa::Reference) {
+            applyGravityToMatters(matters, blackHolePosition, blackHoleMass, gravityMultiplier, deltaTime);
+            updateMatters(matters, deltaTime);
+        }
+        else {
+            blackHoleKickDrift(matters.posX.data(), matters.posY.data(), matters.velX.data(), matters.velY.data(), matters.size(),
+                               blackHolePosition.x, blackHolePosition.y, pullMass, deltaTime, gravity.kernel, kill);
+            return kill != nullptr;
+        }
+        return false;
+    }
+    else {
+        // Прискорення з кінця минулого кроку годяться, лише якщо сила відтоді не змінилась
+        if (!accelerationsValid || accelerationMode != gravity.mode || accelerationPull != pullMass) {
+            computeAccelerations(pullMass);
+        }
+
+        float* posX = matters.posX.data();
+        float* posY = matters.posY.data();
+        float* velX = matters.velX.data();
+        float* velY = matters.velY.data();
+        float* accX = matters.accX.data();
+        float* accY = matters.accY.data();
+        const std::size_t bodyCount = matters.size();
+
+        if (gravity.mode != GravityMode::BlackHoleOnly) {
+            kickMatters(velX, velY, accX, accY, bodyCount, 0.5f * deltaTime);
+            driftMatters(posX, posY, velX, velY, bodyCount, deltaTime);
+            computeAccelerations(pullMass);
+            kickMatters(velX, velY, accX, accY, bodyCount, 0.5f * deltaTime);
+        }
+        else if (!Pull || pullMass == 0.0f) {
+            driftMatters(posX, posY, velX, velY, bodyCount, deltaTime);
+        }
+        else if (blockTimesteps) {
+            // Один підкрок на тіло вже враховано вище
+            bodySteps += blackHoleBlockLeapfrog(posX, posY, velX, velY, accX, accY, bodyCount, blackHolePosition.x, blackHolePosition.y, pullMass,
+                                                deltaTime, timestepAccuracy, maxRung, gravity.kernel, kill) - bodyCount;
+            return kill != nullptr;
+        }
+        else {
+            // Сила залежить лише від власної позиції тіла, тож увесь крок іде одним проходом
+            blackHoleLeapfrog(posX, posY, velX, velY, accX, accY, bodyCount,
+                              blackHolePosition.x, blackHolePosition.y, pullMass, deltaTime, gravity.kernel, kill);
+            return kill != nullptr;
+        }
+        return false;
+    }
+}
+
+void Simulation::computeAccelerations(float pullMass) {
+    KOSMOS_PROFILE_SCOPE("accelerations");
+    if (gravity.mode == GravityMode::BarnesHut) {
+        gravity.tree.build(matters);
+        gravity.tree.storeAccelerations(matters, blackHolePosition, pullMass);
+        addExternalAccelerations(gravity.tree.gravitationalConstant, gravity.tree.softening);
+    }
+    else if (gravity.mode == GravityMode::ParticleMesh) {
+        gravity.mesh.build(matters);
+        gravity.mesh.storeAccelerations(matters, blackHolePosition, pullMass);
+        addExternalAccelerations(gravity.mesh.gravitationalConstant, gravity.mesh.softening);
+    }
+    else if (pullMass > 0.0f) {
+        blackHoleAccelerations(matters.posX.data(), matters.posY.data(), matters.accX.data(), matters.accY.data(), matters.size(),
+                               blackHolePosition.x, blackHolePosition.y, pullMass);
+    }
+    else {
+        std::fill(matters.accX.begin(), matters.accX.end(), 0.0f);
+        std::fill(matters.accY.begin(), matters.accY.end(), 0.0f);
+    }
+
+    accelerationsValid = true;
+    accelerationMode = gravity.mode;
+    accelerationPull = pullMass;
+}
+
+void Simulation::addExternalAccelerations(float gravitationalConstant, float softening) {
+    if (gravity.externalMass.empty()) return;
+    addPointMassAccelerations(matters.posX.data(), matters.posY.data(), matters.accX.data(), matters.accY.data(), matters.size(),
+                              gravity.externalX.data(), gravity.externalY.data(), gravity.externalMass.data(), gravity.externalMass.size(),
+                              gravitationalConstant, softening);
+}
+
+void Simulation::captureShipFrame() {
+    // Черга впорядкована за часом прибуття: крок без прибуттів коштує одне порівняння і не копіює нічого
+    const bool due = !shipEvents.empty() && shipEvents.top().time <= time;
+    shipFrameActive = due || retryIdleShips;
+    if (!shipFrameActive) return;
+
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t count = matters.size();
+    shipFrameX.resize(count);
+    shipFrameY.resize(count);
+    shipFrameVelX.resize(count);
+    shipFrameVelY.resize(count);
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::copy(matters.posX.begin() + begin, matters.posX.begin() + end, shipFrameX.begin() + begin);
+        std::copy(matters.posY.begin() + begin, matters.posY.begin() + end, shipFrameY.begin() + begin);
+        std::copy(matters.velX.begin() + begin, matters.velX.begin() + end, shipFrameVelX.begin() + begin);
+        std::copy(matters.velY.begin() + begin, matters.velY.begin() + end, shipFrameVelY.begin() + begin);
+    });
+}
+
+Vec2 Simulation::shipViewPosition(std::size_t index) const {
+    return shipFrameActive ? Vec2(shipFrameX[index], shipFrameY[index]) : matters.position(index);
+}
+
+Vec2 Simulation::shipViewVelocity(std::size_t index) const {
+    return shipFrameActive ? Vec2(shipFrameVelX[index], shipFrameVelY[index]) : matters.velocity(index);
+}
+
+void Simulation::updateShips() {
+    if (!shipFrameActive) return;
+
+    if (targetsDirty) {
+        targets.rebuild(matters, shipFrameX.data(), shipFrameY.data());
+        targetsDirty = false;
+    }
+    else {
+        targets.update(matters, shipFrameX.data(), shipFrameY.data());
+    }
+
+    // Події обробляються по черзі прибуття, тож перший, хто прилетів, першим і обирає нову ціль
+    std::size_t processed = 0;
+    while (!shipEvents.empty() && shipEvents.top().time <= time) {
+        const ShipEvent event = shipEvents.top();
+        shipEvents.pop();
+        // Корабель, перенаправлений після видалення цілі, вже має пізніше прибуття
+        if (event.time != ships.arrivalTime[event.ship]) continue;
+        arriveShip(event.ship);
+        ++processed;
+    }
+    shipArrivals += processed;
+    KOSMOS_PROFILE_COUNT("ship arrivals", processed);
+
+    if (retryIdleShips) {
+        retryIdleShips = false;
+        std::vector<std::uint32_t> waiting;
+        waiting.swap(idleShips);
+        for (std::uint32_t ship : waiting) {
+            dispatchShip(ship, Vec2(ships.aimX[ship], ships.aimY[ship]));
+        }
+    }
+    shipFrameActive = false;
+}
+
+void Simulation::retargetLostShips() {
+    // Ціль обиралась за позиціями початку кроку, тож могла за цей крок упасти в дірку.
+    // Корабель стартував у кінці кроку й ще стоїть у точці старту
+    const std::size_t count = launchedShips.size();
+    for (std::size_t k = 0; k < count; ++k) {
+        const std::uint32_t ship = launchedShips[k];
+        const BodyHandle target = ships.target[ship];
+        if (!target.valid() || matters.alive(target)) continue;
+        dispatchShip(ship, Vec2(ships.originX[ship], ships.originY[ship]));
+    }
+    launchedShips.clear();
+}
+
+void Simulation::arriveShip(std::uint32_t ship) {
+    const Vec2 position(ships.aimX[ship], ships.aimY[ship]);
+    const std::size_t index = matters.indexOf(ships.target[ship]);
+
+    // Ціль, яку знищила дірка або вже колонізували (наприклад, клавішею Num8), більше не наша
+    if (index == noMatter || matters.isColony[index]) {
+        dispatchShip(ship, position);
+        return;
+    }
+
+    // Тіло зійшло з прогнозу (зіткнення, взаємна гравітація, еліптична орбіта): доганяємо звідси
+    if (length(shipViewPosition(index) - position) >= ships.radius + matters.radius[index]) {
+        // Тіло, викинуте швидше за корабель (зіткненням), не наздогнати: віддаємо його іншим.
+        // Позначка знімається лише після вибору нової цілі, інакше найближчим знову було б воно ж,
+        // а кораблі, що чекають, можуть узяти звільнене тіло
+        if (length(shipViewVelocity(index)) >= ships.speed) {
+            dispatchShip(ship, position);
+            matters.isTargeted[index] = 0;
+            retryIdleShips = true;
+        }
+        else {
+            launchShip(ship, position, index);
+        }
+        return;
+    }
+
+    // Колонізуємо нову зірку
+    makeColony(index);
+
+    // Створюємо новий корабель
+    if (!matters.hasShip[index]) {
+        createShip(index);
+    }
+
+    // Повертаємо корабель на батьківщину: до колонії, якщо вона ще існує
+    const std::size_t home = matters.indexOf(ships.home[ship]);
+    dispatchShip(ship, home != noMatter ? shipViewPosition(home) : Vec2(ships.homeX[ship], ships.homeY[ship]));
+}
+
+void Simulation::dispatchShip(std::uint32_t ship, const Vec2& from) {
+    const std::size_t target = shipFrameActive ? targets.nearest(from, matters, shipFrameX.data(), shipFrameY.data(), true)
+                                               : targets.nearest(from, matters, true);
+    if (target == noMatter) {
+        ships.park(ship, from, time);
+        idleShips.push_back(ship);
+        return;
+    }
+    matters.isTargeted[target] = 1;
+    ships.target[ship] = matters.handleOf(target);
+    launchShip(ship, from, target);
+}
+
+void Simulation::launchShip(std::uint32_t ship, const Vec2& from, std::size_t target) {
+    // З діркою тіла кружляють навколо неї; без дірки і викинуті зіткненням летять по прямій
+    const Vec2 velocity = shipViewVelocity(target);
+    const bool orbit = blackHoleActive && !blackHolePaused && length(velocity) < ships.speed;
+    Vec2 aim;
+    double flight = interceptTime(from, ships.speed, shipViewPosition(target), velocity, blackHolePosition, orbit, aim);
+    ships.launch(ship, from, aim, time, flight);
+    shipEvents.push(ShipEvent{ ships.arrivalTime[ship], ship });
+    launchedShips.push_back(ship);
+}
+
+void Simulation::rebuildShipEvents() {
+    shipEvents = std::priority_queue<ShipEvent, std::vector<ShipEvent>, ShipEventLater>();
+    for (std::uint32_t ship = 0; ship < ships.size(); ++ship) {
+        if (ships.target[ship].valid()) {
+            shipEvents.push(ShipEvent{ ships.arrivalTime[ship], ship });
+        }
+    }
+}
@@ -0,0 +1,203 @@
+﻿#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "BarnesHut.hpp"
+#include "GravityKernels.hpp"
+#include "Grid.hpp"
+#include "JobSystem.hpp"
+#include "MatterStore.hpp"
+#include "ParticleMesh.hpp"
+#include "ShipPool.hpp"
+#include "TargetIndex.hpp"
+
+// Ядро симуляції без залежності від SFML: його використовують і вікно, і headless-режим
+
+enum class GravityMode {
+    BlackHoleOnly, // лише притягування до чорної діри
+    BarnesHut,     // взаємна гравітація тіл через квадродерево + чорна діра
+    ParticleMesh   // взаємна гравітація через сітку та FFT (мільйони тіл) + чорна діра
+};
+
+enum class Integrator {
+    Euler,   // напівнеявний Ейлер: поштовх, потім дрейф (старий крок)
+    Leapfrog // kick-drift-kick (швидкісний Верле): симплектичний, енергія не дрейфує
+};
+
+struct GravitySolver {
+    GravityMode mode = GravityMode::BlackHoleOnly;
+    KernelIsa kernel = detectKernelIsa(); // шлях ядра для режиму BlackHoleOnly
+    BarnesHutTree tree;
+    ParticleMesh mesh;
+
+    // Зведені маси поза цим сховищем (інші домени DomainWorker); діють лише у режимах із взаємною гравітацією
+    std::vector<float> externalX;
+    std::vector<float> externalY;
+    std::vector<float> externalMass;
+};
+
+struct CollisionContact {
+    std::uint32_t first;
+    std::uint32_t second;
+    float impulseX;
+    float impulseY;
+};
+
+struct CollisionSolver {
+    Grid grid;
+    float restitution = 0.8f;
+
+    // Робочі буфери, що переживають кроки
+    std::vector<std::vector<CollisionContact>> chunkContacts;
+    std::vector<CollisionContact> contacts;
+    std::vector<std::uint32_t> entryBodies;
+    std::vector<std::uint32_t> entryIds;
+};
+
+void applyGravityToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime);
+void applyGravityToMatters(MatterStore& matters, const Vec2& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime, GravitySolver& solver);
+void updateMatters(MatterStore& matters, float deltaTime);
+std::size_t handleCollisions(MatterStore& matters, CollisionSolver& solver);
+std::size_t findNearestMatter(const Vec2& position, const MatterStore& matters);
+std::size_t findNearestMatter(const Vec2& position, const MatterStore& matters, const TargetIndex& targets);
+// Тіла в зоні знищення -> kill.indices (для шляхів, де ядро гравітації їх не зібрало)
+void collectMattersInKillZone(const MatterStore& matters, const Vec2& blackHolePosition, float deletionRadius, KillList& kill);
+
+// Перемикачі кроку, відомі під час компіляції (у вікні - клавіші Num0, Num7, Num8, P та L).
+// Кожна комбінація - окрема функція кроку: вимкнених фаз у ній немає зовсім, сила діри
+// й вибір ядра згортаються, а без колонізації фази йдуть підряд без графа завдань.
+template <Integrator Method, bool Pull, bool Collide, bool Colonize>
+struct StepPolicy {
+    static constexpr Integrator integrator = Method;
+    static constexpr bool pull = Pull; // діра активна й не на паузі
+    static constexpr bool collide = Collide;
+    static constexpr bool colonize = Colonize;
+};
+
+class Simulation {
+public:
+    MatterStore matters;
+    ShipPool ships;
+    GravitySolver gravity;
+    CollisionSolver collisions;
+    TargetIndex targets;
+
+    Vec2 blackHolePosition;
+    float blackHoleMass;
+    float deletionRadius;
+
+    Integrator integrator = Integrator::Leapfrog;
+    int substeps = 1; // кожен крок ділиться на стільки рівних підкроків інтегрування
+
+    // Блокові кроки (leapfrog, лише чорна діра): тіло ділить підкрок на 2^rung частин,
+    // щоб кожна була не довшою за timestepAccuracy * sqrt(r / |a|); rung не більший за maxRung
+    bool blockTimesteps = false;
+    float timestepAccuracy = 0.05f;
+    int maxRung = 10;
+
+    // Кожні reorderInterval кроків тіла сховища переставляються в порядку Мортона за позицією
+    // (0 - ніколи), тож сусіди в просторі лежать поруч у пам'яті для зіткнень і дерева
+    int reorderInterval = 32;
+
+    std::uint64_t tick = 0; // кількість виконаних кроків
+    double time = 0.0;      // симульований час, с (за ним плануються прибуття кораблів)
+    std::uint64_t shipArrivals = 0; // оброблені події колонізації за весь прогін
+    std::uint64_t bodySteps = 0;    // тіло-підкроки інтегрування за весь прогін
+
+    // Зростає, коли індекси тіл змінюються (видалення), щоб знімки знали, що їх не можна змішувати
+    std::uint64_t layoutVersion = 0;
+
+    float gravityMultiplier = 70.5f;
+    bool blackHoleActive = true;
+    bool blackHolePaused = false;
+    bool collisionHandlingActive = false;
+    bool colonizationActive = false;
+
+    // false - загальний крок, що перевіряє перемикачі під час виконання (для порівняння)
+    bool specializedSteps = true;
+
+    Simulation(const Vec2& blackHolePosition, float blackHoleMass, float deletionRadius);
+
+    void step(float deltaTime);
+    void makeColony(std::size_t index);
+    // Новий корабель у колонії; ціль отримає на найближчому кроці
+    void createShip(std::size_t index);
+    // Після заміни matters збережені прискорення більше не відповідають тілам
+    void resetAccelerations() { accelerationsValid = false; }
+    // Видаляє тіла за індексами (унікальні, за зростанням), як зона знищення
+    void removeMatters(const std::vector<std::uint32_t>& indices);
+    // Переставляє тіла в порядку Мортона; false, якщо вони вже в ньому
+    bool reorderBodies();
+    // Після додавання тіл у matters (з готовими прискореннями): індекс цілей перебудується
+    void mattersAdded() {
+        targetsDirty = true;
+        ++layoutVersion;
+    }
+
+private:
+    // Знімок зберігає й відновлює внутрішній стан кроку, щоб продовження було побітово точним
+    friend void writeSnapshot(const Simulation& simulation, float fixedStep, std::vector<unsigned char>& out);
+    friend bool readSnapshot(const unsigned char* data, std::size_t size, Simulation& simulation, float* fixedStep);
+
+    typedef void (Simulation::*StepFunction)(float);
+
+    template <class Policy>
+    void stepWith(float deltaTime);
+    void stepGeneric(float deltaTime);
+    // Таблиця інстанціацій stepWith, індекс - ключ перемикачів (див. step)
+    template <std::size_t... Keys>
+    static const StepFunction* stepTable(std::index_sequence<Keys...>);
+
+    bool reorderDue(bool collide) const;
+    // Усі підкроки кроку; true, якщо ядро вже зібрало тіла в зоні знищення у killList
+    template <Integrator Method, bool Pull>
+    bool integrateSubsteps(float deltaTime);
+    // true, якщо ядро вже зібрало тіла в зоні знищення у kill
+    template <Integrator Method, bool Pull>
+    bool integrate(float deltaTime, float pullMass, KillList* kill);
+    void computeAccelerations(float pullMass);
+    void addExternalAccelerations(float gravitationalConstant, float softening);
+    // Колонізація подіями: крок обробляє лише кораблі, чий час прибуття настав.
+    // Вона йде паралельно з гравітацією і бачить тіла такими, якими вони були на початку кроку
+    void captureShipFrame();
+    void updateShips();
+    Vec2 shipViewPosition(std::size_t index) const;
+    Vec2 shipViewVelocity(std::size_t index) const;
+    // Після видалення: кораблі, запущені цього кроку до тіла, яке той самий крок знищив, обирають нову ціль
+    void retargetLostShips();
+    void arriveShip(std::uint32_t ship);
+    void dispatchShip(std::uint32_t ship, const Vec2& from);
+    void launchShip(std::uint32_t ship, const Vec2& from, std::size_t target);
+    // Черга виводиться з ShipPool (після завантаження знімка); idleShips знімок відновлює сам
+    void rebuildShipEvents();
+
+    int stepKey = -1;
+    StepFunction stepFunction = nullptr;
+    bool accelerationsValid = false;
+    GravityMode accelerationMode = GravityMode::BlackHoleOnly;
+    float accelerationPull = 0.0f;
+    bool targetsDirty = true;
+    KillList killList;
+    TaskGraph stepGraph;
+    std::vector<BodyMove> bodyMoves;
+    std::vector<std::uint32_t> reorderKeys;
+    std::vector<std::uint32_t> reorderOrder;
+    std::priority_queue<ShipEvent, std::vector<ShipEvent>, ShipEventLater> shipEvents;
+    std::vector<std::uint32_t> idleShips; // без цілі: вільних тіл не лишилось
+    bool retryIdleShips = false;
+
+    // Позиції й швидкості на початок кроку для колонізації, поки гравітація змінює сховище.
+    // Копіюються лише в кроки, де є прибуття або кораблі, що чекають
+    std::vector<float> shipFrameX;
+    std::vector<float> shipFrameY;
+    std::vector<float> shipFrameVelX;
+    std::vector<float> shipFrameVelY;
+    bool shipFrameActive = false;
+    std::vector<std::uint32_t> launchedShips; // запущені за цей крок
+};
+
+#endif
@@ -0,0 +1,553 @@
+﻿#include "Snapshot.hpp"
+#include "MappedFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+const char snapshotMagic[8] = { 'K', 'O', 'S', 'M', 'O', 'S', 'S', 'N' };
+const std::size_t sectionAlignment = 64;
+const std::uint32_t shipWords = 14;
+
+enum SectionId : std::uint32_t {
+    SectionPosX = 1,
+    SectionPosY,
+    SectionVelX,
+    SectionVelY,
+    SectionAccX,
+    SectionAccY,
+    SectionMass,
+    SectionRadius,
+    SectionIsColony,
+    SectionHasShip,
+    SectionIsTargeted,
+    SectionBodySlot,
+    SectionSlotIndex,
+    SectionSlotGeneration,
+    SectionFreeSlots,
+    SectionShips,
+    SectionIdleShips
+};
+
+struct Section {
+    std::uint32_t id;
+    std::uint32_t elementBytes;
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+bool hostIsLittleEndian() {
+    const std::uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+std::uint32_t floatBits(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(std::uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::uint64_t doubleBits(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsDouble(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<unsigned char>& out) : out(out) { out.clear(); }
+
+    void u8(std::uint8_t value) { out.push_back(value); }
+    void u32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+    void u64(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+    void f32(float value) { u32(floatBits(value)); }
+    void f64(double value) { u64(doubleBits(value)); }
+
+    void patch64(std::size_t at, std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) out[at + i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    void align(std::size_t alignment) {
+        while (out.size() % alignment != 0) out.push_back(0);
+    }
+    std::size_t position() const { return out.size(); }
+
+    // Масив 1- або 4-байтових значень: на little-endian машині просто копія пам'яті
+    template <class T>
+    void array(const T* data, std::size_t count) {
+        if (sizeof(T) == 1 || hostIsLittleEndian()) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+            out.insert(out.end(), bytes, bytes + count * sizeof(T));
+            return;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            u32(word);
+        }
+    }
+
+private:
+    std::vector<unsigned char>& out;
+};
+
+class ByteReader {
+public:
+    ByteReader(const unsigned char* data, std::size_t size) : data(data), size(size) {}
+
+    std::uint8_t u8() {
+        if (!take(1)) return 0;
+        return data[position - 1];
+    }
+    std::uint32_t u32() {
+        if (!take(4)) return 0;
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= static_cast<std::uint32_t>(data[position - 4 + i]) << (8 * i);
+        return value;
+    }
+    std::uint64_t u64() {
+        if (!take(8)) return 0;
+        std::uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) value |= static_cast<std::uint64_t>(data[position - 8 + i]) << (8 * i);
+        return value;
+    }
+    float f32() { return bitsFloat(u32()); }
+    double f64() { return bitsDouble(u64()); }
+    void bytes(void* out, std::size_t count) {
+        if (take(count)) std::memcpy(out, data + position - count, count);
+    }
+
+    bool ok = true;
+
+private:
+    bool take(std::size_t count) {
+        if (!ok || count > size - position) {
+            ok = false;
+            return false;
+        }
+        position += count;
+        return true;
+    }
+
+    const unsigned char* data;
+    std::size_t size;
+    std::size_t position = 0;
+};
+
+const Section* findSection(const std::vector<Section>& sections, std::uint32_t id) {
+    for (const Section& section : sections) {
+        if (section.id == id) return &section;
+    }
+    return nullptr;
+}
+
+template <class T>
+bool readArray(const unsigned char* data, std::size_t size, const std::vector<Section>& sections, std::uint32_t id,
+               std::uint64_t expectedCount, std::vector<T>& out) {
+    const Section* section = findSection(sections, id);
+    if (!section || section->elementBytes != sizeof(T) || section->count != expectedCount) return false;
+    if (section->offset > size || section->count > (size - section->offset) / sizeof(T)) return false;
+
+    const std::size_t count = static_cast<std::size_t>(section->count);
+    out.resize(count);
+    if (count == 0) return true;
+    const unsigned char* source = data + section->offset;
+    if (sizeof(T) == 1 || hostIsLittleEndian()) {
+        std::memcpy(out.data(), source, count * sizeof(T));
+        return true;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const unsigned char* word = source + 4 * i;
+        std::uint32_t value = word[0] | (word[1] << 8) | (word[2] << 16) | (static_cast<std::uint32_t>(word[3]) << 24);
+        std::memcpy(&out[i], &value, sizeof(value));
+    }
+    return true;
+}
+
+bool writeFileAtomically(const std::string& path, const std::vector<unsigned char>& bytes) {
+    // Спершу тимчасовий файл, потім заміна: обрив запису не псує попередню точку
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    // Заміна атомарна: у будь-який момент на місці path лежить стара або нова точка
+#ifdef _WIN32
+    return MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+#endif
+}
+
+}
+
+void writeSnapshot(const Simulation& simulation, float fixedStep, std::vector<unsigned char>& out) {
+    const MatterStore& matters = simulation.matters;
+    const std::size_t bodies = matters.size();
+
+    // Черга подій не зберігається: вона однозначно виводиться з часів прибуття
+    const ShipPool& pool = simulation.ships;
+    std::vector<std::uint32_t> ships;
+    ships.reserve(pool.size() * shipWords);
+    for (std::size_t s = 0; s < pool.size(); ++s) {
+        const std::uint64_t launch = doubleBits(pool.launchTime[s]);
+        const std::uint64_t arrival = doubleBits(pool.arrivalTime[s]);
+        const std::uint32_t words[shipWords] = {
+            floatBits(pool.originX[s]), floatBits(pool.originY[s]),
+            static_cast<std::uint32_t>(launch), static_cast<std::uint32_t>(launch >> 32),
+            floatBits(pool.aimX[s]), floatBits(pool.aimY[s]),
+            static_cast<std::uint32_t>(arrival), static_cast<std::uint32_t>(arrival >> 32),
+            pool.target[s].slot, pool.target[s].generation,
+            pool.home[s].slot, pool.home[s].generation,
+            floatBits(pool.homeX[s]), floatBits(pool.homeY[s])
+        };
+        ships.insert(ships.end(), words, words + shipWords);
+    }
+
+    struct Source {
+        std::uint32_t id;
+        std::uint32_t elementBytes;
+        const void* data;
+        std::uint64_t count;
+        bool bytes; // однобайтові елементи
+    };
+    const Source sources[] = {
+        { SectionPosX, 4, matters.posX.data(), bodies, false },
+        { SectionPosY, 4, matters.posY.data(), bodies, false },
+        { SectionVelX, 4, matters.velX.data(), bodies, false },
+        { SectionVelY, 4, matters.velY.data(), bodies, false },
+        { SectionAccX, 4, matters.accX.data(), bodies, false },
+        { SectionAccY, 4, matters.accY.data(), bodies, false },
+        { SectionMass, 4, matters.mass.data(), bodies, false },
+        { SectionRadius, 4, matters.radius.data(), bodies, false },
+        { SectionIsColony, 1, matters.isColony.data(), bodies, true },
+        { SectionHasShip, 1, matters.hasShip.data(), bodies, true },
+        { SectionIsTargeted, 1, matters.isTargeted.data(), bodies, true },
+        { SectionBodySlot, 4, matters.bodySlot.data(), bodies, false },
+        { SectionSlotIndex, 4, matters.slotIndices().data(), matters.slotIndices().size(), false },
+        { SectionSlotGeneration, 4, matters.slotGenerations().data(), matters.slotGenerations().size(), false },
+        { SectionFreeSlots, 4, matters.freeSlotList().data(), matters.freeSlotList().size(), false },
+        { SectionShips, 4 * shipWords, ships.data(), simulation.ships.size(), false },
+        { SectionIdleShips, 4, simulation.idleShips.data(), simulation.idleShips.size(), false }
+    };
+    const std::uint32_t sectionCount = static_cast<std::uint32_t>(sizeof(sources) / sizeof(sources[0]));
+
+    out.reserve(1024 + bodies * MatterStore::bytesPerBody() + ships.size() * 4 + sectionCount * sectionAlignment);
+    ByteWriter writer(out);
+
+    const GravitySolver& gravity = simulation.gravity;
+    writer.array(snapshotMagic, sizeof(snapshotMagic));
+    writer.u32(snapshotVersion);
+    std::size_t fileBytesAt = writer.position();
+    writer.u64(0);
+    writer.u64(bodies);
+    writer.u64(simulation.ships.size());
+    writer.u64(simulation.tick);
+    writer.u64(simulation.layoutVersion);
+    writer.f64(simulation.time);
+    writer.f32(fixedStep);
+    writer.f32(simulation.blackHolePosition.x);
+    writer.f32(simulation.blackHolePosition.y);
+    writer.f32(simulation.blackHoleMass);
+    writer.f32(simulation.deletionRadius);
+    writer.f32(simulation.gravityMultiplier);
+    writer.f32(gravity.tree.openingAngle);
+    writer.f32(gravity.tree.softening);
+    writer.f32(gravity.tree.gravitationalConstant);
+    writer.f32(gravity.mesh.softening);
+    writer.f32(gravity.mesh.gravitationalConstant);
+    writer.u32(static_cast<std::uint32_t>(gravity.mesh.resolution));
+    writer.f32(simulation.collisions.restitution);
+    writer.f32(simulation.collisions.grid.cellSize);
+    writer.f32(simulation.targets.cellSize);
+    writer.f32(pool.speed);
+    writer.f32(pool.radius);
+    writer.f32(simulation.accelerationPull);
+    writer.f32(simulation.timestepAccuracy);
+    writer.u32(static_cast<std::uint32_t>(simulation.substeps));
+    writer.u32(static_cast<std::uint32_t>(simulation.maxRung));
+    writer.u32(static_cast<std::uint32_t>(simulation.reorderInterval));
+    writer.u8(simulation.blackHoleActive);
+    writer.u8(simulation.blackHolePaused);
+    writer.u8(simulation.collisionHandlingActive);
+    writer.u8(simulation.colonizationActive);
+    writer.u8(static_cast<std::uint8_t>(simulation.integrator));
+    writer.u8(static_cast<std::uint8_t>(gravity.mode));
+    writer.u8(static_cast<std::uint8_t>(gravity.kernel));
+    writer.u8(simulation.accelerationsValid);
+    writer.u8(static_cast<std::uint8_t>(simulation.accelerationMode));
+    writer.u8(simulation.blockTimesteps);
+    writer.u8(simulation.retryIdleShips);
+
+    writer.u32(sectionCount);
+    std::size_t offsetsAt[sizeof(sources) / sizeof(sources[0])];
+    for (std::uint32_t s = 0; s < sectionCount; ++s) {
+        writer.u32(sources[s].id);
+        writer.u32(sources[s].elementBytes);
+        offsetsAt[s] = writer.position();
+        writer.u64(0);
+        writer.u64(sources[s].count);
+    }
+
+    for (std::uint32_t s = 0; s < sectionCount; ++s) {
+        writer.align(sectionAlignment);
+        writer.patch64(offsetsAt[s], writer.position());
+        std::size_t elements = static_cast<std::size_t>(sources[s].count) * sources[s].elementBytes / (sources[s].bytes ? 1 : 4);
+        if (sources[s].bytes) {
+            writer.array(static_cast<const std::uint8_t*>(sources[s].data), elements);
+        }
+        else {
+            writer.array(static_cast<const std::uint32_t*>(sources[s].data), elements);
+        }
+    }
+
+    writer.patch64(fileBytesAt, writer.position());
+}
+
+bool readSnapshot(const unsigned char* data, std::size_t size, Simulation& simulation, float* fixedStep) {
+    ByteReader reader(data, size);
+
+    char magic[sizeof(snapshotMagic)];
+    reader.bytes(magic, sizeof(magic));
+    if (!reader.ok || std::memcmp(magic, snapshotMagic, sizeof(magic)) != 0) return false;
+    if (reader.u32() != snapshotVersion) return false;
+    if (reader.u64() != size) return false; // обрізаний або дописаний файл
+
+    const std::uint64_t bodies = reader.u64();
+    const std::uint64_t shipCount = reader.u64();
+    const std::uint64_t tick = reader.u64();
+    const std::uint64_t layoutVersion = reader.u64();
+    const double time = reader.f64();
+    const float step = reader.f32();
+    const float holeX = reader.f32();
+    const float holeY = reader.f32();
+    const float holeMass = reader.f32();
+    const float deletionRadius = reader.f32();
+    const float gravityMultiplier = reader.f32();
+    const float openingAngle = reader.f32();
+    const float softening = reader.f32();
+    const float gravitationalConstant = reader.f32();
+    const float meshSoftening = reader.f32();
+    const float meshConstant = reader.f32();
+    const std::uint32_t meshResolution = reader.u32();
+    const float restitution = reader.f32();
+    const float collisionCellSize = reader.f32();
+    const float targetCellSize = reader.f32();
+    const float shipSpeed = reader.f32();
+    const float shipRadius = reader.f32();
+    const float accelerationPull = reader.f32();
+    const float timestepAccuracy = reader.f32();
+    const std::uint32_t substeps = reader.u32();
+    const std::uint32_t maxRung = reader.u32();
+    const std::uint32_t reorderInterval = reader.u32();
+    const std::uint8_t blackHoleActive = reader.u8();
+    const std::uint8_t blackHolePaused = reader.u8();
+    const std::uint8_t collisionHandlingActive = reader.u8();
+    const std::uint8_t colonizationActive = reader.u8();
+    const std::uint8_t integrator = reader.u8();
+    const std::uint8_t gravityMode = reader.u8();
+    const std::uint8_t kernel = reader.u8();
+    const std::uint8_t accelerationsValid = reader.u8();
+    const std::uint8_t accelerationMode = reader.u8();
+    const std::uint8_t blockTimesteps = reader.u8();
+    const std::uint8_t retryIdleShips = reader.u8();
+
+    const std::uint32_t sectionCount = reader.u32();
+    if (!reader.ok || sectionCount > 1024) return false;
+    std::vector<Section> sections(sectionCount);
+    for (Section& section : sections) {
+        section.id = reader.u32();
+        section.elementBytes = reader.u32();
+        section.offset = reader.u64();
+        section.count = reader.u64();
+    }
+    if (!reader.ok) return false;
+    if (integrator > static_cast<std::uint8_t>(Integrator::Leapfrog) || gravityMode > static_cast<std::uint8_t>(GravityMode::ParticleMesh)
+        || accelerationMode > static_cast<std::uint8_t>(GravityMode::ParticleMesh) || kernel > static_cast<std::uint8_t>(KernelIsa::Avx512)
+        || maxRung > 20 || reorderInterval > 0x7FFFFFFFu) {
+        return false;
+    }
+
+    MatterStore matters;
+    std::vector<std::uint32_t> slotIndex;
+    std::vector<std::uint32_t> slotGeneration;
+    std::vector<std::uint32_t> freeSlots;
+    std::vector<std::uint32_t> ships;
+
+    const Section* slotSection = findSection(sections, SectionSlotIndex);
+    const Section* freeSection = findSection(sections, SectionFreeSlots);
+    if (!slotSection || !freeSection) return false;
+
+    bool loaded = readArray(data, size, sections, SectionPosX, bodies, matters.posX)
+        && readArray(data, size, sections, SectionPosY, bodies, matters.posY)
+        && readArray(data, size, sections, SectionVelX, bodies, matters.velX)
+        && readArray(data, size, sections, SectionVelY, bodies, matters.velY)
+        && readArray(data, size, sections, SectionAccX, bodies, matters.accX)
+        && readArray(data, size, sections, SectionAccY, bodies, matters.accY)
+        && readArray(data, size, sections, SectionMass, bodies, matters.mass)
+        && readArray(data, size, sections, SectionRadius, bodies, matters.radius)
+        && readArray(data, size, sections, SectionIsColony, bodies, matters.isColony)
+        && readArray(data, size, sections, SectionHasShip, bodies, matters.hasShip)
+        && readArray(data, size, sections, SectionIsTargeted, bodies, matters.isTargeted)
+        && readArray(data, size, sections, SectionBodySlot, bodies, matters.bodySlot)
+        && readArray(data, size, sections, SectionSlotIndex, slotSection->count, slotIndex)
+        && readArray(data, size, sections, SectionSlotGeneration, slotSection->count, slotGeneration)
+        && readArray(data, size, sections, SectionFreeSlots, freeSection->count, freeSlots);
+    if (!loaded) return false;
+
+    // Дескриптори мусять вести туди ж, звідки їх видали
+    for (std::size_t i = 0; i < matters.size(); ++i) {
+        std::uint32_t slot = matters.bodySlot[i];
+        if (slot >= slotIndex.size() || slotIndex[slot] != i) return false;
+    }
+    for (std::uint32_t slot : freeSlots) {
+        if (slot >= slotIndex.size()) return false;
+    }
+
+    const Section* shipSection = findSection(sections, SectionShips);
+    if (!shipSection || shipSection->elementBytes != 4 * shipWords || shipSection->count != shipCount) return false;
+    std::vector<Section> shipWordsSection(1, *shipSection);
+    shipWordsSection[0].elementBytes = 4;
+    shipWordsSection[0].count = shipCount * shipWords;
+    if (!readArray(data, size, shipWordsSection, SectionShips, shipCount * shipWords, ships)) return false;
+
+    // Кораблі без цілі - у порядку, в якому вони стали чекати: від нього залежить, хто першим візьме тіло
+    const Section* idleSection = findSection(sections, SectionIdleShips);
+    std::vector<std::uint32_t> idleShips;
+    if (!idleSection || !readArray(data, size, sections, SectionIdleShips, idleSection->count, idleShips)) return false;
+    std::vector<std::uint8_t> idle(static_cast<std::size_t>(shipCount), 0);
+    for (std::uint32_t ship : idleShips) {
+        if (ship >= shipCount || idle[ship]) return false;
+        idle[ship] = 1;
+    }
+    for (std::size_t s = 0; s < shipCount; ++s) {
+        const bool targeted = ships[s * shipWords + 8] != noBody.slot;
+        if (targeted == (idle[s] != 0)) return false;
+    }
+
+    matters.restoreSlots(std::move(slotIndex), std::move(slotGeneration), std::move(freeSlots));
+    simulation.matters = std::move(matters);
+
+    ShipPool& pool = simulation.ships;
+    pool.resize(static_cast<std::size_t>(shipCount));
+    for (std::size_t s = 0; s < shipCount; ++s) {
+        const std::uint32_t* words = ships.data() + s * shipWords;
+        pool.originX[s] = bitsFloat(words[0]);
+        pool.originY[s] = bitsFloat(words[1]);
+        pool.launchTime[s] = bitsDouble(words[2] | static_cast<std::uint64_t>(words[3]) << 32);
+        pool.aimX[s] = bitsFloat(words[4]);
+        pool.aimY[s] = bitsFloat(words[5]);
+        pool.arrivalTime[s] = bitsDouble(words[6] | static_cast<std::uint64_t>(words[7]) << 32);
+        pool.target[s].slot = words[8];
+        pool.target[s].generation = words[9];
+        pool.home[s].slot = words[10];
+        pool.home[s].generation = words[11];
+        pool.homeX[s] = bitsFloat(words[12]);
+        pool.homeY[s] = bitsFloat(words[13]);
+    }
+    pool.speed = shipSpeed;
+    pool.radius = shipRadius;
+    simulation.rebuildShipEvents();
+    simulation.idleShips = std::move(idleShips);
+    simulation.retryIdleShips = retryIdleShips != 0;
+
+    simulation.tick = tick;
+    simulation.time = time;
+    simulation.layoutVersion = layoutVersion;
+    simulation.blackHolePosition = Vec2(holeX, holeY);
+    simulation.blackHoleMass = holeMass;
+    simulation.deletionRadius = deletionRadius;
+    simulation.gravityMultiplier = gravityMultiplier;
+    simulation.gravity.tree.openingAngle = openingAngle;
+    simulation.gravity.tree.softening = softening;
+    simulation.gravity.tree.gravitationalConstant = gravitationalConstant;
+    simulation.gravity.mesh.softening = meshSoftening;
+    simulation.gravity.mesh.gravitationalConstant = meshConstant;
+    simulation.gravity.mesh.resolution = static_cast<int>(meshResolution);
+    simulation.collisions.restitution = restitution;
+    simulation.collisions.grid.cellSize = collisionCellSize;
+    simulation.targets.cellSize = targetCellSize;
+    simulation.substeps = static_cast<int>(substeps);
+    simulation.blockTimesteps = blockTimesteps != 0;
+    simulation.timestepAccuracy = timestepAccuracy;
+    simulation.maxRung = static_cast<int>(maxRung);
+    simulation.reorderInterval = static_cast<int>(reorderInterval);
+    simulation.blackHoleActive = blackHoleActive != 0;
+    simulation.blackHolePaused = blackHolePaused != 0;
+    simulation.collisionHandlingActive = collisionHandlingActive != 0;
+    simulation.colonizationActive = colonizationActive != 0;
+    simulation.integrator = static_cast<Integrator>(integrator);
+    simulation.gravity.mode = static_cast<GravityMode>(gravityMode);
+    simulation.gravity.kernel = static_cast<KernelIsa>(kernel);
+
+    simulation.accelerationsValid = accelerationsValid != 0;
+    simulation.accelerationMode = static_cast<GravityMode>(accelerationMode);
+    simulation.accelerationPull = accelerationPull;
+    simulation.targetsDirty = true;
+
+    if (fixedStep) *fixedStep = step;
+    return true;
+}
+
+bool saveSnapshot(const std::string& path, const Simulation& simulation, float fixedStep) {
+    std::vector<unsigned char> bytes;
+    writeSnapshot(simulation, fixedStep, bytes);
+    return writeFileAtomically(path, bytes);
+}
+
+bool loadSnapshot(const std::string& path, Simulation& simulation, float* fixedStep) {
+    MappedFile file;
+    if (!file.open(path.c_str())) return false;
+    return readSnapshot(file.data(), file.size(), simulation, fixedStep);
+}
+
+Checkpointer::~Checkpointer() {
+    wait();
+}
+
+bool Checkpointer::request(const Simulation& simulation, float fixedStep, const std::string& path) {
+    if (writing.load()) return false;
+    if (worker.joinable()) worker.join();
+
+    writeSnapshot(simulation, fixedStep, buffer);
+    target = path;
+    writing.store(true);
+    worker = std::thread([this]() {
+        lastResult.store(writeFileAtomically(target, buffer));
+        completed.fetch_add(1);
+        writing.store(false);
+    });
+    return true;
+}
+
+void Checkpointer::wait() {
+    if (worker.joinable()) worker.join();
+}
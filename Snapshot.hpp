@@ -0,0 +1,54 @@
+﻿#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Simulation.hpp"
+
+// Двійковий знімок стану симуляції (little-endian, з версією).
+// Заголовок із параметрами, таблиця секцій, далі масиви тіл як є, кожен вирівняний на 64 байти.
+// Завантаження відображає файл у пам'ять і копіює масиви блоками, без розбору по тілах.
+// Зберігається все, що впливає на наступні кроки, тож продовження з файла побітово збігається
+// з прогоном без зупинки (за тих самих кроку, ядра й кількості підкроків).
+
+const std::uint32_t snapshotVersion = 6;
+
+// fixedStep - крок, з яким іде прогін; повертається при завантаженні
+void writeSnapshot(const Simulation& simulation, float fixedStep, std::vector<unsigned char>& out);
+bool readSnapshot(const unsigned char* data, std::size_t size, Simulation& simulation, float* fixedStep = nullptr);
+
+bool saveSnapshot(const std::string& path, const Simulation& simulation, float fixedStep);
+bool loadSnapshot(const std::string& path, Simulation& simulation, float* fixedStep = nullptr);
+
+// Фонові контрольні точки: стан копіюється в буфер у потоці симуляції (лише memcpy масивів),
+// а запис на диск іде в окремому потоці. Файл замінюється атомарно через тимчасовий.
+class Checkpointer {
+public:
+    Checkpointer() {}
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // false, якщо попередня точка ще пишеться (нова тоді пропускається)
+    bool request(const Simulation& simulation, float fixedStep, const std::string& path);
+    void wait();
+
+    bool busy() const { return writing.load(); }
+    std::uint64_t written() const { return completed.load(); }
+    bool lastSucceeded() const { return lastResult.load(); }
+
+private:
+    std::thread worker;
+    std::vector<unsigned char> buffer;
+    std::string target;
+    std::atomic<bool> writing{ false };
+    std::atomic<bool> lastResult{ true };
+    std::atomic<std::uint64_t> completed{ 0 };
+};
+
+#endif
@@ -0,0 +1,218 @@
+﻿#include "SoftwareRenderer.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const std::uint32_t offscreen = 0xFFFFFFFFu;
+const std::size_t binChunk = 65536;
+const float pi = 3.14159265358979f;
+
+struct Rgb {
+    float r, g, b;
+};
+
+const Rgb bodyColor = { 255.0f, 255.0f, 255.0f };
+const Rgb colonyColor = { 0.0f, 255.0f, 0.0f };
+const Rgb shipColor = { 0.0f, 0.0f, 255.0f };
+const Rgb blackHoleColor = { 255.0f, 0.0f, 0.0f };
+
+// Змішування як у вікні (альфа-змішування поверх): pixel += (color - pixel) * alpha
+inline void blend(std::uint8_t* pixel, const Rgb& color, float alpha) {
+    pixel[0] = static_cast<std::uint8_t>(pixel[0] + (color.r - pixel[0]) * alpha + 0.5f);
+    pixel[1] = static_cast<std::uint8_t>(pixel[1] + (color.g - pixel[1]) * alpha + 0.5f);
+    pixel[2] = static_cast<std::uint8_t>(pixel[2] + (color.b - pixel[2]) * alpha + 0.5f);
+}
+
+// Коло з м'яким краєм завширшки в піксель, обрізане прямокутником [x0, x1) x [y0, y1).
+// Тіло, менше за піксель, лягає в один піксель з непрозорістю за площею
+void drawDisc(std::uint8_t* rgb, int width, int x0, int y0, int x1, int y1, float cx, float cy, float r, const Rgb& color) {
+    if (r < 0.7f) {
+        const int px = static_cast<int>(std::floor(cx));
+        const int py = static_cast<int>(std::floor(cy));
+        if (px < x0 || px >= x1 || py < y0 || py >= y1) return;
+        blend(rgb + (static_cast<std::size_t>(py) * width + px) * 3, color, std::min(pi * r * r, 1.0f));
+        return;
+    }
+
+    const int left = std::max(x0, static_cast<int>(std::floor(cx - r - 0.5f)));
+    const int right = std::min(x1, static_cast<int>(std::ceil(cx + r + 0.5f)));
+    const int top = std::max(y0, static_cast<int>(std::floor(cy - r - 0.5f)));
+    const int bottom = std::min(y1, static_cast<int>(std::ceil(cy + r + 0.5f)));
+    for (int y = top; y < bottom; ++y) {
+        const float dy = y + 0.5f - cy;
+        std::uint8_t* row = rgb + static_cast<std::size_t>(y) * width * 3;
+        for (int x = left; x < right; ++x) {
+            const float dx = x + 0.5f - cx;
+            const float coverage = r + 0.5f - std::sqrt(dx * dx + dy * dy);
+            if (coverage <= 0.0f) continue;
+            blend(row + x * 3, color, std::min(coverage, 1.0f));
+        }
+    }
+}
+
+}
+
+void RenderFrame::capture(const Simulation& simulation, float holeRadius) {
+    const MatterStore& matters = simulation.matters;
+    posX.assign(matters.posX.begin(), matters.posX.end());
+    posY.assign(matters.posY.begin(), matters.posY.end());
+    radius.assign(matters.radius.begin(), matters.radius.end());
+    isColony.assign(matters.isColony.begin(), matters.isColony.end());
+    simulation.ships.positionsAt(simulation.time, ships);
+    shipRadius = simulation.ships.radius;
+    blackHolePosition = simulation.blackHolePosition;
+    blackHoleRadius = holeRadius;
+    blackHoleActive = simulation.blackHoleActive;
+}
+
+SoftwareRenderer::SoftwareRenderer(int width, int height)
+    : frameWidth(std::max(width, 1)), frameHeight(std::max(height, 1)),
+      rgb(static_cast<std::size_t>(frameWidth) * frameHeight * 3, 0) {
+}
+
+void SoftwareRenderer::binBodies(const RenderFrame& frame, const RenderView& view) {
+    // Кораблі йдуть тими ж кошиками після тіл (індекси від bodies), тож малюються поверх них
+    const std::size_t bodies = frame.posX.size();
+    const std::size_t total = bodies + frame.ships.size();
+    const std::size_t tiles = static_cast<std::size_t>(tilesX) * tilesY;
+    const std::size_t chunks = (total + binChunk - 1) / binChunk;
+    const float scaleX = frameWidth / view.width;
+    const float scaleY = frameHeight / view.height;
+    const float tile = static_cast<float>(tileSize);
+
+    bodyTile.resize(total);
+    chunkCounts.assign(chunks * tiles, 0);
+    std::vector<float> chunkRadius(chunks, 0.0f);
+    JobSystem& jobs = JobSystem::instance();
+
+    jobs.parallelFor(total, binChunk, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::uint32_t* counts = chunkCounts.data() + chunk * tiles;
+        float maxRadius = 0.0f;
+        for (std::size_t i = begin; i < end; ++i) {
+            const bool ship = i >= bodies;
+            const float r = (ship ? frame.shipRadius : frame.radius[i]) * scaleX;
+            const float x = ship ? frame.ships[i - bodies].x + frame.shipRadius : frame.posX[i];
+            const float y = ship ? frame.ships[i - bodies].y + frame.shipRadius : frame.posY[i];
+            const float cx = (x - view.left) * scaleX;
+            const float cy = (y - view.top) * scaleY;
+            if (cx + r + 1.0f < 0.0f || cy + r + 1.0f < 0.0f || cx - r - 1.0f >= frameWidth || cy - r - 1.0f >= frameHeight) {
+                bodyTile[i] = offscreen;
+                continue;
+            }
+            // Центр за кадром, а край у ньому: плитка краю, звідки коло дістане сусідні
+            const int column = std::min(std::max(static_cast<int>(cx / tile), 0), tilesX - 1);
+            const int row = std::min(std::max(static_cast<int>(cy / tile), 0), tilesY - 1);
+            const std::uint32_t index = static_cast<std::uint32_t>(row * tilesX + column);
+            bodyTile[i] = index;
+            ++counts[index];
+            maxRadius = std::max(maxRadius, r);
+        }
+        chunkRadius[chunk] = maxRadius;
+    });
+
+    float maxRadius = 0.0f;
+    for (float r : chunkRadius) maxRadius = std::max(maxRadius, r);
+    reach = std::max(1, static_cast<int>(std::ceil((maxRadius + 1.0f) / tile)));
+
+    // Зсуви: плитка за плиткою, усередині - шматки за порядком, тож тіла в кошику йдуть за індексом
+    tileStart.resize(tiles + 1);
+    std::uint32_t offset = 0;
+    for (std::size_t t = 0; t < tiles; ++t) {
+        tileStart[t] = offset;
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            const std::uint32_t count = chunkCounts[chunk * tiles + t];
+            chunkCounts[chunk * tiles + t] = offset;
+            offset += count;
+        }
+    }
+    tileStart[tiles] = offset;
+    binned.resize(offset);
+
+    jobs.parallelFor(total, binChunk, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::uint32_t* offsets = chunkCounts.data() + chunk * tiles;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (bodyTile[i] != offscreen) binned[offsets[bodyTile[i]]++] = static_cast<std::uint32_t>(i);
+        }
+    });
+}
+
+void SoftwareRenderer::drawTile(int tile, const RenderFrame& frame, const RenderView& view) {
+    const int column = tile % tilesX;
+    const int row = tile / tilesX;
+    const int x0 = column * tileSize;
+    const int y0 = row * tileSize;
+    const int x1 = std::min(x0 + tileSize, frameWidth);
+    const int y1 = std::min(y0 + tileSize, frameHeight);
+    const float scaleX = frameWidth / view.width;
+    const float scaleY = frameHeight / view.height;
+    std::uint8_t* pixels = rgb.data();
+
+    for (int y = y0; y < y1; ++y) {
+        std::fill(pixels + (static_cast<std::size_t>(y) * frameWidth + x0) * 3, pixels + (static_cast<std::size_t>(y) * frameWidth + x1) * 3, 0);
+    }
+
+    if (frame.blackHoleActive) {
+        drawDisc(pixels, frameWidth, x0, y0, x1, y1, (frame.blackHolePosition.x - view.left) * scaleX,
+                 (frame.blackHolePosition.y - view.top) * scaleY, frame.blackHoleRadius * scaleX, blackHoleColor);
+    }
+
+    // Кошики сусідніх плиток відсортовані за індексом (тіла, за ними кораблі), тож злиття купою
+    // дає той самий порядок, що й у вікні: перекриті тіла змішуються однаково на будь-якій плитці
+    struct Cursor {
+        const std::uint32_t* next;
+        const std::uint32_t* end;
+    };
+    const auto later = [](const Cursor& a, const Cursor& b) { return *a.next > *b.next; };
+    std::vector<Cursor> cursors;
+    const int rowBegin = std::max(row - reach, 0);
+    const int rowEnd = std::min(row + reach, tilesY - 1);
+    const int columnBegin = std::max(column - reach, 0);
+    const int columnEnd = std::min(column + reach, tilesX - 1);
+    for (int r = rowBegin; r <= rowEnd; ++r) {
+        for (int c = columnBegin; c <= columnEnd; ++c) {
+            const int bin = r * tilesX + c;
+            if (tileStart[bin] != tileStart[bin + 1]) {
+                cursors.push_back(Cursor{ binned.data() + tileStart[bin], binned.data() + tileStart[bin + 1] });
+            }
+        }
+    }
+    std::make_heap(cursors.begin(), cursors.end(), later);
+
+    const std::uint32_t bodies = static_cast<std::uint32_t>(frame.posX.size());
+    while (!cursors.empty()) {
+        std::pop_heap(cursors.begin(), cursors.end(), later);
+        Cursor& cursor = cursors.back();
+        const std::uint32_t i = *cursor.next++;
+        if (i < bodies) {
+            drawDisc(pixels, frameWidth, x0, y0, x1, y1, (frame.posX[i] - view.left) * scaleX, (frame.posY[i] - view.top) * scaleY,
+                     frame.radius[i] * scaleX, frame.isColony[i] ? colonyColor : bodyColor);
+        }
+        else {
+            const Vec2& ship = frame.ships[i - bodies];
+            drawDisc(pixels, frameWidth, x0, y0, x1, y1, (ship.x + frame.shipRadius - view.left) * scaleX,
+                     (ship.y + frame.shipRadius - view.top) * scaleY, frame.shipRadius * scaleX, shipColor);
+        }
+        if (cursor.next == cursor.end) cursors.pop_back();
+        else std::push_heap(cursors.begin(), cursors.end(), later);
+    }
+}
+
+void SoftwareRenderer::render(const RenderFrame& frame, const RenderView& view) {
+    KOSMOS_PROFILE_SCOPE("software render");
+    tilesX = (frameWidth + tileSize - 1) / tileSize;
+    tilesY = (frameHeight + tileSize - 1) / tileSize;
+    {
+        KOSMOS_PROFILE_SCOPE("render binning");
+        binBodies(frame, view);
+    }
+    const std::size_t tiles = static_cast<std::size_t>(tilesX) * tilesY;
+    JobSystem::instance().parallelFor(tiles, 1, [&](std::size_t, std::size_t begin, std::size_t end) {
+        KOSMOS_PROFILE_SCOPE("render tile");
+        for (std::size_t tile = begin; tile < end; ++tile) {
+            drawTile(static_cast<int>(tile), frame, view);
+        }
+    });
+}
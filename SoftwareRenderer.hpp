@@ -0,0 +1,69 @@
+﻿#ifndef SOFTWARE_RENDERER_HPP
+#define SOFTWARE_RENDERER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Simulation.hpp"
+
+// Рендер без GPU і дисплея: кола тіл, кораблі й чорна діра розтеризуються в кадр RGB у пам'яті.
+// Кадр ділиться на плитки tileSize x tileSize; тіла спершу розкладаються по плитках свого центру
+// (сортування підрахунком, порядок тіл усередині плитки зберігається), потім плитки малюються
+// паралельно на пулі JobSystem - кожна пише лише свої пікселі, тож блокувань немає.
+// Кольори й порядок як у вікні: чорне тло, червона діра, білі тіла, зелені колонії, сині кораблі.
+
+// Копія стану для кадру: рендер іде паралельно з наступними кроками симуляції
+struct RenderFrame {
+    std::vector<float> posX;
+    std::vector<float> posY;
+    std::vector<float> radius;
+    std::vector<std::uint8_t> isColony;
+    std::vector<Vec2> ships; // лівий верхній кут, як у sf::CircleShape
+    float shipRadius = 0.0f;
+    Vec2 blackHolePosition;
+    float blackHoleRadius = 0.0f;
+    bool blackHoleActive = false;
+
+    void capture(const Simulation& simulation, float blackHoleRadius);
+};
+
+// Прямокутник світу, що потрапляє в кадр
+struct RenderView {
+    float left = 0.0f;
+    float top = 0.0f;
+    float width = 1.0f;
+    float height = 1.0f;
+};
+
+class SoftwareRenderer {
+public:
+    SoftwareRenderer(int width, int height);
+
+    void render(const RenderFrame& frame, const RenderView& view);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    // RGB по 8 біт, рядок за рядком згори донизу
+    const std::vector<std::uint8_t>& pixels() const { return rgb; }
+
+    int tileSize = 64;
+
+private:
+    void binBodies(const RenderFrame& frame, const RenderView& view);
+    void drawTile(int tile, const RenderFrame& frame, const RenderView& view);
+
+    int frameWidth;
+    int frameHeight;
+    int tilesX = 0;
+    int tilesY = 0;
+    int reach = 1; // плиток навколо, з яких тіла ще можуть зачепити плитку
+    std::vector<std::uint8_t> rgb;
+
+    // Тіла за плитками: binned[tileStart[t] .. tileStart[t + 1])
+    std::vector<std::uint32_t> bodyTile;
+    std::vector<std::uint32_t> chunkCounts;
+    std::vector<std::uint32_t> tileStart;
+    std::vector<std::uint32_t> binned;
+};
+
+#endif
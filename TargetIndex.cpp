@@ -0,0 +1,255 @@
+﻿#include "TargetIndex.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int maxCells = 1 << 22;
+
+}
+
+std::uint32_t TargetIndex::cellFor(float x, float y) const {
+    float fx = std::floor((x - minX) / activeCellSize);
+    float fy = std::floor((y - minY) / activeCellSize);
+    // тіла за межами сітки лягають у крайні комірки
+    int cx = fx < 0.0f ? 0 : (fx >= columns ? columns - 1 : static_cast<int>(fx));
+    int cy = fy < 0.0f ? 0 : (fy >= rows ? rows - 1 : static_cast<int>(fy));
+    return static_cast<std::uint32_t>(cy * columns + cx);
+}
+
+void TargetIndex::insert(std::uint32_t index, std::uint32_t cell) {
+    cellOf[index] = cell;
+    slotOf[index] = static_cast<std::uint32_t>(cells[cell].size());
+    cells[cell].push_back(index);
+}
+
+void TargetIndex::detach(std::uint32_t index) {
+    std::vector<std::uint32_t>& cell = cells[cellOf[index]];
+    std::uint32_t slot = slotOf[index];
+    std::uint32_t last = cell.back();
+    cell[slot] = last;
+    slotOf[last] = slot;
+    cell.pop_back();
+    cellOf[index] = noCell;
+}
+
+void TargetIndex::rebuild(const MatterStore& matters, const float* posX, const float* posY) {
+    const std::size_t count = matters.size();
+    cellOf.assign(count, noCell);
+    slotOf.assign(count, 0);
+    pendingCell.assign(count, noCell);
+    indexedCount = 0;
+
+    typedef std::array<float, 4> Bounds; // min x, min y, max x, max y
+    const Bounds empty = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    JobSystem& jobs = JobSystem::instance();
+    const std::size_t grain = jobs.grainFor(count);
+    const Bounds bounds = jobs.parallelReduce(count, grain, empty, [&](std::size_t begin, std::size_t end, Bounds& partial) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (matters.isColony[i]) continue;
+            partial[0] = std::min(partial[0], posX[i]);
+            partial[1] = std::min(partial[1], posY[i]);
+            partial[2] = std::max(partial[2], posX[i]);
+            partial[3] = std::max(partial[3], posY[i]);
+        }
+    }, [](Bounds& result, const Bounds& partial) {
+        result = { std::min(result[0], partial[0]), std::min(result[1], partial[1]),
+                   std::max(result[2], partial[2]), std::max(result[3], partial[3]) };
+    });
+    const float lowX = bounds[0];
+    const float lowY = bounds[1];
+    const float highX = bounds[2];
+    const float highY = bounds[3];
+
+    if (lowX > highX) {
+        columns = rows = 0;
+        cells.clear();
+        return;
+    }
+
+    // Не даємо сітці розростись, якщо якесь тіло викинуло дуже далеко
+    float width = highX - lowX + 1.0f;
+    float height = highY - lowY + 1.0f;
+    activeCellSize = std::max(cellSize, std::sqrt(width * height / maxCells));
+    minX = lowX;
+    minY = lowY;
+    columns = static_cast<int>(width / activeCellSize) + 1;
+    rows = static_cast<int>(height / activeCellSize) + 1;
+
+    cells.resize(static_cast<std::size_t>(columns) * rows);
+    for (auto& cell : cells) cell.clear();
+
+    jobs.parallelFor(count, grain, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!matters.isColony[i]) pendingCell[i] = cellFor(posX[i], posY[i]);
+        }
+    });
+
+    for (std::size_t i = 0; i < count; ++i) {
+        if (pendingCell[i] == noCell) continue;
+        insert(static_cast<std::uint32_t>(i), pendingCell[i]);
+        ++indexedCount;
+    }
+}
+
+std::size_t TargetIndex::update(const MatterStore& matters, const float* posX, const float* posY) {
+    if (cellOf.size() != matters.size()) {
+        rebuild(matters, posX, posY);
+        return matters.size();
+    }
+
+    const std::size_t count = matters.size();
+    JobSystem& jobs = JobSystem::instance();
+    jobs.parallelFor(count, jobs.grainFor(count), [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            pendingCell[i] = noCell;
+            if (cellOf[i] == noCell) continue;
+            std::uint32_t cell = cellFor(posX[i], posY[i]);
+            if (cell != cellOf[i]) pendingCell[i] = cell;
+        }
+    });
+
+    std::size_t moved = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (pendingCell[i] == noCell) continue;
+        detach(static_cast<std::uint32_t>(i));
+        insert(static_cast<std::uint32_t>(i), pendingCell[i]);
+        ++moved;
+    }
+    return moved;
+}
+
+void TargetIndex::remove(std::size_t index) {
+    if (!contains(index)) return;
+    detach(static_cast<std::uint32_t>(index));
+    --indexedCount;
+}
+
+void TargetIndex::applyRemovals(const std::vector<BodyMove>& moves) {
+    if (moves.empty() || cellOf.empty()) return; // індекс ще не побудований
+    // Перше переміщення завжди бере останнє тіло; інший розмір означає, що індекс відстав - перебудуємо
+    if (moves.front().movedFrom + 1 != cellOf.size()) {
+        cellOf.clear();
+        return;
+    }
+
+    for (const BodyMove& move : moves) {
+        remove(move.removed);
+        if (move.movedFrom == move.removed) continue;
+
+        // Переїхале тіло лишається у своїй комірці, змінюється лише його індекс
+        const std::uint32_t cell = cellOf[move.movedFrom];
+        cellOf[move.removed] = cell;
+        if (cell != noCell) {
+            slotOf[move.removed] = slotOf[move.movedFrom];
+            cells[cell][slotOf[move.removed]] = move.removed;
+        }
+        cellOf[move.movedFrom] = noCell;
+    }
+
+    const std::size_t remaining = cellOf.size() - moves.size();
+    cellOf.resize(remaining);
+    slotOf.resize(remaining);
+    pendingCell.resize(remaining);
+}
+
+template <class Visitor>
+void TargetIndex::searchRings(const Vec2& position, Visitor&& visit) const {
+    if (indexedCount == 0) return;
+
+    std::uint32_t start = cellFor(position.x, position.y);
+    const int cx = static_cast<int>(start) % columns;
+    const int cy = static_cast<int>(start) / columns;
+    float limit = std::numeric_limits<float>::max();
+
+    auto visitCell = [&](int x, int y) {
+        if (x < 0 || x >= columns || y < 0 || y >= rows) return;
+        for (std::uint32_t index : cells[static_cast<std::size_t>(y) * columns + x]) {
+            limit = visit(index);
+        }
+    };
+
+    for (int r = 0; ; ++r) {
+        const int x0 = cx - r;
+        const int x1 = cx + r;
+        const int y0 = cy - r;
+        const int y1 = cy + r;
+
+        for (int x = x0; x <= x1; ++x) visitCell(x, y0);
+        if (y1 != y0) {
+            for (int x = x0; x <= x1; ++x) visitCell(x, y1);
+        }
+        for (int y = y0 + 1; y < y1; ++y) {
+            visitCell(x0, y);
+            if (x1 != x0) visitCell(x1, y);
+        }
+
+        // Нижня межа відстані до ще не переглянутих комірок
+        bool leftOpen = x0 > 0;
+        bool rightOpen = x1 < columns - 1;
+        bool topOpen = y0 > 0;
+        bool bottomOpen = y1 < rows - 1;
+        if (!leftOpen && !rightOpen && !topOpen && !bottomOpen) break;
+
+        float bound = std::numeric_limits<float>::max();
+        if (leftOpen) bound = std::min(bound, position.x - (minX + x0 * activeCellSize));
+        if (rightOpen) bound = std::min(bound, minX + (x1 + 1) * activeCellSize - position.x);
+        if (topOpen) bound = std::min(bound, position.y - (minY + y0 * activeCellSize));
+        if (bottomOpen) bound = std::min(bound, minY + (y1 + 1) * activeCellSize - position.y);
+        if (bound > 0.0f && bound * bound >= limit) break;
+    }
+}
+
+std::size_t TargetIndex::nearest(const Vec2& position, const MatterStore& matters, const float* posX, const float* posY, bool unclaimedOnly) const {
+    std::size_t best = noMatter;
+    float bestDistance = std::numeric_limits<float>::max();
+
+    searchRings(position, [&](std::uint32_t index) {
+        if (!unclaimedOnly || !matters.isTargeted[index]) {
+            float dx = posX[index] - position.x;
+            float dy = posY[index] - position.y;
+            float distance = dx * dx + dy * dy;
+            if (distance < bestDistance || (distance == bestDistance && index < best)) {
+                bestDistance = distance;
+                best = index;
+            }
+        }
+        return bestDistance;
+    });
+
+    return best;
+}
+
+void TargetIndex::kNearest(const Vec2& position, std::size_t k, const MatterStore& matters, bool unclaimedOnly, std::vector<std::uint32_t>& out) const {
+    out.clear();
+    if (k == 0) return;
+
+    // Максимальна купа за відстанню: на вершині найгірший з k кандидатів
+    std::vector<std::pair<float, std::uint32_t>> heap;
+    heap.reserve(k + 1);
+
+    searchRings(position, [&](std::uint32_t index) {
+        if (!unclaimedOnly || !matters.isTargeted[index]) {
+            float dx = matters.posX[index] - position.x;
+            float dy = matters.posY[index] - position.y;
+            std::pair<float, std::uint32_t> candidate(dx * dx + dy * dy, index);
+            if (heap.size() < k) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else if (candidate < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+        return heap.size() < k ? std::numeric_limits<float>::max() : heap.front().first;
+    });
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (const auto& entry : heap) out.push_back(entry.second);
+}
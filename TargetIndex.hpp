@@ -0,0 +1,64 @@
+﻿#ifndef TARGET_INDEX_HPP
+#define TARGET_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MatterStore.hpp"
+
+// Просторовий індекс неколонізованих тіл для пошуку цілей кораблів.
+// Щільна сітка великих комірок: тіла переносяться між комірками лише коли перетинають межу,
+// колонії видаляються з індексу, а пошук іде кільцями від комірки корабля.
+class TargetIndex {
+public:
+    explicit TargetIndex(float cellSize = 400.0f) : cellSize(cellSize) {}
+
+    // Повна перебудова (після видалення тіл, коли індекси зсуваються)
+    void rebuild(const MatterStore& matters) { rebuild(matters, matters.posX.data(), matters.posY.data()); }
+    // Інкрементальне оновлення: переносить лише тіла, що змінили комірку
+    std::size_t update(const MatterStore& matters) { return update(matters, matters.posX.data(), matters.posY.data()); }
+
+    // Те саме з позиціями не зі сховища (копія з початку кроку, поки гравітація змінює сховище);
+    // прапорці й кількість тіл беруться з matters
+    void rebuild(const MatterStore& matters, const float* posX, const float* posY);
+    std::size_t update(const MatterStore& matters, const float* posX, const float* posY);
+
+    void remove(std::size_t index);
+    // Повторює видалення swap-and-pop зі сховища: O(видалених), без перебудови
+    void applyRemovals(const std::vector<BodyMove>& moves);
+    bool contains(std::size_t index) const { return index < cellOf.size() && cellOf[index] != noCell; }
+    std::size_t size() const { return indexedCount; }
+
+    // Найближче тіло; unclaimedOnly - пропускати ті, на які вже летить корабель (isTargeted)
+    std::size_t nearest(const Vec2& position, const MatterStore& matters, bool unclaimedOnly) const {
+        return nearest(position, matters, matters.posX.data(), matters.posY.data(), unclaimedOnly);
+    }
+    std::size_t nearest(const Vec2& position, const MatterStore& matters, const float* posX, const float* posY, bool unclaimedOnly) const;
+    // До k найближчих тіл у порядку зростання відстані
+    void kNearest(const Vec2& position, std::size_t k, const MatterStore& matters, bool unclaimedOnly, std::vector<std::uint32_t>& out) const;
+
+    float cellSize;
+
+private:
+    static constexpr std::uint32_t noCell = 0xFFFFFFFFu;
+
+    std::uint32_t cellFor(float x, float y) const;
+    void insert(std::uint32_t index, std::uint32_t cell);
+    void detach(std::uint32_t index);
+
+    template <class Visitor>
+    void searchRings(const Vec2& position, Visitor&& visit) const;
+
+    float activeCellSize = 1.0f;
+    float minX = 0.0f;
+    float minY = 0.0f;
+    int columns = 0;
+    int rows = 0;
+    std::size_t indexedCount = 0;
+    std::vector<std::vector<std::uint32_t>> cells;
+    std::vector<std::uint32_t> cellOf;
+    std::vector<std::uint32_t> slotOf;
+    std::vector<std::uint32_t> pendingCell;
+};
+
+#endif
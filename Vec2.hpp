@@ -0,0 +1,33 @@
+﻿#ifndef VEC2_HPP
+#define VEC2_HPP
+
+#include <cmath>
+
+// Двовимірний вектор ядра симуляції (без залежності від SFML)
+struct Vec2 {
+    float x = 0.0f;
+    float y = 0.0f;
+
+    Vec2() = default;
+    Vec2(float x, float y) : x(x), y(y) {}
+
+    Vec2 operator+(const Vec2& other) const { return Vec2(x + other.x, y + other.y); }
+    Vec2 operator-(const Vec2& other) const { return Vec2(x - other.x, y - other.y); }
+    Vec2 operator*(float scalar) const { return Vec2(x * scalar, y * scalar); }
+    Vec2 operator/(float scalar) const { return Vec2(x / scalar, y / scalar); }
+
+    Vec2& operator+=(const Vec2& other) { x += other.x; y += other.y; return *this; }
+    Vec2& operator-=(const Vec2& other) { x -= other.x; y -= other.y; return *this; }
+    Vec2& operator*=(float scalar) { x *= scalar; y *= scalar; return *this; }
+    Vec2& operator/=(float scalar) { x /= scalar; y /= scalar; return *this; }
+};
+
+inline Vec2 operator*(float scalar, const Vec2& v) {
+    return Vec2(v.x * scalar, v.y * scalar);
+}
+
+inline float length(const Vec2& v) {
+    return std::sqrt(v.x * v.x + v.y * v.y);
+}
+
+#endif
@@ -0,0 +1,133 @@
+﻿#include "VideoRecorder.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+VideoFormat videoFormatFor(const std::string& path) {
+    const bool ppm = path.size() > 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+    return ppm ? VideoFormat::Ppm : VideoFormat::Y4m;
+}
+
+bool VideoWriter::open(const std::string& path, VideoFormat videoFormat, int frameWidth, int frameHeight, int fps) {
+    close();
+    format = videoFormat;
+    width = frameWidth;
+    height = frameHeight;
+    frameCount = 0;
+    if (format == VideoFormat::Y4m && (width % 2 != 0 || height % 2 != 0)) {
+        std::cerr << "Error: Y4M frames need an even width and height." << std::endl;
+        return false;
+    }
+
+    if (path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        file = stdout;
+        ownsFile = false;
+    }
+    else {
+        file = std::fopen(path.c_str(), "wb");
+        ownsFile = true;
+    }
+    if (!file) {
+        std::cerr << "Error: Could not open video output " << path << std::endl;
+        return false;
+    }
+
+    if (format == VideoFormat::Y4m) {
+        // C420jpeg: кольоровість посередині квадрата 2x2, повний діапазон
+        std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, std::max(fps, 1));
+    }
+    return true;
+}
+
+bool VideoWriter::write(const std::vector<std::uint8_t>& rgb) {
+    if (!file) return false;
+    KOSMOS_PROFILE_SCOPE("video write");
+
+    if (format == VideoFormat::Ppm) {
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        if (std::fwrite(rgb.data(), 1, rgb.size(), file) != rgb.size()) return false;
+        ++frameCount;
+        return true;
+    }
+
+    // RGB -> Y на кожен піксель, Cb/Cr - середнє квадрата 2x2; рядки пар діляться між потоками пулу
+    const std::size_t lumaSize = static_cast<std::size_t>(width) * height;
+    const std::size_t chromaWidth = static_cast<std::size_t>(width / 2);
+    const std::size_t chromaSize = chromaWidth * (height / 2);
+    planes.resize(lumaSize + 2 * chromaSize);
+    std::uint8_t* luma = planes.data();
+    std::uint8_t* cb = luma + lumaSize;
+    std::uint8_t* cr = cb + chromaSize;
+
+    JobSystem::instance().parallelFor(static_cast<std::size_t>(height / 2), 16, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t pair = begin; pair < end; ++pair) {
+            for (std::size_t column = 0; column < chromaWidth; ++column) {
+                float sumR = 0.0f, sumG = 0.0f, sumB = 0.0f;
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const std::size_t pixel = (2 * pair + dy) * width + 2 * column + dx;
+                        const float r = rgb[pixel * 3];
+                        const float g = rgb[pixel * 3 + 1];
+                        const float b = rgb[pixel * 3 + 2];
+                        luma[pixel] = static_cast<std::uint8_t>(0.299f * r + 0.587f * g + 0.114f * b + 0.5f);
+                        sumR += r;
+                        sumG += g;
+                        sumB += b;
+                    }
+                }
+                sumR *= 0.25f;
+                sumG *= 0.25f;
+                sumB *= 0.25f;
+                const std::size_t chroma = pair * chromaWidth + column;
+                cb[chroma] = static_cast<std::uint8_t>(std::min(std::max(128.0f - 0.168736f * sumR - 0.331264f * sumG + 0.5f * sumB + 0.5f, 0.0f), 255.0f));
+                cr[chroma] = static_cast<std::uint8_t>(std::min(std::max(128.0f + 0.5f * sumR - 0.418688f * sumG - 0.081312f * sumB + 0.5f, 0.0f), 255.0f));
+            }
+        }
+    });
+
+    std::fputs("FRAME\n", file);
+    if (std::fwrite(planes.data(), 1, planes.size(), file) != planes.size()) return false;
+    ++frameCount;
+    return true;
+}
+
+bool VideoWriter::close() {
+    if (!file) return true;
+    bool succeeded = std::fflush(file) == 0;
+    if (ownsFile) succeeded = std::fclose(file) == 0 && succeeded;
+    file = nullptr;
+    return succeeded;
+}
+
+bool VideoRecorder::submit(const Simulation& simulation) {
+    JobSystem& jobs = JobSystem::instance();
+    jobs.wait(pending);
+    if (failed) return false;
+
+    {
+        KOSMOS_PROFILE_SCOPE("video capture");
+        frame.capture(simulation, blackHoleRadius);
+    }
+    jobs.run(pending, [this] {
+        KOSMOS_PROFILE_SCOPE("video frame");
+        renderer.render(frame, view);
+        if (!writer.write(renderer.pixels())) failed = true;
+    });
+    return true;
+}
+
+bool VideoRecorder::finish() {
+    if (finished) return !failed;
+    finished = true;
+    JobSystem::instance().wait(pending);
+    if (!writer.close()) failed = true;
+    return !failed;
+}
@@ -0,0 +1,76 @@
+﻿#ifndef VIDEO_RECORDER_HPP
+#define VIDEO_RECORDER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "JobSystem.hpp"
+#include "SoftwareRenderer.hpp"
+
+// Кадри для ffmpeg у файл, іменований канал або stdout ("-"):
+//  - Y4M: YUV 4:2:0 (BT.601, повний діапазон), ffmpeg читає його без параметрів: ffmpeg -i frames.y4m out.mp4;
+//  - PPM: послідовність зображень P6: ffmpeg -f image2pipe -c:v ppm -framerate 60 -i frames.ppm out.mp4.
+enum class VideoFormat {
+    Y4m,
+    Ppm
+};
+
+// .ppm - PPM, решта (.y4m, канали, "-") - Y4M
+VideoFormat videoFormatFor(const std::string& path);
+
+class VideoWriter {
+public:
+    VideoWriter() {}
+    ~VideoWriter() { close(); }
+
+    VideoWriter(const VideoWriter&) = delete;
+    VideoWriter& operator=(const VideoWriter&) = delete;
+
+    // Y4M потребує парних сторін (кольоровість 2x2)
+    bool open(const std::string& path, VideoFormat format, int width, int height, int fps);
+    // rgb - width * height * 3 байтів, рядок за рядком
+    bool write(const std::vector<std::uint8_t>& rgb);
+    bool close();
+
+    std::uint64_t frames() const { return frameCount; }
+
+private:
+    std::FILE* file = nullptr;
+    bool ownsFile = false;
+    VideoFormat format = VideoFormat::Y4m;
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> planes;
+    std::uint64_t frameCount = 0;
+};
+
+// Запис кадрів паралельно з симуляцією: submit копіює стан (як PhysicsThread::publish),
+// а растеризація по плитках і запис кадру йдуть завданням JobSystem, поки крокують наступні такти.
+// Наступний submit спершу чекає на попередній кадр, тож кадри пишуться по порядку.
+class VideoRecorder {
+public:
+    VideoRecorder(int width, int height) : renderer(width, height) {}
+    ~VideoRecorder() { finish(); }
+
+    bool open(const std::string& path, int fps) { return writer.open(path, videoFormatFor(path), renderer.width(), renderer.height(), fps); }
+    // false, якщо не вдався запис попереднього кадру
+    bool submit(const Simulation& simulation);
+    // Дочікується останнього кадру й закриває потік
+    bool finish();
+
+    std::uint64_t frames() const { return writer.frames(); }
+
+    RenderView view;
+    float blackHoleRadius = 50.0f;
+
+private:
+    SoftwareRenderer renderer;
+    VideoWriter writer;
+    RenderFrame frame;
+    JobGroup pending;
+    bool failed = false;
+    bool finished = false;
+};
+
+#endif
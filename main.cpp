@@ -1,78 +1,23 @@
 ﻿#include <SFML/Graphics.hpp> 
-#include <omp.h>
 #include "CameraController.hpp" // Управління
 #include "MatterGenerator.hpp" // Генератор матерії
+#include "Catalog.hpp" // Початкові умови з файла
 #include "BlackHole.hpp" // Чорна діра
-#include "Ship.hpp"
+#include "Simulation.hpp" // Ядро симуляції
+#include "MatterRenderer.hpp" // Пакетний рендер
+#include "PhysicsThread.hpp" // Фізика з фіксованим кроком
+#include "Snapshot.hpp" // Збереження стану
+#include "Profiler.hpp" // Заміри фаз кадру
+#include "ProfilerOverlay.hpp"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
 #include <random>
 #include <limits>
+#include <string>
 
-
-void applyGravityToMatters(std::vector<Matter>& matters, const sf::Vector2f& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime);
-void handleCollisions(std::vector<Matter>& matters);
-Matter* findNearestMatter(const Ship& ship, std::vector<Matter>& matters);
-
-void applyGravityToMatters(std::vector<Matter>& matters, const sf::Vector2f& blackHolePosition, float blackHoleMass, float gravityMultiplier, float deltaTime) {
-#pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < matters.size(); ++i) {
-        matters[i].applyGravity(blackHolePosition, blackHoleMass * gravityMultiplier, deltaTime);
-    }
-}
-
-void handleCollisions(std::vector<Matter>& matters) {
-    for (size_t i = 0; i < matters.size(); ++i) {
-        for (size_t j = i + 1; j < matters.size(); ++j) {
-            sf::Vector2f diff = matters[i].shape.getPosition() - matters[j].shape.getPosition();
-            float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-            float minDistance = matters[i].shape.getRadius() + matters[j].shape.getRadius();
-
-            if (distance < minDistance) {
-                sf::Vector2f normal = diff / distance;
-                sf::Vector2f relativeVelocity = matters[i].velocity - matters[j].velocity;
-                float velocityAlongNormal = relativeVelocity.x * normal.x + relativeVelocity.y * normal.y;
-
-                if (velocityAlongNormal > 0)
-                    continue;
-
-                float restitution = 0.8f;
-                float j = -(1.0f + restitution) * velocityAlongNormal;
-                j /= 1.0f / 1.0f + 1.0f / 1.0f;
-
-                sf::Vector2f impulse = j * normal;
-                matters[i].velocity += impulse;
-                matters[j].velocity -= impulse;
-            }
-        }
-    }
-}
-
-Matter* findNearestMatter(const Ship& ship, std::vector<Matter>& matters) {
-    Matter* nearestMatter = nullptr;
-    float minDistance = std::numeric_limits<float>::max();
-
-    for (auto& matter : matters) {
-        if (matter.isColony) continue;
-
-        sf::Vector2f diff = matter.shape.getPosition() - ship.shape.getPosition();
-        float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-
-        if (distance < minDistance) {
-            minDistance = distance;
-            nearestMatter = &matter;
-        }
-    }
-
-    return nearestMatter;
-}
-
-int main() {
-    omp_set_dynamic(0);
-    omp_set_num_threads(omp_get_max_threads());
-    omp_set_nested(1);
-
+// Використання: KOSMOS [каталог.csv|каталог.bin] - без каталогу тіла генеруються
+int main(int argc, char** argv) {
     sf::RenderWindow window(sf::VideoMode(1800, 1600), "Black Hole Simulation");
     if (!window.isOpen()) {
         std::cerr << "Error: Could not open window." << std::endl;
@@ -82,179 +27,337 @@ int main() {
     sf::Vector2f blackHolePosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
     BlackHole blackHole(50.0f, 500.0f, blackHolePosition);
 
-    MatterGenerator generator(blackHolePosition, blackHole.mass);
-    std::vector<Matter> matters = generator.generateMatter(7560); // Матерія або зірки "(Точки)"
-    std::vector<Ship> ships;
-
-    float gravityMultiplier = 70.5f;
-    bool blackHoleActive = true;
-    bool blackHolePaused = false;
-    bool collisionHandlingActive = false;
-    bool colonizationActive = false; 
-    float timeScale = 1.0f;
     float additionalDistance = 50.0f;
     float deletionRadius = blackHole.shape.getRadius() + additionalDistance;
+    Vec2 simulationBlackHolePosition(blackHolePosition.x, blackHolePosition.y);
+
+    Simulation simulation(simulationBlackHolePosition, blackHole.mass, deletionRadius);
+    MatterGenerator generator(simulationBlackHolePosition, blackHole.mass);
+    CatalogStats catalog;
+    if (argc > 1) {
+        if (!importCatalog(argv[1], simulation.matters, &catalog)) return -1;
+        std::cout << "Catalog: " << catalog.bodies << " bodies in " << catalog.seconds * 1000.0 << " ms ("
+                  << catalog.bytes / (1024.0 * 1024.0) / catalog.seconds << " MB/s)" << std::endl;
+    }
+    else {
+        simulation.matters = generator.generateMatter(7560); // Матерія або зірки "(Точки)"
+    }
+    MatterStore& matters = simulation.matters;
 
     sf::View view(sf::FloatRect(0, 0, window.getSize().x, window.getSize().y));
     CameraController cameraController(view);
 
     sf::Clock clock;
 
-    // початкова колонія та корабель
-    if (!matters.empty()) {
-        matters[0].isColony = true;
-        matters[0].shape.setFillColor(sf::Color::Green);
-        ships.push_back(matters[0].createShip());
+    // початкова колонія та корабель; колонії з каталогу отримують по кораблю
+    if (catalog.colonies > 0) {
+        for (std::size_t i = 0; i < matters.size(); ++i) {
+            if (matters.isColony[i]) simulation.createShip(i);
+        }
+    }
+    else if (!matters.empty()) {
+        simulation.makeColony(0);
+        simulation.createShip(0);
     }
 
-    while (window.isOpen()) {
-        float deltaTime = clock.restart().asSeconds() * timeScale;
-
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed)
-                window.close();
-
-            cameraController.handleEvent(event);
+    // Контрольні точки пишуться у фоні; F5 - зберегти зараз, F9 - продовжити зі збереженого
+    const std::string snapshotPath = "kosmos.snapshot";
+    const float autosaveSeconds = 60.0f;
+    Checkpointer checkpointer;
+    sf::Clock autosaveClock;
+
+    // Фізика крокує у власному потоці, вікно лише малює інтерпольовані знімки
+    PhysicsThread physics(simulation);
+    physics.rewind.budgetBytes = std::size_t(256) << 20;
+    physics.start();
+    SimulationSnapshot frame;
+
+    // Перемотування: Home - зупинити й гортати історію (PageDown/PageUp - на секунду назад/вперед),
+    // End - продовжити з показаного такту, Home ще раз - повернутись туди, де зупинились
+    bool scrubbing = false;
+    float scrubScale = 1.0f;
+    std::uint64_t scrubTick = 0;
+    std::uint64_t shownTick = 0;
+    const std::uint64_t scrubStride = 120;
+    RenderFrame scrubFrame;
+
+    MatterRenderer renderer;
+    bool batchedRendering = true;
+
+    // Фігури для старого рендеру (по одній на тіло), будуються лише під час малювання
+    sf::CircleShape matterShape;
+    sf::CircleShape shipShape(5.0f);
+    shipShape.setFillColor(sf::Color::Blue);
+
+    // F3 - оверлей профайлера, F4 - почати/закінчити запис траси (Chrome trace JSON і CSV)
+    Profiler& profiler = Profiler::instance();
+    profiler.nameThread("main");
+    ProfilerOverlay profilerOverlay;
+    const std::string tracePath = "kosmos-trace";
 
-            if (event.type == sf::Event::KeyPressed) {
-                switch (event.key.code) {
-                case sf::Keyboard::Num0:
-                    blackHoleActive = !blackHoleActive;
-                    break;
-                case sf::Keyboard::Num1:
-                    gravityMultiplier = 0.5f; // Маса дірки = Велика швидкість засмоктування
-                    break;
-                case sf::Keyboard::Num2:
-                    gravityMultiplier = 100.0f; // Маса дірки = Велика швидкість засмоктування
-                    break;
-                case sf::Keyboard::Num3: 
-                    gravityMultiplier = 20000.0f; // Маса дірки = Велика швидкість засмоктування
-                    break;
-                case sf::Keyboard::Num4:
-                    gravityMultiplier = 400000.0f; // Маса дірки = Велика швидкість засмоктування
-                    break;
-                case sf::Keyboard::Num5:
-                    gravityMultiplier = 8000000.0f; // Маса дірки = Велика швидкість засмоктування
-                    break;
-                case sf::Keyboard::Num6:
-                    gravityMultiplier = 16.0f; // Маса дірки = Велика швидкість засмоктування 
-                    break;
-                case sf::Keyboard::Num7: // НЕ ОПТИМІЗОВАНО "(Реал Фізики Зіткнень)"
-                    collisionHandlingActive = !collisionHandlingActive;
-                    break;
-                case sf::Keyboard::Num8: { // активації колонізації
-                    std::random_device rd;
-                    std::mt19937 gen(rd());
-                    std::uniform_int_distribution<> dis(0, matters.size() - 1);
-                    int randomIndex = dis(gen);
-                    matters[randomIndex].isColony = true;
-                    matters[randomIndex].shape.setFillColor(sf::Color::Green);
-                    colonizationActive = true; //  колонізація
-                    break;
-                }
-                case sf::Keyboard::P:
-                    blackHolePaused = !blackHolePaused;
-                    break;
-                case sf::Keyboard::Add:
-                    timeScale *= 2.0f;
-                    break;
-                case sf::Keyboard::Subtract:
-                    timeScale /= 2.0f;
-                    break;
-                default:
-                    break;
+    while (window.isOpen()) {
+        float deltaTime = clock.restart().asSeconds() * physics.timeScale();
+
+        {
+            KOSMOS_PROFILE_SCOPE("input");
+            sf::Event event;
+            while (window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed)
+                    window.close();
+
+                cameraController.handleEvent(event);
+
+                if (event.type == sf::Event::KeyPressed) {
+                    switch (event.key.code) {
+                    case sf::Keyboard::Num0:
+                        physics.post([](Simulation& s) { s.blackHoleActive = !s.blackHoleActive; });
+                        break;
+                    case sf::Keyboard::Num1:
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 0.5f; }); // Маса дірки = Велика швидкість засмоктування
+                        break;
+                    case sf::Keyboard::Num2:
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 100.0f; }); // Маса дірки = Велика швидкість засмоктування
+                        break;
+                    case sf::Keyboard::Num3: 
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 20000.0f; }); // Маса дірки = Велика швидкість засмоктування
+                        break;
+                    case sf::Keyboard::Num4:
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 400000.0f; }); // Маса дірки = Велика швидкість засмоктування
+                        break;
+                    case sf::Keyboard::Num5:
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 8000000.0f; }); // Маса дірки = Велика швидкість засмоктування
+                        break;
+                    case sf::Keyboard::Num6:
+                        physics.post([](Simulation& s) { s.gravityMultiplier = 16.0f; }); // Маса дірки = Велика швидкість засмоктування 
+                        break;
+                    case sf::Keyboard::Num7: // Зіткнення через сітку "(Реал Фізики Зіткнень)"
+                        physics.post([](Simulation& s) { s.collisionHandlingActive = !s.collisionHandlingActive; });
+                        break;
+                    case sf::Keyboard::Num8: { // активації колонізації
+                        std::random_device rd;
+                        unsigned seed = rd();
+                        physics.post([seed](Simulation& s) {
+                            if (s.matters.empty()) return;
+                            std::mt19937 gen(seed);
+                            std::uniform_int_distribution<> dis(0, static_cast<int>(s.matters.size()) - 1);
+                            int randomIndex = dis(gen);
+                            s.makeColony(randomIndex);
+                            s.colonizationActive = true; //  колонізація
+                        });
+                        break;
+                    }
+                    case sf::Keyboard::P:
+                        physics.post([](Simulation& s) { s.blackHolePaused = !s.blackHolePaused; });
+                        break;
+                    case sf::Keyboard::G: // взаємна гравітація тіл (Барнс–Хат)
+                        physics.post([](Simulation& s) {
+                            s.gravity.mode = s.gravity.mode == GravityMode::BarnesHut ? GravityMode::BlackHoleOnly : GravityMode::BarnesHut;
+                        });
+                        break;
+                    case sf::Keyboard::M: // взаємна гравітація через сітку (мільйони тіл)
+                        physics.post([](Simulation& s) {
+                            s.gravity.mode = s.gravity.mode == GravityMode::ParticleMesh ? GravityMode::BlackHoleOnly : GravityMode::ParticleMesh;
+                        });
+                        break;
+                    case sf::Keyboard::Comma: // точніше дерево
+                        physics.post([](Simulation& s) { s.gravity.tree.openingAngle = std::max(0.1f, s.gravity.tree.openingAngle - 0.1f); });
+                        break;
+                    case sf::Keyboard::Period: // швидше дерево
+                        physics.post([](Simulation& s) { s.gravity.tree.openingAngle = std::min(1.5f, s.gravity.tree.openingAngle + 0.1f); });
+                        break;
+                    case sf::Keyboard::B: // пакетний рендер або старий по одній фігурі
+                        batchedRendering = !batchedRendering;
+                        break;
+                    case sf::Keyboard::D: // густина замість тіл при сильному віддаленні
+                        renderer.levelOfDetail = !renderer.levelOfDetail;
+                        break;
+                    case sf::Keyboard::L: // leapfrog або старий крок Ейлера
+                        physics.post([](Simulation& s) {
+                            s.integrator = s.integrator == Integrator::Leapfrog ? Integrator::Euler : Integrator::Leapfrog;
+                        });
+                        break;
+                    case sf::Keyboard::T: // блокові кроки: тіла біля дірки дрібнішають самі
+                        physics.post([](Simulation& s) { s.blockTimesteps = !s.blockTimesteps; });
+                        break;
+                    case sf::Keyboard::LBracket: // менше підкроків
+                        physics.post([](Simulation& s) { s.substeps = std::max(1, s.substeps / 2); });
+                        break;
+                    case sf::Keyboard::RBracket: // більше підкроків
+                        physics.post([](Simulation& s) { s.substeps = std::min(64, s.substeps * 2); });
+                        break;
+                    case sf::Keyboard::F5:
+                        physics.post([&](Simulation& s) { checkpointer.request(s, physics.fixedStep, snapshotPath); });
+                        break;
+                    case sf::Keyboard::F9:
+                        physics.post([&](Simulation& s) {
+                            checkpointer.wait();
+                            float step = physics.fixedStep;
+                            if (loadSnapshot(snapshotPath, s, &step)) {
+                                physics.fixedStep = step;
+                                ++s.layoutVersion; // не змішувати з кадрами до завантаження
+                            }
+                            else {
+                                std::cerr << "Error: Could not load " << snapshotPath << std::endl;
+                            }
+                        });
+                        break;
+                    case sf::Keyboard::F3:
+                        profilerOverlay.visible = !profilerOverlay.visible;
+                        profiler.setEnabled(profilerOverlay.visible || profiler.capturing());
+                        break;
+                    case sf::Keyboard::F4:
+                        if (!profiler.capturing()) {
+                            profiler.setEnabled(true);
+                            profiler.startCapture();
+                        }
+                        else {
+                            profiler.stopCapture();
+                            profiler.setEnabled(profilerOverlay.visible);
+                            if (!profiler.writeChromeTrace(tracePath + ".json") || !profiler.writeCsv(tracePath + ".csv")) {
+                                std::cerr << "Error: Could not write " << tracePath << std::endl;
+                            }
+                        }
+                        break;
+                    case sf::Keyboard::Home:
+                        if (!scrubbing) {
+                            scrubScale = physics.timeScale();
+                            physics.setTimeScale(0.0f);
+                            scrubTick = physics.rewind.newestTick();
+                            shownTick = std::numeric_limits<std::uint64_t>::max();
+                            scrubbing = true;
+                        }
+                        else {
+                            physics.setTimeScale(scrubScale);
+                            scrubbing = false;
+                            window.setTitle("Black Hole Simulation");
+                        }
+                        break;
+                    case sf::Keyboard::PageDown:
+                        if (scrubbing) {
+                            std::uint64_t oldest = physics.rewind.oldestTick();
+                            scrubTick = scrubTick > oldest + scrubStride ? scrubTick - scrubStride : oldest;
+                        }
+                        break;
+                    case sf::Keyboard::PageUp:
+                        if (scrubbing) scrubTick = std::min(scrubTick + scrubStride, physics.rewind.newestTick());
+                        break;
+                    case sf::Keyboard::End:
+                        if (scrubbing) {
+                            // Точний стан: ключовий кадр і повторні кроки в потоці фізики
+                            std::uint64_t target = scrubTick;
+                            physics.post([&physics, target](Simulation& s) {
+                                float step = physics.fixedStep;
+                                if (physics.rewind.seek(target, s, &step)) {
+                                    physics.fixedStep = step;
+                                    ++s.layoutVersion; // не змішувати з кадрами до перемотування
+                                }
+                                else {
+                                    std::cerr << "Error: Could not rewind to tick " << target << std::endl;
+                                }
+                            });
+                            physics.setTimeScale(scrubScale);
+                            scrubbing = false;
+                            window.setTitle("Black Hole Simulation");
+                        }
+                        break;
+                    case sf::Keyboard::Add: // більше кроків за секунду, сам крок не змінюється
+                        physics.setTimeScale(physics.timeScale() * 2.0f);
+                        break;
+                    case sf::Keyboard::Subtract:
+                        physics.setTimeScale(physics.timeScale() / 2.0f);
+                        break;
+                    default:
+                        break;
+                    }
                 }
             }
-        }
-
-        cameraController.handleInput();
-        window.setView(view);
 
-        blackHole.update(deltaTime);
+            if (autosaveClock.getElapsedTime().asSeconds() > autosaveSeconds) {
+                autosaveClock.restart();
+                physics.post([&](Simulation& s) { checkpointer.request(s, physics.fixedStep, snapshotPath); });
+            }
 
-        if (blackHoleActive && !blackHolePaused) {
-            applyGravityToMatters(matters, blackHole.getPosition(), blackHole.mass, gravityMultiplier, deltaTime);
+            cameraController.handleInput();
         }
+        window.setView(view);
 
-        if (collisionHandlingActive) {
-            handleCollisions(matters);
+        blackHole.update(deltaTime);
+        if (!scrubbing) {
+            KOSMOS_PROFILE_SCOPE("interpolate");
+            physics.interpolate(frame);
         }
-
-        for (auto& matter : matters) {
-            matter.update(deltaTime);
+        else {
+            // Наближений кадр з історії; точний стан рахується лише після End
+            std::uint64_t tick = 0;
+            if (physics.rewind.frameAt(scrubTick, scrubFrame, &tick)) {
+                frame.posX = scrubFrame.posX;
+                frame.posY = scrubFrame.posY;
+                frame.radius = scrubFrame.radius;
+                frame.isColony = scrubFrame.isColony;
+                frame.ships = scrubFrame.ships;
+                frame.shipRadius = scrubFrame.shipRadius;
+                frame.blackHoleActive = scrubFrame.blackHoleActive;
+                frame.tick = tick;
+                if (tick != shownTick) {
+                    shownTick = tick;
+                    window.setTitle("Black Hole Simulation - rewind, tick " + std::to_string(tick));
+                }
+            }
         }
 
-        // Обработка кораблей
-        if (colonizationActive) {
-            for (size_t i = 0; i < ships.size();) {
-                Matter* nearestMatter = findNearestMatter(ships[i], matters);
-                if (nearestMatter) {
-                    ships[i].moveTowards(nearestMatter->shape.getPosition(), deltaTime);
-
-                    sf::Vector2f diff = nearestMatter->shape.getPosition() - ships[i].shape.getPosition();
-                    float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-
-                    if (distance < ships[i].shape.getRadius() + nearestMatter->shape.getRadius()) {
-                        sf::Vector2f returnPosition = ships[i].initialColonyPosition;
-
-                        // Колонізуємо нову зірку
-                        nearestMatter->isColony = true;
-                        nearestMatter->shape.setFillColor(sf::Color::Green);
+        // Отрисовка
+        {
+            KOSMOS_PROFILE_SCOPE("draw");
+            std::size_t drawCalls = 0; // без пакетного рендеру, він рахує свої сам
+            window.clear(sf::Color::Black);
 
-                        // Створюємо новий корабель
-                        if (!nearestMatter->hasShip) {
-                            ships.push_back(nearestMatter->createShip());
-                            nearestMatter->hasShip = true;
-                        }
+            sf::FloatRect visibleArea(view.getCenter() - view.getSize() / 2.0f, view.getSize());
 
-                        // Повертаємо корабель на батьківщину
-                        ships[i].shape.setPosition(returnPosition);
-                        ships[i].velocity = sf::Vector2f(0.0f, 0.0f);
+            if (frame.blackHoleActive) {
+                window.draw(blackHole.shape);
+                ++drawCalls;
+            }
 
-                        i++; 
-                    }
-                    else {
-                        i++; 
+            if (batchedRendering) {
+                renderer.draw(window, frame, visibleArea);
+            }
+            else {
+                for (std::size_t i = 0; i < frame.size(); ++i) {
+                    float radius = frame.radius[i];
+                    sf::FloatRect bounds(frame.posX[i] - radius, frame.posY[i] - radius, 2.0f * radius, 2.0f * radius);
+                    if (visibleArea.intersects(bounds)) {
+                        matterShape.setRadius(radius);
+                        matterShape.setOrigin(radius, radius);
+                        matterShape.setPosition(frame.posX[i], frame.posY[i]);
+                        matterShape.setFillColor(frame.isColony[i] ? sf::Color::Green : sf::Color::White);
+                        window.draw(matterShape);
+                        ++drawCalls;
                     }
                 }
-                else {
-                    i++; 
+
+                shipShape.setRadius(frame.shipRadius);
+                for (const Vec2& ship : frame.ships) {
+                    shipShape.setPosition(ship.x, ship.y);
+                    if (visibleArea.intersects(shipShape.getGlobalBounds())) {
+                        window.draw(shipShape);
+                        ++drawCalls;
+                    }
                 }
             }
+            KOSMOS_PROFILE_COUNT("draw calls", drawCalls);
         }
 
-        // Кіл зона дірки
-        matters.erase(std::remove_if(matters.begin(), matters.end(),
-            [&](const Matter& matter) {
-                sf::Vector2f direction = blackHole.getPosition() - matter.shape.getPosition();
-                float distance = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-                return distance < deletionRadius;
-            }), matters.end());
+        profilerOverlay.draw(window, profiler);
 
-        // Отрисовка
-        window.clear(sf::Color::Black);
-
-        sf::FloatRect visibleArea(view.getCenter() - view.getSize() / 2.0f, view.getSize());
-
-        if (blackHoleActive) {
-            window.draw(blackHole.shape);
-        }
-
-        for (auto& matter : matters) {
-            if (visibleArea.intersects(matter.shape.getGlobalBounds())) {
-                window.draw(matter.shape);
-            }
+        {
+            KOSMOS_PROFILE_SCOPE("present");
+            window.display();
         }
-
-        for (auto& ship : ships) {
-            if (visibleArea.intersects(ship.shape.getGlobalBounds())) {
-                window.draw(ship.shape);
-            }
+        if (profiler.enabled()) {
+            profiler.endFrame();
         }
-
-        window.display();
     }
 
+    physics.stop();
     return 0;
 }